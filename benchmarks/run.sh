@@ -0,0 +1,37 @@
+#!/bin/bash
+# Runs the benchmark in every mode of paracl and prints the times. The output of
+# the programs is discarded. Usage: bash benchmarks/run.sh <file.pcl> [input]
+# The extra options of paracl can be set by PARACL_FLAGS, e.g. -checked.
+
+SCRIPT_PATH="${BASH_SOURCE[0]}"
+SCRIPT_DIR="$(dirname "$SCRIPT_PATH")"
+PROJECT_DIR="$(realpath "$SCRIPT_DIR/..")"
+PARACL="${PARACL:-${PROJECT_DIR}/build/paracl}"
+
+filename="$1"
+if [ ! -f "${filename}" ]; then
+  echo "error: expected filename"
+  exit 1
+fi
+input="${2:-/dev/null}"
+read -r -a flags <<< "${PARACL_FLAGS:-}"
+
+exe_file="$(mktemp)"
+trap "rm -f '${exe_file}'" EXIT
+
+measure() {
+  local name="$1"
+  shift
+  local start=$(date +%s%N)
+  "$@" < "${input}" > /dev/null || echo "${name}: failed"
+  local end=$(date +%s%N)
+  printf "%-12s %8d ms\n" "${name}" $(((end - start) / 1000000))
+}
+
+measure interpreter "${PARACL}" "${flags[@]}" "${filename}"
+measure vm "${PARACL}" "${flags[@]}" -oper-mode=vm "${filename}"
+measure tiered "${PARACL}" "${flags[@]}" -oper-mode=tiered "${filename}"
+measure jit "${PARACL}" "${flags[@]}" -oper-mode=jit "${filename}"
+"${PARACL}" "${flags[@]}" -oper-mode=compiler -emit=exe -O2 "${filename}" \
+  -o "${exe_file}" &&
+  measure compiled "${exe_file}"
@@ -11,10 +11,17 @@ if [ ! -f ${filename} ]; then
 fi
 shift
 
-temp_file="$(mktemp).ll"
-trap "rm -f '${temp_file}'" EXIT
+# The options of the C++ compiler the script used to pass the arguments to are
+# translated into the paracl ones or dropped, the rest go to paracl as is
+args=()
+for arg in "$@"; do
+  case "${arg}" in
+    -march=*) args+=("-mcpu=${arg#-march=}") ;;
+    -Ofast) args+=("-O3") ;;
+    -Os | -Oz | -Og) args+=("-O2") ;;
+    -g* | -W* | -w | -pedantic* | -std=* | -f* | -mtune=* | -pthread) ;;
+    *) args+=("${arg}") ;;
+  esac
+done
 
-${PROJECT_DIR}/build/paracl -oper-mode=compiler ${filename} -o ${temp_file}
-if [ -f "${temp_file}" ]; then
-  clang++ "${temp_file}" "${PROJECT_DIR}/lib/std_pcl_lib/pcllib.cpp" "$@"
-fi
+${PROJECT_DIR}/build/paracl -oper-mode=compiler -emit=exe ${filename} "${args[@]}"
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <llvm/ADT/SmallBitVector.h>
+
 #include "expression.hpp"
 
 namespace paracl {
@@ -37,6 +39,8 @@ public:
 
   expression *getInitExpr() noexcept { return InitExpr; }
   expression *getSize() noexcept { return Size; }
+  void setInitExpr(expression *Init) noexcept { InitExpr = Init; }
+  void setSize(expression *SizeExp) noexcept { Size = SizeExp; }
 
   ResultValue accept(VisitorBasePtr Vis) override { return Vis->visit(this); }
 
@@ -60,6 +64,17 @@ public:
   unsigned getSize() const noexcept { return RanksId.size(); }
   expression *getIdentExp() const noexcept { return IdentExp; }
 
+  // The indexes of the marked dimensions are checked at runtime (-checked)
+  void setBoundsCheck(unsigned Dim) {
+    assert(Dim < getSize());
+    if (BoundsChecks.empty())
+      BoundsChecks.resize(getSize());
+    BoundsChecks.set(Dim);
+  }
+  bool needsBoundsCheck(unsigned Dim) const {
+    return Dim < BoundsChecks.size() && BoundsChecks.test(Dim);
+  }
+
   auto begin() { return RanksId.begin(); }
   auto end() { return RanksId.end(); }
   auto begin() const { return RanksId.begin(); }
@@ -67,6 +82,7 @@ public:
 
 private:
   llvm::SmallVector<expression *> RanksId;
+  llvm::SmallBitVector BoundsChecks;
   expression *IdentExp;
 };
 
@@ -80,12 +96,17 @@ public:
 
   ArrayAccess *getArrayAccess() noexcept { return ArrAccess; }
   expression *getIdentExp() noexcept { return Identifier; }
+  void setIdentExp(expression *Ident) noexcept { Identifier = Ident; }
 
   SymbNameType name() const { return ArrAccess->name(); }
   SymTabKey entityKey() {
     assert(ArrAccess);
     return ArrAccess->entityKey();
   }
+  FrameSlot slot() const noexcept {
+    assert(ArrAccess);
+    return ArrAccess->slot();
+  }
 
 private:
   ArrayAccess *ArrAccess;
@@ -2,6 +2,8 @@
 
 #include <llvm/ADT/SmallString.h>
 
+#include <vector>
+
 #include "identifiers.hpp"
 #include "location.hh"
 #include "statement.hpp"
@@ -10,6 +12,10 @@
 
 namespace paracl {
 
+namespace runtime {
+struct ElementStep;
+} // namespace runtime
+
 namespace ast {
 
 class expression : public statement {
@@ -46,8 +52,12 @@ public:
 
   SymTabKey entityKey();
 
+  void setSlot(FrameSlot Slot) noexcept { Slot_ = Slot; }
+  FrameSlot slot() const noexcept { return Slot_; }
+
 private:
   SymbNameType name_;
+  FrameSlot Slot_;
 };
 
 class un_operator : public expression {
@@ -57,6 +67,7 @@ public:
   ResultValue accept(VisitorBasePtr Vis) override;
 
   expression *arg() noexcept;
+  void set_arg(pointer_type arg) noexcept { arg_ = arg; }
   UnOp type() const noexcept;
 
 private:
@@ -72,11 +83,19 @@ public:
 
   pointer_type left() noexcept { return left_; }
   pointer_type right() noexcept { return right_; }
+  void set_left(pointer_type left) noexcept { left_ = left; }
+  void set_right(pointer_type right) noexcept { right_ = right; }
   BinType type() const noexcept { return type_; }
 
+  // The operator is applied to every element of the arrays of the same shape,
+  // e.g. A + B * 2. Such operators are marked by the ErrorHandler.
+  bool is_element_wise() const noexcept { return element_wise_; }
+  void set_element_wise() noexcept { element_wise_ = true; }
+
 protected:
   BinType type_;
   pointer_type left_, right_;
+  bool element_wise_ = false;
 };
 
 class calc_expression : public bin_operator<CalcOp> {
@@ -93,6 +112,17 @@ public:
   ResultValue accept(VisitorBasePtr Vis) override;
 };
 
+// Whether the expression is an element-wise operator that creates a new array
+bool is_element_wise(expression *exp) noexcept;
+
+// Appends the steps of the element-wise expression in the postfix order to
+// steps and their nodes to nodes. The operands are the subexpressions that
+// aren't element-wise operators, they are numbered in the order of the
+// evaluation.
+void flatten_element_wise(expression *exp,
+                          std::vector<runtime::ElementStep> &steps,
+                          std::vector<expression *> &nodes);
+
 class assignment : public expression {
 public:
   assignment(statement_block *curr_block, variable *LValue, expression *expr,
@@ -102,11 +132,13 @@ public:
 
   variable *getLValue() noexcept;
   expression *getIdentExp() noexcept;
+  void setIdentExp(expression *Ident) noexcept { Identifier = Ident; }
 
   llvm::StringRef name() const;
   PCLType::TypeID getID() const noexcept;
 
   SymTabKey entityKey();
+  FrameSlot slot() const noexcept;
 
 private:
   variable *LValue;
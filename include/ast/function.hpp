@@ -1,5 +1,10 @@
 #pragma once
 
+#include <llvm/ADT/StringRef.h>
+#include <llvm/ADT/StringSwitch.h>
+
+#include <optional>
+
 #include "expression.hpp"
 #include "location.hh"
 #include "statement.hpp"
@@ -15,10 +20,66 @@ public:
   ResultValue accept(VisitorBasePtr Vis) override { return Vis->visit(this); }
 
   expression *get() const noexcept { return print_expr_; }
+  void set(expression *expr) noexcept { print_expr_ = expr; }
 
 private:
   expression *print_expr_;
 };
 
+enum class ReduceOp { SUM, MIN, MAX, COUNT, DOT };
+
+// The builtin reductions of the arrays: sum(A), min(A), max(A), count(A, V)
+// and dot(A, B). The arrays are the array variables, the operand is V for
+// count, B for dot and null otherwise. The min and the max of an empty array
+// are INT_MAX and INT_MIN.
+class reduce_function : public expression {
+public:
+  reduce_function(ReduceOp type, expression *arr, expression *operand,
+                  yy::location loc)
+      : expression{loc}, type_{type}, array_{arr}, operand_{operand} {}
+
+  ResultValue accept(VisitorBasePtr Vis) override { return Vis->visit(this); }
+
+  ReduceOp type() const noexcept { return type_; }
+  expression *array() const noexcept { return array_; }
+  expression *operand() const noexcept { return operand_; }
+  void set_operand(expression *operand) noexcept { operand_ = operand; }
+
+  llvm::StringRef name() const noexcept {
+    switch (type_) {
+    case ReduceOp::SUM:
+      return "sum";
+    case ReduceOp::MIN:
+      return "min";
+    case ReduceOp::MAX:
+      return "max";
+    case ReduceOp::COUNT:
+      return "count";
+    case ReduceOp::DOT:
+      return "dot";
+    }
+    return {};
+  }
+
+  static std::optional<ReduceOp> find(llvm::StringRef name) {
+    return llvm::StringSwitch<std::optional<ReduceOp>>(name)
+        .Case("sum", ReduceOp::SUM)
+        .Case("min", ReduceOp::MIN)
+        .Case("max", ReduceOp::MAX)
+        .Case("count", ReduceOp::COUNT)
+        .Case("dot", ReduceOp::DOT)
+        .Default(std::nullopt);
+  }
+
+  static unsigned num_args(ReduceOp type) noexcept {
+    return type == ReduceOp::COUNT || type == ReduceOp::DOT ? 2 : 1;
+  }
+
+private:
+  ReduceOp type_;
+  expression *array_;
+  expression *operand_;
+};
+
 } // namespace ast
 } // namespace paracl
@@ -19,6 +19,19 @@ enum class CalcOp : char { PERCENT, ADD, SUB, MUL, DIV };
 
 enum class UnOp : char { PLUS, MINUS, NEGATE };
 
+// The place of a variable at runtime: the nesting depth of the block where the
+// variable was declared and the index of the variable in the frame of this
+// block. It's bound once by the Resolver before the execution.
+struct FrameSlot final {
+  static constexpr unsigned InvalidIndex = ~0u;
+
+  unsigned Depth = 0;
+  unsigned Index = InvalidIndex;
+
+  bool isValid() const noexcept { return Index != InvalidIndex; }
+  bool operator==(const FrameSlot &) const = default;
+};
+
 } // namespace ast
 
 } // namespace paracl
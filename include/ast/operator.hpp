@@ -1,5 +1,9 @@
 #pragma once
 
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallVector.h>
+
 #include <vector>
 
 #include "expression.hpp"
@@ -16,8 +20,10 @@ public:
       : statement{loc}, condition_{cond}, body_{body} {}
 
   expression *condition() noexcept { return condition_; }
+  void set_condition(expression *cond) noexcept { condition_ = cond; }
 
   statement *body() noexcept { return body_; }
+  void set_body(statement *body) noexcept { body_ = body; }
 
 protected:
   expression *condition_;
@@ -29,6 +35,17 @@ public:
   using ctrl_statement::ctrl_statement;
 
   ResultValue accept(VisitorBasePtr Vis) override { return Vis->visit(this); }
+
+  // The variable counting the iterations of the loop whose iterations were
+  // proven to be independent (-auto-par), the compiled code executes them in
+  // parallel. Null for the other loops.
+  variable *parallel_induction() noexcept { return parallel_induction_; }
+  void set_parallel_induction(variable *var) noexcept {
+    parallel_induction_ = var;
+  }
+
+private:
+  variable *parallel_induction_ = nullptr;
 };
 
 class if_operator final : public ctrl_statement {
@@ -42,11 +59,66 @@ public:
   ResultValue accept(VisitorBasePtr Vis) override { return Vis->visit(this); }
 
   statement *else_block() noexcept { return else_block_; }
+  void set_else_block(statement *else_block) noexcept {
+    else_block_ = else_block;
+  }
 
 private:
   statement *else_block_{nullptr};
 };
 
+// The parallel loop 'pfor (i = init; i < limit) body'. The bounds are
+// evaluated once, then the body is executed for every i from init to
+// limit - 1. The iterations run in any order and at the same time, so they
+// may only write the elements of the arrays and the variables declared in the
+// body. The loop variable is declared in the block of the body, every
+// iteration has its own copy of it.
+class pfor_operator final : public statement {
+public:
+  pfor_operator(variable *loop_var, expression *init, expression *limit,
+                statement_block *body, yy::location loc)
+      : statement{loc}, loop_var_{loop_var}, init_{init}, limit_{limit},
+        body_{body} {}
+
+  ResultValue accept(VisitorBasePtr Vis) override { return Vis->visit(this); }
+
+  variable *loop_variable() noexcept { return loop_var_; }
+
+  expression *init() noexcept { return init_; }
+  void set_init(expression *init) noexcept { init_ = init; }
+
+  expression *limit() noexcept { return limit_; }
+  void set_limit(expression *limit) noexcept { limit_ = limit; }
+
+  statement_block *body() noexcept { return body_; }
+
+  // The arrays declared outside of the loop and written by its body. They are
+  // found by the Resolver, so the interpreter can prepare them for the
+  // concurrent writes.
+  llvm::ArrayRef<FrameSlot> shared_arrays() const noexcept {
+    return shared_arrays_;
+  }
+  void add_shared_array(FrameSlot slot) {
+    if (!llvm::is_contained(shared_arrays_, slot))
+      shared_arrays_.push_back(slot);
+  }
+
+  // Whether the body creates a new array from one of the shared arrays, the
+  // rows of such an array can't be shared with the other threads
+  bool copies_shared_arrays() const noexcept { return copies_shared_arrays_; }
+  void set_copies_shared_arrays(bool copies) noexcept {
+    copies_shared_arrays_ = copies;
+  }
+
+private:
+  variable *loop_var_;
+  expression *init_;
+  expression *limit_;
+  statement_block *body_;
+  llvm::SmallVector<FrameSlot, 2> shared_arrays_;
+  bool copies_shared_arrays_ = false;
+};
+
 } // namespace ast
 
 } // namespace paracl
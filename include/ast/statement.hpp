@@ -75,8 +75,23 @@ public:
 
   unsigned size() const noexcept { return statements_.size(); }
 
+  // Removes the statements that were replaced with null by an AST pass
+  void erase_null_statements() { std::erase(statements_, nullptr); }
+
+  // The frame layout is computed by the Resolver: the nesting depth of the
+  // block and the number of variables declared in it.
+  void set_frame_layout(unsigned depth, unsigned slots_num) noexcept {
+    depth_ = depth;
+    slots_num_ = slots_num;
+  }
+
+  unsigned depth() const noexcept { return depth_; }
+  unsigned slots_num() const noexcept { return slots_num_; }
+
 private:
   StmtsStore statements_;
+  unsigned depth_ = 0;
+  unsigned slots_num_ = 0;
 };
 
 class root_statement_block : public statement_block {
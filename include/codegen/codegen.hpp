@@ -2,6 +2,7 @@
 
 #include <llvm/ADT/DenseMap.h>
 #include <llvm/ADT/StringRef.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/LLVMContext.h>
@@ -24,7 +25,20 @@ class IRCodeGenerator final {
 public:
   static constexpr StringRef ParaCLStartFuncName = "__pcl_start";
   static constexpr StringRef ParaCLPrintFuncName = "__pcl_print";
+  static constexpr StringRef ParaCLPrintArrayFuncName = "__pcl_print_array";
   static constexpr StringRef ParaCLScanFuncName = "__pcl_scan";
+  static constexpr StringRef ParaCLFillArrayFuncName = "__pcl_fill_array";
+  static constexpr StringRef ParaCLIndexErrorFuncName = "__pcl_index_error";
+  static constexpr StringRef ParaCLParallelForFuncName = "__pcl_parallel_for";
+  static constexpr StringRef ParaCLArraySumFuncName = "__pcl_array_sum";
+  static constexpr StringRef ParaCLArrayMinFuncName = "__pcl_array_min";
+  static constexpr StringRef ParaCLArrayMaxFuncName = "__pcl_array_max";
+  static constexpr StringRef ParaCLArrayCountFuncName = "__pcl_array_count";
+  static constexpr StringRef ParaCLArrayDotFuncName = "__pcl_array_dot";
+  static constexpr StringRef ParaCLSizeErrorFuncName = "__pcl_size_error";
+  static constexpr StringRef ParaCLShapeErrorFuncName = "__pcl_shape_error";
+  static constexpr StringRef ParaCLDivisionErrorFuncName =
+      "__pcl_division_error";
 
   IRCodeGenerator(StringRef ModuleName);
 
@@ -63,11 +77,16 @@ public:
 
   const Module &getModule() const;
 
+  // Moves the module together with its context out of the generator, e.g. to
+  // execute it in the JIT. The generator can't be used after that.
+  orc::ThreadSafeModule takeModule();
+
 private:
   // Create print and scan function decls
   void createParaCLStdLibFuncsDecls();
 
-  LLVMContext Context;
+  std::unique_ptr<LLVMContext> ContextPtr;
+  LLVMContext &Context;
   std::unique_ptr<IRBuilder<>> Builder;
   std::unique_ptr<Module> Mod;
 };
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <llvm/IR/Module.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+
+namespace paracl {
+namespace codegen {
+
+using namespace llvm;
+
+enum class OutputKind { IR, Bitcode, Assembly, Object, Executable };
+
+// Returns true if the output of the Kind is written in the text mode
+inline bool isTextOutput(OutputKind Kind) {
+  return Kind == OutputKind::IR || Kind == OutputKind::Assembly;
+}
+
+// Writes the module to Os in the format of the Kind. The module must already
+// have the data layout and the triple of the TM. The executable can't be
+// written to a stream, see linkExecutable.
+void emitModule(Module &Mod, TargetMachine &TM, OutputKind Kind,
+                raw_pwrite_stream &Os);
+
+// Links the object file with the ParaCL runtime library into the executable.
+// The linker and the library are set by the -linker and -runtime-lib options.
+Error linkExecutable(StringRef ObjectFile, StringRef ExecutableFile);
+
+} // namespace codegen
+} // namespace paracl
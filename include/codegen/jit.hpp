@@ -0,0 +1,94 @@
+#pragma once
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/Passes/OptimizationLevel.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Target/TargetMachine.h>
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "identifiers.hpp"
+#include "input_reader.hpp"
+#include "output_buffer.hpp"
+
+namespace paracl {
+
+namespace ast {
+class while_operator;
+} // namespace ast
+
+namespace codegen {
+
+using namespace llvm;
+
+// Owns the ORC LLJIT that executes the generated ParaCL modules. The ParaCL
+// standard library functions (__pcl_print, __pcl_print_array and __pcl_scan)
+// are resolved to the functions of the paracl executable that work with Output
+// and Input.
+class ParaCLJIT final {
+public:
+  static Expected<std::unique_ptr<ParaCLJIT>>
+  create(OptimizationLevel OptLevel, runtime::OutputBuffer &Output,
+         runtime::InputReader &Input);
+
+  // Optimizes the module at the OptLevel and adds it to the JIT
+  Error addModule(orc::ThreadSafeModule TSM);
+
+  template <typename FuncTy> Expected<FuncTy *> lookup(StringRef Name) {
+    auto Addr = Jit->lookup(Name);
+    if (!Addr)
+      return Addr.takeError();
+    return Addr->template toPtr<FuncTy *>();
+  }
+
+private:
+  ParaCLJIT(std::unique_ptr<orc::LLJIT> Jit, std::unique_ptr<TargetMachine> TM,
+            OptimizationLevel OptLevel)
+      : Jit(std::move(Jit)), TM(std::move(TM)), OptLevel(OptLevel) {}
+
+  std::unique_ptr<orc::LLJIT> Jit;
+  std::unique_ptr<TargetMachine> TM;
+  OptimizationLevel OptLevel;
+};
+
+// Executes the generated ParaCL module in-process: the module is optimized,
+// compiled by the JIT and __pcl_start is called.
+Error runInJIT(orc::ThreadSafeModule TSM, OptimizationLevel OptLevel,
+               runtime::OutputBuffer &Output, runtime::InputReader &Input);
+
+// The while loop compiled apart from the program. The entry function takes the
+// values of the live-in variables in the order of LiveIns and stores back the
+// values they have after the loop.
+struct CompiledLoop final {
+  using EntryTy = void(int32_t *);
+
+  EntryTy *Entry = nullptr;
+  SmallVector<ast::FrameSlot> LiveIns;
+};
+
+// Compiles the hot loops of the interpreted program, so the interpreter can
+// continue the execution of a loop in the native code (on-stack replacement).
+class HotLoopCompiler final {
+public:
+  HotLoopCompiler(StringRef ModuleName, OptimizationLevel OptLevel,
+                  runtime::OutputBuffer &Output, runtime::InputReader &Input);
+
+  // Returns null if the loop can't be compiled. Every loop is compiled once.
+  const CompiledLoop *getCompiledLoop(ast::while_operator *While);
+
+private:
+  std::unique_ptr<CompiledLoop> compileLoop(ast::while_operator *While);
+
+  std::string ModuleName;
+  std::unique_ptr<ParaCLJIT> Jit;
+  DenseMap<ast::while_operator *, std::unique_ptr<CompiledLoop>> Loops;
+};
+
+} // namespace codegen
+} // namespace paracl
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Passes/OptimizationLevel.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Target/TargetMachine.h>
+
+#include <memory>
+
+namespace paracl {
+namespace codegen {
+
+using namespace llvm;
+
+// Creates the target machine for TargetTriple. The cpu and its features are
+// selected by the -mcpu option, -mcpu=native stands for the host cpu.
+Expected<std::unique_ptr<TargetMachine>>
+createTargetMachine(StringRef TargetTriple);
+
+// Applies the -mcpu option to the target machine of the JIT. The JIT keeps the
+// host cpu if the option isn't given.
+void setTargetCPU(orc::JITTargetMachineBuilder &JTMB);
+
+// Sets the data layout of the module and the target-cpu and target-features
+// attributes of its functions, so the passes can use the cpu features
+void setTargetAttributes(Module &Mod, const TargetMachine &TM);
+
+// Runs the default pipeline of the new pass manager for the Level on the
+// module. Nothing is done for O0.
+void optimizeModule(Module &Mod, TargetMachine &TM, OptimizationLevel Level);
+
+} // namespace codegen
+} // namespace paracl
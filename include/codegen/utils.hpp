@@ -31,4 +31,13 @@ void dumpInDotFormat(const llvm::Module &Mod, llvm::StringRef FileNameToDump);
 
 [[noreturn]] void fatal(llvm::Twine ErrMes);
 
+namespace runtime {
+class OutputBuffer;
+} // namespace runtime
+
+// Flushes the output and reports the error of the running program, only the
+// first error is reported if several threads fail at once
+[[noreturn]] void fatalRuntimeError(runtime::OutputBuffer &Output,
+                                    llvm::Twine ErrMes);
+
 } // namespace paracl
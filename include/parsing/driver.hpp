@@ -1,11 +1,15 @@
 #pragma once
 
+#include <llvm/Passes/OptimizationLevel.h>
+
 #include <optional>
 #include <string>
 #include <utility>
 
 #include "ast.hpp"
+#include "emitter.hpp"
 #include "error_handler.hpp"
+#include "input_reader.hpp"
 #include "paracl_grammar.tab.hh"
 #include "scanner.hpp"
 
@@ -41,10 +45,42 @@ public:
 
   std::optional<paracl::ErrorHandler> validate() const;
 
-  void evaluate(std::ostream &output = std::cout,
-                std::istream &input = std::cin);
+  void optimize();
+
+  void resolve();
+
+  // Marks the array accesses checked at runtime in the -checked mode, it needs
+  // the resolved variables
+  void insert_bounds_checks();
+
+  // Marks the loops executed in parallel by the compiled code (-auto-par) and
+  // reports why the other loops aren't parallelized
+  void parallelize_loops(llvm::StringRef FileName);
+
+  void evaluate(paracl::runtime::InputReader &input,
+                std::ostream &output = std::cout);
+
+  void evaluate_tiered(llvm::StringRef ModuleName,
+                       llvm::OptimizationLevel OptLevel,
+                       paracl::runtime::InputReader &input,
+                       std::ostream &output = std::cout);
+
+  void execute(paracl::runtime::InputReader &input,
+               std::ostream &output = std::cout);
+
+  void compile(llvm::StringRef ModuleName, llvm::raw_pwrite_stream &Os,
+               llvm::OptimizationLevel OptLevel,
+               paracl::codegen::OutputKind Kind);
+
+  // Compiles the program to a temporary object file and links it with the
+  // ParaCL runtime library
+  void build_executable(llvm::StringRef ModuleName,
+                        llvm::StringRef ExecutableFile,
+                        llvm::OptimizationLevel OptLevel);
 
-  void compile(llvm::StringRef ModuleName, llvm::raw_ostream &Os);
+  void jit(llvm::StringRef ModuleName, llvm::OptimizationLevel OptLevel,
+           paracl::runtime::InputReader &input,
+           std::ostream &output = std::cout);
 
 private:
   scanner scanner_;
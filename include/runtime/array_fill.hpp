@@ -0,0 +1,38 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace paracl {
+namespace runtime {
+
+// Fills Size elements at Dest with the repeated pattern of PatternSize
+// elements, the last copy of the pattern may be cut off. The pattern is copied
+// once, then the filled part is doubled by memcpy until it reaches BlockSize
+// elements, and the rest is filled by the copies of that block. The block
+// stays in the cache, so the fill is bound by the memory writes only.
+inline void fillArray(int32_t *Dest, uint64_t Size, const int32_t *Pattern,
+                      uint64_t PatternSize) {
+  constexpr uint64_t BlockSize = (1 << 15) / sizeof(int32_t);
+
+  if (!Size || !PatternSize)
+    return;
+  auto Filled = std::min(Size, PatternSize);
+  std::memcpy(Dest, Pattern, Filled * sizeof(int32_t));
+  // The filled part consists of the whole patterns until the last copy
+  while (Filled < Size && Filled < BlockSize) {
+    auto Chunk = std::min(Filled, Size - Filled);
+    std::memcpy(Dest + Filled, Dest, Chunk * sizeof(int32_t));
+    Filled += Chunk;
+  }
+  const auto Block = Filled;
+  while (Filled < Size) {
+    auto Chunk = std::min(Block, Size - Filled);
+    std::memcpy(Dest + Filled, Dest, Chunk * sizeof(int32_t));
+    Filled += Chunk;
+  }
+}
+
+} // namespace runtime
+} // namespace paracl
@@ -0,0 +1,308 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define PARACL_X86_REDUCE_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace paracl {
+namespace runtime {
+
+// The kernels of the builtin reductions sum(A), min(A), max(A), count(A, V)
+// and dot(A, B) over the contiguous elements of the arrays. The integers wrap
+// around on overflow like all the ParaCL arithmetic. On x86-64 the elements
+// are processed by the AVX2 code if the cpu supports it and by the SSE2 code
+// otherwise, the other targets use the scalar loops. Every vector kernel keeps
+// two accumulators, so the additions of the neighbouring vectors don't wait
+// for each other and the loop is bound by the memory bandwidth.
+
+namespace detail {
+
+inline int32_t wrapAdd(int32_t Lhs, int32_t Rhs) {
+  return static_cast<int32_t>(static_cast<uint32_t>(Lhs) +
+                              static_cast<uint32_t>(Rhs));
+}
+
+inline int32_t wrapMul(int32_t Lhs, int32_t Rhs) {
+  return static_cast<int32_t>(static_cast<uint32_t>(Lhs) *
+                              static_cast<uint32_t>(Rhs));
+}
+
+// The scalar loops also process the tails of the vector kernels, Acc is the
+// result of the vector part
+inline int32_t sumScalar(const int32_t *Arr, int64_t Size, int32_t Acc = 0) {
+  for (int64_t Id = 0; Id < Size; ++Id)
+    Acc = wrapAdd(Acc, Arr[Id]);
+  return Acc;
+}
+
+inline int32_t minScalar(const int32_t *Arr, int64_t Size,
+                         int32_t Acc = INT32_MAX) {
+  for (int64_t Id = 0; Id < Size; ++Id)
+    Acc = Arr[Id] < Acc ? Arr[Id] : Acc;
+  return Acc;
+}
+
+inline int32_t maxScalar(const int32_t *Arr, int64_t Size,
+                         int32_t Acc = INT32_MIN) {
+  for (int64_t Id = 0; Id < Size; ++Id)
+    Acc = Arr[Id] > Acc ? Arr[Id] : Acc;
+  return Acc;
+}
+
+inline int32_t countScalar(const int32_t *Arr, int64_t Size, int32_t Val,
+                           int32_t Acc = 0) {
+  for (int64_t Id = 0; Id < Size; ++Id)
+    Acc = wrapAdd(Acc, Arr[Id] == Val);
+  return Acc;
+}
+
+inline int32_t dotScalar(const int32_t *Lhs, const int32_t *Rhs, int64_t Size,
+                         int32_t Acc = 0) {
+  for (int64_t Id = 0; Id < Size; ++Id)
+    Acc = wrapAdd(Acc, wrapMul(Lhs[Id], Rhs[Id]));
+  return Acc;
+}
+
+#ifdef PARACL_X86_REDUCE_KERNELS
+
+#define PARACL_AVX2 __attribute__((target("avx2")))
+
+inline bool hasAVX2() {
+  static const bool Supported = __builtin_cpu_supports("avx2");
+  return Supported;
+}
+
+inline __m128i load4(const int32_t *Arr) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i *>(Arr));
+}
+
+PARACL_AVX2 inline __m256i load8(const int32_t *Arr) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(Arr));
+}
+
+// SSE2 has no min/max and no multiplication of the 32-bit integers
+inline __m128i minSSE2(__m128i Lhs, __m128i Rhs) {
+  auto IsGreater = _mm_cmpgt_epi32(Lhs, Rhs);
+  return _mm_or_si128(_mm_and_si128(IsGreater, Rhs),
+                      _mm_andnot_si128(IsGreater, Lhs));
+}
+
+inline __m128i maxSSE2(__m128i Lhs, __m128i Rhs) {
+  auto IsGreater = _mm_cmpgt_epi32(Lhs, Rhs);
+  return _mm_or_si128(_mm_and_si128(IsGreater, Lhs),
+                      _mm_andnot_si128(IsGreater, Rhs));
+}
+
+inline __m128i mulSSE2(__m128i Lhs, __m128i Rhs) {
+  auto Even = _mm_mul_epu32(Lhs, Rhs);
+  auto Odd = _mm_mul_epu32(_mm_srli_si128(Lhs, 4), _mm_srli_si128(Rhs, 4));
+  return _mm_unpacklo_epi32(_mm_shuffle_epi32(Even, _MM_SHUFFLE(0, 0, 2, 0)),
+                            _mm_shuffle_epi32(Odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+enum class LaneOp { ADD, MIN, MAX };
+
+inline __m128i combineLanes(LaneOp Op, __m128i Lhs, __m128i Rhs) {
+  switch (Op) {
+  case LaneOp::ADD:
+    return _mm_add_epi32(Lhs, Rhs);
+  case LaneOp::MIN:
+    return minSSE2(Lhs, Rhs);
+  case LaneOp::MAX:
+    return maxSSE2(Lhs, Rhs);
+  }
+  return Lhs;
+}
+
+// Combines the lanes of the accumulator into one integer
+inline int32_t reduceLanes(LaneOp Op, __m128i Acc) {
+  Acc = combineLanes(Op, Acc, _mm_shuffle_epi32(Acc, _MM_SHUFFLE(1, 0, 3, 2)));
+  Acc = combineLanes(Op, Acc, _mm_shuffle_epi32(Acc, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtsi128_si32(Acc);
+}
+
+PARACL_AVX2 inline int32_t reduceLanes(LaneOp Op, __m256i Acc) {
+  return reduceLanes(Op, combineLanes(Op, _mm256_castsi256_si128(Acc),
+                                      _mm256_extracti128_si256(Acc, 1)));
+}
+
+PARACL_AVX2 inline int32_t sumAVX2(const int32_t *Arr, int64_t Size) {
+  auto Acc0 = _mm256_setzero_si256(), Acc1 = Acc0;
+  int64_t Id = 0;
+  for (; Id + 16 <= Size; Id += 16) {
+    Acc0 = _mm256_add_epi32(Acc0, load8(Arr + Id));
+    Acc1 = _mm256_add_epi32(Acc1, load8(Arr + Id + 8));
+  }
+  auto Acc = reduceLanes(LaneOp::ADD, _mm256_add_epi32(Acc0, Acc1));
+  return sumScalar(Arr + Id, Size - Id, Acc);
+}
+
+inline int32_t sumSSE2(const int32_t *Arr, int64_t Size) {
+  auto Acc0 = _mm_setzero_si128(), Acc1 = Acc0;
+  int64_t Id = 0;
+  for (; Id + 8 <= Size; Id += 8) {
+    Acc0 = _mm_add_epi32(Acc0, load4(Arr + Id));
+    Acc1 = _mm_add_epi32(Acc1, load4(Arr + Id + 4));
+  }
+  auto Acc = reduceLanes(LaneOp::ADD, _mm_add_epi32(Acc0, Acc1));
+  return sumScalar(Arr + Id, Size - Id, Acc);
+}
+
+PARACL_AVX2 inline int32_t minAVX2(const int32_t *Arr, int64_t Size) {
+  auto Acc0 = _mm256_set1_epi32(INT32_MAX), Acc1 = Acc0;
+  int64_t Id = 0;
+  for (; Id + 16 <= Size; Id += 16) {
+    Acc0 = _mm256_min_epi32(Acc0, load8(Arr + Id));
+    Acc1 = _mm256_min_epi32(Acc1, load8(Arr + Id + 8));
+  }
+  auto Acc = reduceLanes(LaneOp::MIN, _mm256_min_epi32(Acc0, Acc1));
+  return minScalar(Arr + Id, Size - Id, Acc);
+}
+
+inline int32_t minSSE2(const int32_t *Arr, int64_t Size) {
+  auto Acc0 = _mm_set1_epi32(INT32_MAX), Acc1 = Acc0;
+  int64_t Id = 0;
+  for (; Id + 8 <= Size; Id += 8) {
+    Acc0 = minSSE2(Acc0, load4(Arr + Id));
+    Acc1 = minSSE2(Acc1, load4(Arr + Id + 4));
+  }
+  auto Acc = reduceLanes(LaneOp::MIN, minSSE2(Acc0, Acc1));
+  return minScalar(Arr + Id, Size - Id, Acc);
+}
+
+PARACL_AVX2 inline int32_t maxAVX2(const int32_t *Arr, int64_t Size) {
+  auto Acc0 = _mm256_set1_epi32(INT32_MIN), Acc1 = Acc0;
+  int64_t Id = 0;
+  for (; Id + 16 <= Size; Id += 16) {
+    Acc0 = _mm256_max_epi32(Acc0, load8(Arr + Id));
+    Acc1 = _mm256_max_epi32(Acc1, load8(Arr + Id + 8));
+  }
+  auto Acc = reduceLanes(LaneOp::MAX, _mm256_max_epi32(Acc0, Acc1));
+  return maxScalar(Arr + Id, Size - Id, Acc);
+}
+
+inline int32_t maxSSE2(const int32_t *Arr, int64_t Size) {
+  auto Acc0 = _mm_set1_epi32(INT32_MIN), Acc1 = Acc0;
+  int64_t Id = 0;
+  for (; Id + 8 <= Size; Id += 8) {
+    Acc0 = maxSSE2(Acc0, load4(Arr + Id));
+    Acc1 = maxSSE2(Acc1, load4(Arr + Id + 4));
+  }
+  auto Acc = reduceLanes(LaneOp::MAX, maxSSE2(Acc0, Acc1));
+  return maxScalar(Arr + Id, Size - Id, Acc);
+}
+
+// The mask of the equal elements is -1, so it's subtracted from the counters
+PARACL_AVX2 inline int32_t countAVX2(const int32_t *Arr, int64_t Size,
+                                     int32_t Val) {
+  auto Splat = _mm256_set1_epi32(Val);
+  auto Acc0 = _mm256_setzero_si256(), Acc1 = Acc0;
+  int64_t Id = 0;
+  for (; Id + 16 <= Size; Id += 16) {
+    Acc0 = _mm256_sub_epi32(Acc0, _mm256_cmpeq_epi32(load8(Arr + Id), Splat));
+    Acc1 =
+        _mm256_sub_epi32(Acc1, _mm256_cmpeq_epi32(load8(Arr + Id + 8), Splat));
+  }
+  auto Acc = reduceLanes(LaneOp::ADD, _mm256_add_epi32(Acc0, Acc1));
+  return countScalar(Arr + Id, Size - Id, Val, Acc);
+}
+
+inline int32_t countSSE2(const int32_t *Arr, int64_t Size, int32_t Val) {
+  auto Splat = _mm_set1_epi32(Val);
+  auto Acc0 = _mm_setzero_si128(), Acc1 = Acc0;
+  int64_t Id = 0;
+  for (; Id + 8 <= Size; Id += 8) {
+    Acc0 = _mm_sub_epi32(Acc0, _mm_cmpeq_epi32(load4(Arr + Id), Splat));
+    Acc1 = _mm_sub_epi32(Acc1, _mm_cmpeq_epi32(load4(Arr + Id + 4), Splat));
+  }
+  auto Acc = reduceLanes(LaneOp::ADD, _mm_add_epi32(Acc0, Acc1));
+  return countScalar(Arr + Id, Size - Id, Val, Acc);
+}
+
+PARACL_AVX2 inline int32_t dotAVX2(const int32_t *Lhs, const int32_t *Rhs,
+                                   int64_t Size) {
+  auto Acc0 = _mm256_setzero_si256(), Acc1 = Acc0;
+  int64_t Id = 0;
+  for (; Id + 16 <= Size; Id += 16) {
+    Acc0 = _mm256_add_epi32(
+        Acc0, _mm256_mullo_epi32(load8(Lhs + Id), load8(Rhs + Id)));
+    Acc1 = _mm256_add_epi32(
+        Acc1, _mm256_mullo_epi32(load8(Lhs + Id + 8), load8(Rhs + Id + 8)));
+  }
+  auto Acc = reduceLanes(LaneOp::ADD, _mm256_add_epi32(Acc0, Acc1));
+  return dotScalar(Lhs + Id, Rhs + Id, Size - Id, Acc);
+}
+
+inline int32_t dotSSE2(const int32_t *Lhs, const int32_t *Rhs, int64_t Size) {
+  auto Acc0 = _mm_setzero_si128(), Acc1 = Acc0;
+  int64_t Id = 0;
+  for (; Id + 8 <= Size; Id += 8) {
+    Acc0 = _mm_add_epi32(Acc0, mulSSE2(load4(Lhs + Id), load4(Rhs + Id)));
+    Acc1 = _mm_add_epi32(Acc1,
+                         mulSSE2(load4(Lhs + Id + 4), load4(Rhs + Id + 4)));
+  }
+  auto Acc = reduceLanes(LaneOp::ADD, _mm_add_epi32(Acc0, Acc1));
+  return dotScalar(Lhs + Id, Rhs + Id, Size - Id, Acc);
+}
+
+#undef PARACL_AVX2
+
+#endif // PARACL_X86_REDUCE_KERNELS
+
+} // namespace detail
+
+inline int32_t sumArray(const int32_t *Arr, int64_t Size) {
+#ifdef PARACL_X86_REDUCE_KERNELS
+  return detail::hasAVX2() ? detail::sumAVX2(Arr, Size)
+                           : detail::sumSSE2(Arr, Size);
+#else
+  return detail::sumScalar(Arr, Size);
+#endif
+}
+
+// Returns INT32_MAX for an empty array
+inline int32_t minArray(const int32_t *Arr, int64_t Size) {
+#ifdef PARACL_X86_REDUCE_KERNELS
+  return detail::hasAVX2() ? detail::minAVX2(Arr, Size)
+                           : detail::minSSE2(Arr, Size);
+#else
+  return detail::minScalar(Arr, Size);
+#endif
+}
+
+// Returns INT32_MIN for an empty array
+inline int32_t maxArray(const int32_t *Arr, int64_t Size) {
+#ifdef PARACL_X86_REDUCE_KERNELS
+  return detail::hasAVX2() ? detail::maxAVX2(Arr, Size)
+                           : detail::maxSSE2(Arr, Size);
+#else
+  return detail::maxScalar(Arr, Size);
+#endif
+}
+
+// Returns the number of the elements equal to Val
+inline int32_t countInArray(const int32_t *Arr, int64_t Size, int32_t Val) {
+#ifdef PARACL_X86_REDUCE_KERNELS
+  return detail::hasAVX2() ? detail::countAVX2(Arr, Size, Val)
+                           : detail::countSSE2(Arr, Size, Val);
+#else
+  return detail::countScalar(Arr, Size, Val);
+#endif
+}
+
+// Returns the sum of the products of the elements with the same indexes
+inline int32_t dotArrays(const int32_t *Lhs, const int32_t *Rhs,
+                         int64_t Size) {
+#ifdef PARACL_X86_REDUCE_KERNELS
+  return detail::hasAVX2() ? detail::dotAVX2(Lhs, Rhs, Size)
+                           : detail::dotSSE2(Lhs, Rhs, Size);
+#else
+  return detail::dotScalar(Lhs, Rhs, Size);
+#endif
+}
+
+} // namespace runtime
+} // namespace paracl
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace paracl {
+namespace runtime {
+
+// The operators of the element-wise expressions over the arrays, the
+// comparisons give 0 or 1
+enum class ElementOp : uint8_t {
+  Add,
+  Sub,
+  Mul,
+  Div,
+  Rem,
+  Less,
+  LessEq,
+  Greater,
+  GreaterEq,
+  Equal,
+  NotEqual
+};
+
+// A step of an element-wise expression in the postfix order: it either pushes
+// the operand with the index Operand or replaces the two values on the top of
+// the stack with the result of Op.
+struct ElementStep final {
+  bool IsOperand = false;
+  ElementOp Op = ElementOp::Add;
+  unsigned Operand = 0;
+
+  static ElementStep makeOperand(unsigned Operand) {
+    return {true, ElementOp::Add, Operand};
+  }
+  static ElementStep makeOperator(ElementOp Op) { return {false, Op, 0}; }
+};
+
+// An operand of an element-wise expression: the elements of an array or, if
+// Data is null, the integer used for all the elements
+struct ElementOperand final {
+  const int32_t *Data = nullptr;
+  int32_t Scalar = 0;
+};
+
+namespace detail {
+
+// The integers wrap around like in the compiled code
+template <ElementOp Op> int32_t computeElement(int32_t Lhs, int32_t Rhs) {
+  auto ULhs = static_cast<uint32_t>(Lhs);
+  auto URhs = static_cast<uint32_t>(Rhs);
+  if constexpr (Op == ElementOp::Add)
+    return static_cast<int32_t>(ULhs + URhs);
+  else if constexpr (Op == ElementOp::Sub)
+    return static_cast<int32_t>(ULhs - URhs);
+  else if constexpr (Op == ElementOp::Mul)
+    return static_cast<int32_t>(ULhs * URhs);
+  // INT32_MIN / -1 overflows, so the division by -1 is the negation
+  else if constexpr (Op == ElementOp::Div)
+    return Rhs == -1 ? static_cast<int32_t>(0u - ULhs) : Lhs / Rhs;
+  else if constexpr (Op == ElementOp::Rem)
+    return Rhs == -1 ? 0 : Lhs % Rhs;
+  else if constexpr (Op == ElementOp::Less)
+    return Lhs < Rhs;
+  else if constexpr (Op == ElementOp::LessEq)
+    return Lhs <= Rhs;
+  else if constexpr (Op == ElementOp::Greater)
+    return Lhs > Rhs;
+  else if constexpr (Op == ElementOp::GreaterEq)
+    return Lhs >= Rhs;
+  else if constexpr (Op == ElementOp::Equal)
+    return Lhs == Rhs;
+  else
+    return Lhs != Rhs;
+}
+
+// Calls Func with the operator as a compile-time constant, so the loops over
+// the elements don't switch on the operator
+template <typename FuncTy> void dispatchElementOp(ElementOp Op, FuncTy Func) {
+  using enum ElementOp;
+  switch (Op) {
+  case Add:
+    return Func(std::integral_constant<ElementOp, Add>());
+  case Sub:
+    return Func(std::integral_constant<ElementOp, Sub>());
+  case Mul:
+    return Func(std::integral_constant<ElementOp, Mul>());
+  case Div:
+    return Func(std::integral_constant<ElementOp, Div>());
+  case Rem:
+    return Func(std::integral_constant<ElementOp, Rem>());
+  case Less:
+    return Func(std::integral_constant<ElementOp, Less>());
+  case LessEq:
+    return Func(std::integral_constant<ElementOp, LessEq>());
+  case Greater:
+    return Func(std::integral_constant<ElementOp, Greater>());
+  case GreaterEq:
+    return Func(std::integral_constant<ElementOp, GreaterEq>());
+  case Equal:
+    return Func(std::integral_constant<ElementOp, Equal>());
+  case NotEqual:
+    return Func(std::integral_constant<ElementOp, NotEqual>());
+  }
+}
+
+// Applies Op to Size elements of the operands, Out may be the same buffer as
+// Lhs.Data. At least one of the operands is an array.
+template <ElementOp Op>
+void applyToBlock(ElementOperand Lhs, ElementOperand Rhs, int32_t *Out,
+                  int64_t Size) {
+  if (Lhs.Data && Rhs.Data)
+    for (int64_t Id = 0; Id < Size; ++Id)
+      Out[Id] = computeElement<Op>(Lhs.Data[Id], Rhs.Data[Id]);
+  else if (Lhs.Data)
+    for (int64_t Id = 0; Id < Size; ++Id)
+      Out[Id] = computeElement<Op>(Lhs.Data[Id], Rhs.Scalar);
+  else
+    for (int64_t Id = 0; Id < Size; ++Id)
+      Out[Id] = computeElement<Op>(Lhs.Scalar, Rhs.Data[Id]);
+}
+
+inline bool hasZero(ElementOperand Operand, int64_t Size) {
+  if (!Operand.Data)
+    return !Operand.Scalar;
+  return std::find(Operand.Data, Operand.Data + Size, 0) !=
+         Operand.Data + Size;
+}
+
+} // namespace detail
+
+// Evaluates an element-wise expression block by block: every operator is
+// applied to a whole block of the elements by a loop the compiler vectorizes,
+// and the intermediate blocks stay in the cache. The last operator writes
+// right to the destination, so no array is allocated for the intermediate
+// values.
+class ElementWiseKernel final {
+public:
+  static constexpr int64_t BlockSize = 512;
+
+  explicit ElementWiseKernel(std::span<const ElementStep> ExprSteps)
+      : Steps(ExprSteps) {
+    unsigned Depth = 0, MaxDepth = 0;
+    for (auto &Step : Steps) {
+      Depth = Step.IsOperand ? Depth + 1 : Depth - 1;
+      MaxDepth = std::max(MaxDepth, Depth);
+    }
+    Stack.reserve(MaxDepth);
+    Buffers.resize(MaxDepth * BlockSize);
+  }
+
+  // Writes Size elements of the expression to Dest, the arrays of Operands
+  // must have Size elements as well. Returns the index of the step that
+  // divides by zero, nothing is computed after it.
+  std::optional<unsigned> run(std::span<const ElementOperand> Operands,
+                              int32_t *Dest, int64_t Size) {
+    for (int64_t Begin = 0; Begin < Size; Begin += BlockSize) {
+      auto Count = std::min(BlockSize, Size - Begin);
+      Stack.clear();
+      for (unsigned StepID = 0; StepID < Steps.size(); ++StepID) {
+        auto &Step = Steps[StepID];
+        if (Step.IsOperand) {
+          auto Operand = Operands[Step.Operand];
+          if (Operand.Data)
+            Operand.Data += Begin;
+          Stack.push_back(Operand);
+          continue;
+        }
+        auto Rhs = Stack.back();
+        Stack.pop_back();
+        auto &Lhs = Stack.back();
+        if ((Step.Op == ElementOp::Div || Step.Op == ElementOp::Rem) &&
+            detail::hasZero(Rhs, Count))
+          return StepID;
+        detail::dispatchElementOp(Step.Op, [&](auto Op) {
+          if (!Lhs.Data && !Rhs.Data) {
+            Lhs.Scalar = detail::computeElement<Op()>(Lhs.Scalar, Rhs.Scalar);
+            return;
+          }
+          auto *Out = StepID + 1 == Steps.size()
+                          ? Dest + Begin
+                          : Buffers.data() + (Stack.size() - 1) * BlockSize;
+          detail::applyToBlock<Op()>(Lhs, Rhs, Out, Count);
+          Lhs = {Out, 0};
+        });
+      }
+      auto Result = Stack.back();
+      if (!Result.Data)
+        std::fill_n(Dest + Begin, Count, Result.Scalar);
+      else if (Result.Data != Dest + Begin)
+        std::copy_n(Result.Data, Count, Dest + Begin);
+    }
+    return std::nullopt;
+  }
+
+private:
+  std::span<const ElementStep> Steps;
+  std::vector<ElementOperand> Stack;
+  // One block for every depth of the stack
+  std::vector<int32_t> Buffers;
+};
+
+} // namespace runtime
+} // namespace paracl
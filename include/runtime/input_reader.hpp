@@ -0,0 +1,129 @@
+#pragma once
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <limits>
+#include <memory>
+
+namespace paracl {
+namespace runtime {
+
+// The input of the read values (?) shared by all the engines and the runtime
+// library of the compiled programs. A regular file is mapped into the memory
+// at once, other inputs (pipes, terminals) are read by large chunks. The
+// integers are parsed by hand, the same way as operator>> of std::istream does
+// in the "C" locale.
+class InputReader final {
+public:
+  // The descriptor is closed by the reader if ShouldClose is set
+  explicit InputReader(int FD, bool ShouldClose = false)
+      : FD(FD), ShouldClose(ShouldClose) {
+    struct stat Stat;
+    if (::fstat(FD, &Stat) || !S_ISREG(Stat.st_mode) || !Stat.st_size)
+      return;
+    auto *Mapped =
+        ::mmap(nullptr, Stat.st_size, PROT_READ, MAP_PRIVATE, FD, 0);
+    if (Mapped == MAP_FAILED)
+      return;
+    MappedSize = Stat.st_size;
+    Pos = static_cast<const char *>(Mapped);
+    End = Pos + MappedSize;
+    IsEOF = true;
+  }
+
+  InputReader(const InputReader &) = delete;
+  InputReader &operator=(const InputReader &) = delete;
+
+  ~InputReader() {
+    if (MappedSize)
+      ::munmap(const_cast<char *>(End - MappedSize), MappedSize);
+    if (ShouldClose)
+      ::close(FD);
+  }
+
+  // Reads the next integer to Val. Returns false if there is no integer at the
+  // current position (non-integer data, the end of the input or an overflow).
+  bool readInt(int32_t &Val) {
+    int Char = peekChar();
+    while (isSpace(Char)) {
+      ++Pos;
+      Char = peekChar();
+    }
+
+    bool IsNegative = Char == '-';
+    if (IsNegative || Char == '+') {
+      ++Pos;
+      Char = peekChar();
+    }
+    if (!isDigit(Char))
+      return false;
+
+    // The digits are consumed even after the overflow, as the streams do
+    constexpr uint64_t MaxAbsVal =
+        uint64_t(std::numeric_limits<int32_t>::max()) + 1;
+    uint64_t AbsVal = 0;
+    do {
+      AbsVal = AbsVal * 10 + (Char - '0');
+      if (AbsVal > MaxAbsVal)
+        AbsVal = MaxAbsVal + 1;
+      ++Pos;
+      Char = peekChar();
+    } while (isDigit(Char));
+
+    if (AbsVal > MaxAbsVal - !IsNegative)
+      return false;
+    Val = static_cast<int32_t>(IsNegative ? 0 - AbsVal : AbsVal);
+    return true;
+  }
+
+private:
+  static constexpr unsigned ChunkSize = 1 << 16;
+
+  static bool isDigit(int Char) { return unsigned(Char - '0') < 10; }
+
+  static bool isSpace(int Char) {
+    return Char == ' ' || unsigned(Char - '\t') <= '\r' - '\t';
+  }
+
+  // Returns the character at the current position or -1 at the end of the
+  // input
+  int peekChar() {
+    if (Pos == End && !refill())
+      return -1;
+    return static_cast<unsigned char>(*Pos);
+  }
+
+  // Reads the next chunk of the input, a terminal gives one line at a time
+  bool refill() {
+    if (IsEOF)
+      return false;
+    if (!Chunk)
+      Chunk = std::make_unique<char[]>(ChunkSize);
+    ssize_t ReadSize = 0;
+    do
+      ReadSize = ::read(FD, Chunk.get(), ChunkSize);
+    while (ReadSize < 0 && errno == EINTR);
+    if (ReadSize <= 0) {
+      IsEOF = true;
+      return false;
+    }
+    Pos = Chunk.get();
+    End = Pos + ReadSize;
+    return true;
+  }
+
+  int FD;
+  bool ShouldClose;
+  bool IsEOF = false;
+  std::unique_ptr<char[]> Chunk;
+  size_t MappedSize = 0;
+  const char *Pos = nullptr;
+  const char *End = nullptr;
+};
+
+} // namespace runtime
+} // namespace paracl
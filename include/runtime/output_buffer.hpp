@@ -0,0 +1,137 @@
+#pragma once
+
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <ostream>
+
+namespace paracl {
+namespace runtime {
+
+// The output of the printed values shared by all the engines and the runtime
+// library of the compiled programs. The values are formatted into a large
+// buffer that is written to the stream at once, so the printing isn't bound by
+// the stream operators and the system calls. The buffer is flushed when it's
+// full, before the reads from a terminal and at the exit (including the exit
+// on an error), so no output is lost.
+class OutputBuffer final {
+public:
+  explicit OutputBuffer(std::ostream &Os)
+      : Os(Os), Buffer(std::make_unique<char[]>(Capacity)) {
+    registerLiveBuffer();
+  }
+
+  OutputBuffer(const OutputBuffer &) = delete;
+  OutputBuffer &operator=(const OutputBuffer &) = delete;
+
+  ~OutputBuffer() {
+    flush();
+    unregisterLiveBuffer();
+  }
+
+  // Prints Val in the decimal notation followed by a newline
+  void printInt(int32_t Val) {
+    if (Capacity - Size < MaxIntLength)
+      flushBuffer();
+    // The digits are formatted from the end by pairs, the absolute value is
+    // unsigned because -INT32_MIN doesn't fit into int32_t
+    char Digits[MaxIntLength];
+    auto *End = Digits + MaxIntLength;
+    auto *Pos = End;
+    *--Pos = '\n';
+    auto AbsVal = Val < 0 ? 0u - static_cast<uint32_t>(Val)
+                          : static_cast<uint32_t>(Val);
+    while (AbsVal >= 100) {
+      Pos -= 2;
+      std::memcpy(Pos, DigitPairs + AbsVal % 100 * 2, 2);
+      AbsVal /= 100;
+    }
+    if (AbsVal >= 10) {
+      Pos -= 2;
+      std::memcpy(Pos, DigitPairs + AbsVal * 2, 2);
+    } else {
+      *--Pos = static_cast<char>('0' + AbsVal);
+    }
+    if (Val < 0)
+      *--Pos = '-';
+    std::memcpy(Buffer.get() + Size, Pos, End - Pos);
+    Size += End - Pos;
+  }
+
+  // Prints the Num values starting at Vals one per line in a single pass
+  void printInts(const int32_t *Vals, size_t Num) {
+    for (const auto *End = Vals + Num; Vals != End; ++Vals)
+      printInt(*Vals);
+  }
+
+  // Writes the buffered output to the stream and flushes the stream
+  void flush() {
+    flushBuffer();
+    Os.flush();
+  }
+
+  // The printed values have to be seen before the user types the input, the
+  // reads from a file or a pipe don't need it
+  void flushBeforeInput() {
+    static const bool IsInteractive = ::isatty(STDIN_FILENO);
+    if (IsInteractive)
+      flush();
+  }
+
+private:
+  // '-2147483648\n'
+  static constexpr unsigned MaxIntLength = 12;
+  static constexpr unsigned Capacity = 1 << 16;
+  static constexpr const char *DigitPairs =
+      "0001020304050607080910111213141516171819"
+      "2021222324252627282930313233343536373839"
+      "4041424344454647484950515253545556575859"
+      "6061626364656667686970717273747576777879"
+      "8081828384858687888990919293949596979899";
+
+  void flushBuffer() {
+    if (!Size)
+      return;
+    Os.write(Buffer.get(), Size);
+    Size = 0;
+  }
+
+  // The live buffers are kept in a list, so they are flushed at the exit() that
+  // skips the destructors of the local objects
+  void registerLiveBuffer() {
+    static const bool IsHookSet = !std::atexit(flushLiveBuffers);
+    (void)IsHookSet;
+    Next = LiveBuffers;
+    if (Next)
+      Next->Prev = this;
+    LiveBuffers = this;
+  }
+
+  void unregisterLiveBuffer() {
+    if (Prev)
+      Prev->Next = Next;
+    else
+      LiveBuffers = Next;
+    if (Next)
+      Next->Prev = Prev;
+  }
+
+  static void flushLiveBuffers() {
+    for (auto *Live = LiveBuffers; Live; Live = Live->Next)
+      Live->flush();
+  }
+
+  static inline OutputBuffer *LiveBuffers = nullptr;
+
+  std::ostream &Os;
+  std::unique_ptr<char[]> Buffer;
+  unsigned Size = 0;
+  OutputBuffer *Prev = nullptr;
+  OutputBuffer *Next = nullptr;
+};
+
+} // namespace runtime
+} // namespace paracl
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace paracl {
+namespace runtime {
+
+// The threads executing the iterations of the parallel loops (pfor) of all the
+// engines and of the compiled programs. The range of the iterations is split
+// lazily: a worker halves its range until it isn't larger than the grain and
+// keeps the upper halves in its own deque, the idle workers steal the oldest
+// (the largest) ranges from the other deques. The thread that starts the loop
+// works as the worker 0 until all the iterations are done. The loops started
+// by the iterations are executed by the current thread.
+class ThreadPool final {
+public:
+  // Executes the iterations [Begin, End). WorkerID is less than the number of
+  // the workers, so it may index the data of the worker.
+  using TaskTy = void (*)(void *Ctx, unsigned WorkerID, int64_t Begin,
+                          int64_t End);
+
+  // The pool is created on the first use and never destroyed, so the program
+  // may exit while the threads wait for the work. The number of the workers is
+  // taken from PARACL_NUM_THREADS or the number of the hardware threads.
+  static ThreadPool &get() {
+    static auto *Pool = new ThreadPool(getDefaultNumWorkers());
+    return *Pool;
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  unsigned getNumWorkers() const noexcept { return NumWorkers; }
+
+  void parallelFor(int64_t Begin, int64_t End, TaskTy Task, void *Ctx) {
+    if (Begin >= End)
+      return;
+    if (CurrWorkerID != NotAWorker || NumWorkers == 1) {
+      Task(Ctx, CurrWorkerID == NotAWorker ? 0 : CurrWorkerID, Begin, End);
+      return;
+    }
+
+    std::lock_guard Launch(LaunchMutex);
+    Job = {Task, Ctx,
+           std::max<int64_t>((End - Begin) / (NumWorkers * ChunksPerWorker),
+                             1)};
+    Remaining.store(End - Begin, std::memory_order_relaxed);
+    Queues[0].push({Begin, End});
+    {
+      std::lock_guard Lock(Mutex);
+      IsJobActive = true;
+      ++Generation;
+    }
+    WorkAvailable.notify_all();
+
+    CurrWorkerID = 0;
+    runJob(0);
+    CurrWorkerID = NotAWorker;
+
+    // The workers may still look for the work, the job can't be replaced
+    // until they leave it
+    std::unique_lock Lock(Mutex);
+    IsJobActive = false;
+    JobLeft.wait(Lock, [this] { return !ActiveWorkers; });
+  }
+
+  template <typename FuncTy>
+  void parallelFor(int64_t Begin, int64_t End, FuncTy &Body) {
+    parallelFor(
+        Begin, End,
+        [](void *Ctx, unsigned WorkerID, int64_t From, int64_t To) {
+          (*static_cast<FuncTy *>(Ctx))(WorkerID, From, To);
+        },
+        &Body);
+  }
+
+private:
+  static constexpr unsigned NotAWorker = ~0u;
+  // The number of the ranges a worker gets on average, so the workers that
+  // finish first have something to steal
+  static constexpr int64_t ChunksPerWorker = 8;
+
+  struct Range final {
+    int64_t Begin;
+    int64_t End;
+  };
+
+  struct JobInfo final {
+    TaskTy Task = nullptr;
+    void *Ctx = nullptr;
+    int64_t Grain = 1;
+  };
+
+  struct alignas(64) RangeQueue final {
+    void push(Range R) {
+      std::lock_guard Lock(Mutex);
+      Ranges.push_back(R);
+    }
+
+    bool pop(Range &R) {
+      std::lock_guard Lock(Mutex);
+      if (Ranges.empty())
+        return false;
+      R = Ranges.back();
+      Ranges.pop_back();
+      return true;
+    }
+
+    bool steal(Range &R) {
+      std::lock_guard Lock(Mutex);
+      if (Ranges.empty())
+        return false;
+      R = Ranges.front();
+      Ranges.pop_front();
+      return true;
+    }
+
+    std::mutex Mutex;
+    std::deque<Range> Ranges;
+  };
+
+  explicit ThreadPool(unsigned NumWorkers)
+      : NumWorkers(NumWorkers),
+        Queues(std::make_unique<RangeQueue[]>(NumWorkers)) {
+    for (unsigned ID = 1; ID < NumWorkers; ++ID)
+      std::thread(&ThreadPool::workerLoop, this, ID).detach();
+  }
+
+  static unsigned getDefaultNumWorkers() {
+    if (auto *Env = std::getenv("PARACL_NUM_THREADS"))
+      if (auto Num = std::strtoul(Env, nullptr, 10); Num > 0)
+        return Num;
+    return std::max(std::thread::hardware_concurrency(), 1u);
+  }
+
+  void workerLoop(unsigned ID) {
+    CurrWorkerID = ID;
+    uint64_t SeenGeneration = 0;
+    for (;;) {
+      {
+        std::unique_lock Lock(Mutex);
+        WorkAvailable.wait(Lock, [&] {
+          return IsJobActive && Generation != SeenGeneration;
+        });
+        SeenGeneration = Generation;
+        ++ActiveWorkers;
+      }
+      runJob(ID);
+      {
+        std::lock_guard Lock(Mutex);
+        --ActiveWorkers;
+      }
+      JobLeft.notify_all();
+    }
+  }
+
+  void runJob(unsigned ID) {
+    Range R;
+    while (Remaining.load(std::memory_order_acquire)) {
+      if (!Queues[ID].pop(R) && !steal(ID, R)) {
+        std::this_thread::yield();
+        continue;
+      }
+      while (R.End - R.Begin > Job.Grain) {
+        auto Middle = R.Begin + (R.End - R.Begin) / 2;
+        Queues[ID].push({Middle, R.End});
+        R.End = Middle;
+      }
+      Job.Task(Job.Ctx, ID, R.Begin, R.End);
+      Remaining.fetch_sub(R.End - R.Begin, std::memory_order_acq_rel);
+    }
+  }
+
+  bool steal(unsigned ID, Range &R) {
+    for (unsigned Step = 1; Step < NumWorkers; ++Step)
+      if (Queues[(ID + Step) % NumWorkers].steal(R))
+        return true;
+    return false;
+  }
+
+  static inline thread_local unsigned CurrWorkerID = NotAWorker;
+
+  unsigned NumWorkers;
+  std::unique_ptr<RangeQueue[]> Queues;
+  JobInfo Job;
+  // The number of the iterations of the job that aren't executed yet
+  std::atomic<int64_t> Remaining = 0;
+
+  std::mutex LaunchMutex;
+  std::mutex Mutex;
+  std::condition_variable WorkAvailable;
+  std::condition_variable JobLeft;
+  bool IsJobActive = false;
+  uint64_t Generation = 0;
+  unsigned ActiveWorkers = 0;
+};
+
+// Calls Body(Ctx, From, To) for the parts of the iterations [Begin, End) of
+// the outlined body of pfor
+using LoopBodyTy = void (*)(void *Ctx, int32_t From, int32_t To);
+
+inline void parallelFor(LoopBodyTy Body, void *Ctx, int32_t Begin,
+                        int32_t End) {
+  auto RunRange = [Body, Ctx](unsigned, int64_t From, int64_t To) {
+    Body(Ctx, From, To);
+  };
+  ThreadPool::get().parallelFor(Begin, End, RunRange);
+}
+
+namespace detail {
+inline std::mutex ErrorMutex;
+} // namespace detail
+
+// Reports a runtime error of the program and exits. The iterations of pfor may
+// fail on several threads at once: the first failing thread calls Report,
+// which flushes the output and prints the error, the others wait for the exit.
+// The workers may still run, so the static objects aren't destroyed.
+template <typename FuncTy> [[noreturn]] void exitWithError(FuncTy Report) {
+  detail::ErrorMutex.lock();
+  Report();
+  std::_Exit(1);
+}
+
+} // namespace runtime
+} // namespace paracl
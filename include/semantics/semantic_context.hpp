@@ -78,48 +78,27 @@ public:
     return getDeclScopeFor(TabKey.Name, TabKey.CurrScope) != nullptr;
   }
 
-  // Checks if a key exists with the type Type.
-  bool containsKeyWithType(PtrType Ty) const {
-    return llvm::any_of(llvm::make_second_range(NamesInfo),
-                        [Ty](auto &&InfoTy) { return Ty == InfoTy; });
-  }
-
 protected:
   llvm::DenseMap<SymTabKey, PtrType> NamesInfo;
 };
 
-using TypeID = PCLType::TypeID;
-
-template <TypeID ID> struct TypeFromID;
-
-template <> struct TypeFromID<TypeID::Int32> {
-  using Type = IntegerTy;
-};
-
-template <> struct TypeFromID<TypeID::PresetArray> {
-  using Type = ArrayTy;
-};
-
-template <> struct TypeFromID<TypeID::UniformArray> {
-  using Type = ArrayTy;
-};
-
-template <TypeID ID> using TypeFromIDTy = typename TypeFromID<ID>::Type;
-
 template <typename Ty> class SymTable;
 
 // Specialization for working with the Paracl language interpreter,
-// incorporating a basic type manager for handling created types.
+// incorporating the type context that owns the created types.
 template <> class SymTable<PCLType> : public SymTableBase<PCLType> {
 public:
-  template <TypeID ID> TypeFromIDTy<ID> *createType() {
-    Types.emplace_back(std::make_unique<TypeFromIDTy<ID>>(ID));
-    assert(!Types.empty());
-    return static_cast<TypeFromIDTy<ID> *>(Types.back().get());
+  using TypeID = PCLType::TypeID;
+
+  IntegerTy *getInt32Ty() noexcept { return Types.getInt32Ty(); }
+
+  ArrayTy *getArrayTy(TypeID ArrID, PCLType *ContainedType,
+                      std::optional<unsigned> Size = std::nullopt) {
+    return Types.getArrayTy(ArrID, ContainedType, Size);
   }
 
 private:
-  llvm::SmallVector<std::unique_ptr<ValueType>> Types;
+  TypeContext Types;
 };
 
 // To work with code generation, we only need access methods of the SymTableBase
@@ -159,9 +138,20 @@ protected:
 template <typename ValueTy> class ValueManager;
 
 // This is a specialization for the interpreter. It includes the creation and
-// storage of PCLValue objects.
+// storage of PCLValue objects. The values are stored in a stack of regions:
+// the interpreter opens a region when it enters a block and releases all the
+// values created in the block at once when it leaves it.
 template <> class ValueManager<PCLValue> : public ValueManagerBase<PCLValue> {
 public:
+  using RegionMark = unsigned;
+
+  RegionMark openRegion() const noexcept { return Values.size(); }
+
+  void releaseRegion(RegionMark Mark) {
+    assert(Mark <= Values.size());
+    Values.truncate(Mark);
+  }
+
   template <typename ValueTy, typename... ArgTys>
   ValueTy *createValueFor(const SymTabKey &DeclKey, ArgTys &&...Args) {
     auto ValuePtr = std::make_unique<ValueTy>(std::forward<ArgTys>(Args)...);
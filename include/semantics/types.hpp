@@ -1,9 +1,14 @@
 #pragma once
 
+#include <llvm/ADT/DenseMap.h>
 #include <llvm/ADT/Hashing.h>
 #include <llvm/ADT/SmallString.h>
 #include <llvm/ADT/SmallVector.h>
 
+#include <memory>
+#include <optional>
+#include <tuple>
+
 namespace paracl {
 
 namespace ast {
@@ -92,25 +97,22 @@ protected:
   TypeID ID;
 };
 
-inline bool operator==(PCLType Lhs, PCLType Rhs) {
-  return Lhs.getTypeID() == Rhs.getTypeID();
-}
-
 class IntegerTy : public PCLType {
 public:
   IntegerTy(TypeID IntID) : PCLType(IntID) {}
 };
 
+// Array types are immutable and interned by the TypeContext, so two arrays
+// with the same kind, contained type and size share one type object.
 class ArrayTy : public PCLType {
 public:
-  ArrayTy(TypeID ArrID) : PCLType(ArrID) {}
+  ArrayTy(TypeID ArrID, PCLType *ContainedType,
+          std::optional<unsigned> NumberOfElements)
+      : PCLType(ArrID), NumberOfElements(NumberOfElements),
+        ContainedType(ContainedType) {}
 
   PCLType *getContainedType() const { return ContainedType; }
   std::optional<unsigned> getSize() const { return NumberOfElements; }
-  void setSize(unsigned ArrSz) { NumberOfElements = ArrSz; }
-  void setContainedType(PCLType *TypeToContain) {
-    ContainedType = TypeToContain;
-  }
 
 protected:
   // Use optional here because we want to be able to handle simple cases of
@@ -122,4 +124,31 @@ protected:
   PCLType *ContainedType = nullptr;
 };
 
+// Owns all the types of the ParaCL program. Every type is created only once,
+// so the types can be compared by pointers.
+class TypeContext final {
+  using TypeID = PCLType::TypeID;
+  // (kind, contained type, has size, size)
+  using ArrayKeyTy = std::tuple<unsigned, PCLType *, unsigned, unsigned>;
+
+public:
+  TypeContext() : Int32Ty(TypeID::Int32) {}
+
+  IntegerTy *getInt32Ty() noexcept { return &Int32Ty; }
+
+  ArrayTy *getArrayTy(TypeID ArrID, PCLType *ContainedType,
+                      std::optional<unsigned> Size = std::nullopt) {
+    assert(ArrID != TypeID::Int32);
+    auto &Entry = ArrayTypes[{static_cast<unsigned>(ArrID), ContainedType,
+                              Size.has_value(), Size.value_or(0)}];
+    if (!Entry)
+      Entry = std::make_unique<ArrayTy>(ArrID, ContainedType, Size);
+    return Entry.get();
+  }
+
+private:
+  IntegerTy Int32Ty;
+  llvm::DenseMap<ArrayKeyTy, std::unique_ptr<ArrayTy>> ArrayTypes;
+};
+
 } // namespace paracl
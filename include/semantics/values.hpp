@@ -1,14 +1,23 @@
 #pragma once
 
+#include <llvm/ADT/ArrayRef.h>
 #include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallVector.h>
 #include <llvm/IR/Value.h>
 
+#include <algorithm>
 #include <concepts>
+#include <cstdint>
 #include <iostream>
 #include <iterator>
+#include <memory>
+#include <optional>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
+#include "element_wise.hpp"
+#include "output_buffer.hpp"
 #include "types.hpp"
 
 namespace paracl {
@@ -22,13 +31,6 @@ concept DerivedFromValueWrapper = std::derived_from<T, ValueWrapper>;
 template <typename T>
 concept DerivedFromPCLValue = std::derived_from<T, PCLValue>;
 
-template <typename Iter>
-concept PCLValuePointerIter =
-    std::forward_iterator<Iter> &&
-    std::is_pointer_v<typename std::iterator_traits<Iter>::value_type> &&
-    DerivedFromPCLValue<
-        std::remove_pointer_t<typename std::iterator_traits<Iter>::value_type>>;
-
 template <typename T>
 concept IsPureType = std::is_same_v<std::decay_t<T>, T>;
 
@@ -77,7 +79,7 @@ public:
 
   virtual PCLValue *clone() const = 0;
 
-  virtual void print(std::ostream &Os) const = 0;
+  virtual void print(runtime::OutputBuffer &Out) const = 0;
 
 protected:
   PCLValue(PCLType *Ty) : Ty(Ty) {}
@@ -91,13 +93,16 @@ public:
 
   IntegerTy *getType() const override { return static_cast<IntegerTy *>(Ty); }
 
-  void print(std::ostream &Os) const override { Os << Val << '\n'; }
+  void print(runtime::OutputBuffer &Out) const override {
+    Out.printInt(Val);
+  }
 
   int getValue() const noexcept { return Val; }
   void setValue(IntegerVal *NewValue) noexcept {
     assert(NewValue);
     Val = NewValue->getValue();
   }
+  void setValue(int NewValue) noexcept { Val = NewValue; }
 
   IntegerVal *clone() const override {
     return new IntegerVal(Val, static_cast<IntegerTy *>(Ty));
@@ -109,193 +114,291 @@ private:
   int Val;
 };
 
+// Arrays of any dimension are stored in the row-major order, the same way the
+// CodeGenVisitor lays them out. The array is split into the rows of its first
+// dimension (a one-dimensional array is a single row), and each row is a
+// contiguous buffer of integers. The rows are shared copy-on-write between the
+// arrays and the rows of one array: a row is copied only when it's written
+// while someone else still refers to it. A null row means that all its
+// elements are equal to Fill, so repeat() doesn't touch the memory at all
+// until the row is written.
 class ArrayBase : public PCLValue {
+public:
+  using ElemTy = int32_t;
+  using ShapeTy = llvm::SmallVector<unsigned, 2>;
+  using RowTy = std::shared_ptr<ElemTy[]>;
+
 protected:
-  ArrayBase(ArrayTy *Ty, unsigned Size)
-      : PCLValue(Ty), Size(Size), Data(new PCLValue *[Size]()) {
-    Ty->setSize(Size);
+  ArrayBase(ArrayTy *Ty, ShapeTy ArrShape)
+      : PCLValue(Ty), Shape(std::move(ArrShape)), Strides(Shape.size()) {
+    assert(!Shape.empty());
+    Size = 1;
+    for (unsigned Dim = Shape.size(); Dim-- > 0;) {
+      Strides[Dim] = Size;
+      Size *= Shape[Dim];
+    }
+    auto NumRows = getRank() > 1 ? Shape.front() : 1;
+    RowSize = getRank() > 1 ? Strides.front() : Size;
+    Rows.resize(NumRows);
   }
 
-  ArrayBase(const ArrayBase &) = delete;
-  ArrayBase(ArrayBase &&Rhs)
-      : PCLValue(std::exchange(Rhs.Ty, nullptr)),
-        Size(std::exchange(Rhs.Size, 0)),
-        Data(std::exchange(Rhs.Data, nullptr)) {}
+  ArrayBase(const ArrayBase &) = default;
+  ArrayBase(ArrayBase &&) = delete;
   ArrayBase &operator=(const ArrayBase &) = delete;
-  ArrayBase &operator=(ArrayBase &&Rhs) {
-    if (this == std::addressof(Rhs))
-      return *this;
+  ArrayBase &operator=(ArrayBase &&) = delete;
 
-    Ty = std::exchange(Rhs.Ty, nullptr);
-    Size = std::exchange(Rhs.Size, 0);
-    Data = std::exchange(Rhs.Data, nullptr);
+public:
+  ArrayTy *getType() const override { return static_cast<ArrayTy *>(Ty); }
 
-    return *this;
+  void print(runtime::OutputBuffer &Out) const override {
+    for (auto &Row : Rows)
+      if (Row)
+        Out.printInts(Row.get(), RowSize);
+      else
+        for (unsigned Id = 0; Id < RowSize; ++Id)
+          Out.printInt(Fill);
   }
 
-  ~ArrayBase() override {
-    if (Data) {
-      destroy();
-    }
+  // Returns the value of the element addressed by the indexes of all the
+  // dimensions
+  ElemTy load(llvm::ArrayRef<unsigned> Indices) const {
+    auto [RowID, Offset] = locate(Indices);
+    auto &Row = Rows[RowID];
+    return Row ? Row[Offset] : Fill;
   }
 
-  ArrayTy *getType() const override { return static_cast<ArrayTy *>(Ty); }
-
-  void print(std::ostream &Os) const override {
-    for (unsigned Id = 0; Id < Size; ++Id) {
-      assert(Data[Id]);
-      Data[Id]->print(Os);
-    }
+  // Returns the element for writing, the row is materialized if it's needed
+  ElemTy &store(llvm::ArrayRef<unsigned> Indices) {
+    auto [RowID, Offset] = locate(Indices);
+    return getUniqueRow(RowID)[Offset];
   }
 
-  bool resizeIfNoData(unsigned NewSize) {
-    auto HasData = std::any_of(
-        Data, Data + Size, [](auto *CurrVal) { return CurrVal != nullptr; });
-    if (HasData)
-      return false;
-
-    delete[] Data;
-    Size = NewSize;
-    Data = new PCLValue *[Size]();
+  // Writes all the elements in the row-major order starting from Dest.
+  // Returns the iterator past the last written element.
+  ElemTy *copyTo(ElemTy *Dest) const {
+    for (auto &Row : Rows)
+      Dest = Row ? std::copy_n(Row.get(), RowSize, Dest)
+                 : std::fill_n(Dest, RowSize, Fill);
+    return Dest;
+  }
 
-    return true;
+  // Materializes the rows that are shared or not written yet, so the elements
+  // may be stored by several threads at once
+  void makeRowsUnique() {
+    for (unsigned RowID = 0; RowID < Rows.size(); ++RowID)
+      getUniqueRow(RowID);
   }
 
-public:
-  PCLValue *operator[](unsigned Id) { return Data[Id]; }
+  // Returns the number of the integers in all the dimensions
+  unsigned getSize() const noexcept { return Size; }
+  unsigned getRank() const noexcept { return Shape.size(); }
+  const ShapeTy &getShape() const noexcept { return Shape; }
 
-  PCLValue **begin() { return Data; }
-  PCLValue **begin() const { return Data; }
-  PCLValue **end() { return Data + Size; }
-  PCLValue **end() const { return Data + Size; }
+  // The rows hold the elements in the row-major order, all the elements of a
+  // null row are equal to getFill()
+  llvm::ArrayRef<RowTy> getRows() const noexcept { return Rows; }
+  unsigned getRowSize() const noexcept { return RowSize; }
+  ElemTy getFill() const noexcept { return Fill; }
 
-  void copy(PCLValue **DestIter) {
-    std::transform(begin(), end(), DestIter,
-                   [](auto *CurrVal) { return CurrVal->clone(); });
+protected:
+  std::pair<unsigned, unsigned> locate(llvm::ArrayRef<unsigned> Indices) const {
+    assert(Indices.size() == getRank());
+    if (getRank() == 1) {
+      assert(Indices.front() < Size);
+      return {0, Indices.front()};
+    }
+    unsigned Offset = 0;
+    for (unsigned Dim = 1; Dim < getRank(); ++Dim)
+      Offset += Indices[Dim] * Strides[Dim];
+    assert(Indices.front() < Rows.size() && Offset < RowSize);
+    return {Indices.front(), Offset};
   }
 
-  unsigned getSize() const noexcept { return Size; }
+  ElemTy *getUniqueRow(unsigned RowID) {
+    auto &Row = Rows[RowID];
+    if (!Row) {
+      Row = std::make_shared_for_overwrite<ElemTy[]>(RowSize);
+      std::fill_n(Row.get(), RowSize, Fill);
+    } else if (Row.use_count() > 1) {
+      auto Copy = std::make_shared_for_overwrite<ElemTy[]>(RowSize);
+      std::copy_n(Row.get(), RowSize, Copy.get());
+      Row = std::move(Copy);
+    }
+    return Row.get();
+  }
 
-  void destroy() {
-    for (auto &&ArrVal : llvm::make_range(begin(), end())) {
-      delete ArrVal;
-      ArrVal = nullptr;
+  // Makes every row of the array refer to the contents of Initer, which must
+  // have RowSize elements.
+  void shareRows(const ArrayBase &Initer) {
+    assert(Initer.getSize() == RowSize);
+    Fill = Initer.Fill;
+    RowTy Shared;
+    if (Initer.Rows.size() == 1) {
+      Shared = Initer.Rows.front();
+    } else if (llvm::any_of(Initer.Rows, [](auto &Row) { return Row; })) {
+      Shared = std::make_shared_for_overwrite<ElemTy[]>(RowSize);
+      Initer.copyTo(Shared.get());
     }
-    delete[] Data;
-    Data = nullptr;
-    Size = 0;
+    std::fill(Rows.begin(), Rows.end(), Shared);
   }
 
-protected:
+  ShapeTy Shape;
+  ShapeTy Strides;
   unsigned Size = 0;
-  PCLValue **Data = nullptr;
+  unsigned RowSize = 0;
+  std::vector<RowTy> Rows;
+  ElemTy Fill = 0;
 };
 
-class PresetArrayVal : public ArrayBase {
-  using TypeID = PCLType::TypeID;
+// The runtime value of the interpreter packed into one 64-bit word. Integers
+// are stored unboxed in the upper half with the lowest bit set, arrays are
+// referenced by their (aligned) pointers. Zero stands for the absent value.
+class TaggedValue final {
+  static constexpr uint64_t IntTag = 1;
 
 public:
-  template <PCLValuePointerIter Iter>
-  PresetArrayVal(Iter Begin, Iter End, ArrayTy *Ty)
-      : ArrayBase(Ty, std::distance(Begin, End)) {
-    resizeForConcatIfNeed(Begin, End);
-    ArrayBase *ArrPtr = nullptr;
-    for (unsigned ArrIndex = 0;
-         auto *AssignVal : llvm::make_range(Begin, End)) {
-      assert(AssignVal);
-      auto *Type = AssignVal->getType();
-      switch (Type->getTypeID()) {
-      case TypeID::UniformArray:
-      case TypeID::PresetArray:
-        ArrPtr = static_cast<ArrayBase *>(AssignVal);
-        ArrPtr->copy(std::addressof(Data[ArrIndex]));
-        ArrIndex += ArrPtr->getSize();
-        break;
-      case TypeID::Int32:
-        Data[ArrIndex] = AssignVal->clone();
-        ArrIndex++;
-        break;
-      default:
-        llvm_unreachable("Unsupported type for preset array");
-      }
-    }
-    getType()->setSize(Size);
+  TaggedValue() = default;
+  TaggedValue(int32_t Val)
+      : Bits(static_cast<uint64_t>(static_cast<uint32_t>(Val)) << 32 |
+             IntTag) {}
+  TaggedValue(ArrayBase *Arr) : Bits(reinterpret_cast<uintptr_t>(Arr)) {
+    assert(!(Bits & IntTag));
   }
 
-  PresetArrayVal *clone() const override {
-    return new PresetArrayVal(Data, Data + Size, getType());
-  };
+  bool isNull() const noexcept { return Bits == 0; }
+  bool isInt() const noexcept { return Bits & IntTag; }
+  bool isArray() const noexcept { return !isNull() && !isInt(); }
 
-private:
-  // One of the initialization values of the Preset array may be another array.
-  // In this case, we need to calculate the size of the resulting array in
-  // advance.
-  template <PCLValuePointerIter Iter>
-  void resizeForConcatIfNeed(Iter Begin, Iter End) {
-    unsigned NewSize = 0;
-    std::for_each(Begin, End, [&](auto *CurrVal) {
-      auto *Type = CurrVal->getType();
-      if (Type->isArrayTy()) {
-        // Avoiding arrays of size 0
-        if (auto Sz = static_cast<ArrayBase *>(CurrVal)->getSize(); Sz)
-          NewSize += Sz;
-      } else {
-        NewSize++;
-      }
-    });
+  int32_t getInt() const noexcept {
+    assert(isInt());
+    return static_cast<int32_t>(Bits >> 32);
+  }
 
-    if (NewSize != Size) {
-      resizeIfNoData(NewSize);
-    }
+  ArrayBase *getArray() const noexcept {
+    assert(isArray());
+    return reinterpret_cast<ArrayBase *>(Bits);
   }
+
+  void print(runtime::OutputBuffer &Out) const {
+    if (isInt())
+      Out.printInt(getInt());
+    else if (isArray())
+      getArray()->print(Out);
+  }
+
+private:
+  uint64_t Bits = 0;
 };
 
-class UniformArrayVal : public ArrayBase {
+// A one-dimensional array made of the passed integers and the elements of the
+// passed arrays, e.g. array(1, Arr, 2).
+class PresetArrayVal : public ArrayBase {
 public:
-  UniformArrayVal(PCLValue *Initer, unsigned Size, ArrayTy *Ty)
-      : ArrayBase(Ty, Size), Initer(Initer) {
-    Ty->setSize(Size);
-    assert(Initer);
-    Ty->setContainedType(Initer->getType());
-    construct();
+  PresetArrayVal(llvm::ArrayRef<TaggedValue> Elems, ArrayTy *Ty)
+      : ArrayBase(Ty, {computeSize(Elems)}) {
+    // The copy of one array shares its storage
+    if (Elems.size() == 1 && Elems.front().isArray()) {
+      shareRows(*Elems.front().getArray());
+      return;
+    }
+    auto *DestIt = getUniqueRow(0);
+    for (auto Elem : Elems) {
+      if (Elem.isInt())
+        *DestIt++ = Elem.getInt();
+      else
+        DestIt = Elem.getArray()->copyTo(DestIt);
+    }
   }
 
-  UniformArrayVal(const UniformArrayVal &Rhs) = delete;
-  UniformArrayVal(UniformArrayVal &&Rhs)
-      : ArrayBase(std::move(Rhs)), Initer(std::exchange(Rhs.Initer, nullptr)) {}
-  UniformArrayVal &operator=(const UniformArrayVal &Rhs) = delete;
-  UniformArrayVal &operator=(UniformArrayVal &&Rhs) {
-    if (this == std::addressof(Rhs))
-      return *this;
-
-    Ty = std::exchange(Rhs.Ty, nullptr);
-    Size = std::exchange(Rhs.Size, 0);
-    Data = std::exchange(Rhs.Data, nullptr);
-    Initer = std::exchange(Rhs.Initer, nullptr);
+  PresetArrayVal *clone() const override { return new PresetArrayVal(*this); }
 
-    return *this;
+private:
+  static unsigned computeSize(llvm::ArrayRef<TaggedValue> Elems) {
+    unsigned Size = 0;
+    for (auto Elem : Elems) {
+      assert(!Elem.isNull());
+      Size += Elem.isInt() ? 1 : Elem.getArray()->getSize();
+    }
+    return Size;
   }
+};
 
-  ~UniformArrayVal() override {
-    destroy();
-    Initer = nullptr;
+// The array of Size copies of the initializer. If the initializer is an array,
+// its dimensions are appended to the shape, e.g. repeat(repeat(0, 5), 10) is a
+// 10 * 5 array. No element is written during the creation: all the rows refer
+// to the initializer until they are changed.
+class UniformArrayVal : public ArrayBase {
+public:
+  UniformArrayVal(TaggedValue Initer, unsigned Size, ArrayTy *Ty)
+      : ArrayBase(Ty, makeShape(Initer, Size)) {
+    if (Initer.isInt())
+      Fill = Initer.getInt();
+    else
+      shareRows(*Initer.getArray());
   }
 
   UniformArrayVal *clone() const override {
-    return new UniformArrayVal(Initer, Size, getType());
+    return new UniformArrayVal(*this);
   }
 
-  PCLValue *getIniter() noexcept { return Initer; }
-
 private:
-  void construct() {
-    assert(Initer);
-    for (auto &&ArrVal : llvm::make_range(begin(), end())) {
-      ArrVal = Initer->clone();
+  static ShapeTy makeShape(TaggedValue Initer, unsigned Size) {
+    assert(!Initer.isNull());
+    ShapeTy ArrShape{Size};
+    if (Initer.isArray())
+      llvm::append_range(ArrShape, Initer.getArray()->getShape());
+    return ArrShape;
+  }
+};
+
+// The array computed by an element-wise expression over the arrays of its
+// shape. The rows are computed one by one, the rows that aren't written in all
+// the operands are left null.
+class ElementWiseArrayVal : public ArrayBase {
+public:
+  ElementWiseArrayVal(ShapeTy ArrShape, ArrayTy *Ty)
+      : ArrayBase(Ty, std::move(ArrShape)) {}
+
+  // Computes the elements, Operands are the integers and the arrays of the
+  // same shape in the order of the operand steps. Returns the index of the
+  // step that divides by zero.
+  std::optional<unsigned> compute(runtime::ElementWiseKernel &Kernel,
+                                  llvm::ArrayRef<TaggedValue> Operands) {
+    if (!RowSize)
+      return std::nullopt;
+    llvm::SmallVector<runtime::ElementOperand, 4> RowOperands(Operands.size());
+    bool IsFillComputed = false;
+    for (unsigned RowID = 0; RowID < Rows.size(); ++RowID) {
+      bool IsFillRow = true;
+      for (auto [Operand, Value] : llvm::zip(RowOperands, Operands)) {
+        if (Value.isInt()) {
+          Operand = {nullptr, Value.getInt()};
+          continue;
+        }
+        auto *Arr = Value.getArray();
+        auto *Row = Arr->getRows()[RowID].get();
+        Operand = {Row, Arr->getFill()};
+        IsFillRow &= !Row;
+      }
+      if (IsFillRow) {
+        if (IsFillComputed)
+          continue;
+        IsFillComputed = true;
+        if (auto StepID = Kernel.run(RowOperands, &Fill, 1))
+          return StepID;
+        continue;
+      }
+      auto Row = std::make_shared_for_overwrite<ElemTy[]>(RowSize);
+      if (auto StepID = Kernel.run(RowOperands, Row.get(), RowSize))
+        return StepID;
+      Rows[RowID] = std::move(Row);
     }
+    return std::nullopt;
   }
 
-  PCLValue *Initer = nullptr;
+  ElementWiseArrayVal *clone() const override {
+    return new ElementWiseArrayVal(*this);
+  }
 };
 
 } // namespace paracl
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <llvm/ADT/BitVector.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallVector.h>
+
+#include <utility>
+
+#include "bytecode.hpp"
+#include "expression.hpp"
+#include "semantic_context.hpp"
+#include "statement.hpp"
+#include "visitor.hpp"
+
+namespace paracl {
+
+// The result of lowering an expression: the register where the value is
+// located and the register file it belongs to.
+struct VMOperand : public ValueWrapper {
+  enum class KindTy : char { None, Int, Array };
+
+  VMOperand(KindTy Kind = KindTy::None, vm::RegisterID Reg = 0)
+      : Kind(Kind), Reg(Reg) {}
+
+  bool isInt() const noexcept { return Kind == KindTy::Int; }
+  bool isArray() const noexcept { return Kind == KindTy::Array; }
+
+  KindTy Kind;
+  vm::RegisterID Reg;
+};
+
+// Lowers the validated AST into the register bytecode of the ParaCL virtual
+// machine. Variables are bound to the registers once during the lowering, so
+// the execution doesn't need any name lookups. The virtual machine has one
+// thread, so the iterations of pfor are executed one after another.
+class BytecodeCompiler : public VisitorBase {
+public:
+  using WrapperTy = VMOperand;
+  using ResultTy = WrapperTy &;
+  using KindTy = VMOperand::KindTy;
+  using TypeID = PCLType::TypeID;
+
+  ResultTy visit(ast::root_statement_block *StmBlock) override;
+  ResultTy visit(ast::statement_block *StmBlock) override;
+  ResultTy visit(ast::calc_expression *CalcExp) override;
+  ResultTy visit(ast::logic_expression *LogExp) override;
+  ResultTy visit(ast::un_operator *UnOp) override;
+  ResultTy visit(ast::number *Num) override;
+  ResultTy visit(ast::variable *Var) override;
+  ResultTy visit(ast::assignment *Assign) override;
+  ResultTy visit(ast::if_operator *If) override;
+  ResultTy visit(ast::while_operator *While) override;
+  ResultTy visit(ast::pfor_operator *PFor) override;
+  ResultTy visit(ast::read_expression *ReadExp) override;
+  ResultTy visit(ast::print_function *Print) override;
+  ResultTy visit(ast::reduce_function *Reduce) override;
+  ResultTy visit(ast::ArrayHolder *ArrStore) override;
+  ResultTy visit(ast::PresetArray *PresetArr) override;
+  ResultTy visit(ast::UniformArray *UnifArr) override;
+  ResultTy visit(ast::ArrayAccess *ArrAccess) override;
+  ResultTy visit(ast::ArrayAccessAssignment *ArrAssign) override;
+
+  vm::Program compile(ast::root_statement_block *RootBlock);
+
+private:
+  ResultTy acceptASTNode(ast::statement *Stm) override {
+    return static_cast<ResultTy>(Stm->accept(this));
+  }
+
+  ResultTy createWrapperRef(KindTy Kind = KindTy::None,
+                            vm::RegisterID Reg = 0) {
+    return VisitorBase::createWrapperRef<WrapperTy>(Kind, Reg);
+  }
+
+  // Temporary registers are reused after every statement, variable registers
+  // live until the end of the program.
+  vm::RegisterID allocateRegister();
+  vm::RegisterID allocateArrayRegister();
+  // Allocates the register of an integer variable, it's never reused
+  vm::RegisterID allocateVariableRegister();
+  void acceptStatement(ast::statement *Stm);
+
+  // Emits a jump that is taken if the condition is false. Returns the id of
+  // the jump instruction to patch the target later.
+  unsigned emitJumpIfFalse(ast::expression *Cond);
+  void patchJumpTarget(unsigned JumpID, unsigned Target);
+
+  // Makes the last instruction write its result to the To register instead of
+  // the temporary From register. Returns false if it's not possible.
+  bool retargetLastInstruction(vm::RegisterID From, vm::RegisterID To);
+  bool isVariableRegister(vm::RegisterID Reg) const;
+
+  // Evaluates the operands of the element-wise expression and emits the
+  // instruction that creates its array
+  ResultTy emitElementWise(ast::expression *Exp);
+
+  // Returns the array register and the register with the row-major offset of
+  // the accessed element.
+  std::pair<vm::RegisterID, vm::RegisterID>
+  emitElementOffset(ast::ArrayAccess *ArrAccess, bool IsStore);
+
+  vm::Program Prog;
+  SymTable<PCLType> SymTbl;
+  llvm::DenseMap<SymTabKey, VMOperand> Variables;
+  llvm::DenseMap<ast::statement_block *, llvm::SmallVector<vm::RegisterID>>
+      ArraysToFree;
+  llvm::SmallVector<vm::RegisterID> TempArrays;
+  llvm::BitVector VariableRegisters;
+  unsigned LastJumpTarget = 0;
+
+  vm::RegisterID NextRegister = 0;
+  vm::RegisterID NextArrayRegister = 0;
+  vm::RegisterID LastVariableRegister = -1;
+  vm::RegisterID LastArrayVariableRegister = -1;
+  unsigned MaxRegisters = 0;
+  unsigned MaxArrayRegisters = 0;
+};
+
+} // namespace paracl
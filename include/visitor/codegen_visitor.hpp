@@ -1,12 +1,16 @@
 #pragma once
 
 #include <llvm/ADT/StringRef.h>
+#include <llvm/IR/Operator.h>
 #include <llvm/Support/Casting.h>
 
 #include <concepts>
 #include <functional>
 
 #include "codegen.hpp"
+#include "emitter.hpp"
+#include "loop_analyzer.hpp"
+#include "optimizer.hpp"
 #include "semantic_context.hpp"
 #include "utils.hpp"
 #include "visitor.hpp"
@@ -31,6 +35,14 @@ class CodeGenVisitor : public VisitorBase {
   struct ArrayInfo final {
     SmallVector<Value *> Sizes;
     SmallVector<Value *> Data;
+    // The number of the elements between the neighbouring indexes of each
+    // dimension, starting from the outermost one. They are computed once when
+    // the array is created.
+    SmallVector<Value *> Strides;
+    // The array whose elements are repeated to fill this one if they are known
+    // only at runtime, e.g. the result of an element-wise expression. Data is
+    // empty then.
+    Value *Source = nullptr;
 
     bool isConstant() const {
       return isConstantData(Data) && isConstantData(Sizes);
@@ -52,6 +64,19 @@ class CodeGenVisitor : public VisitorBase {
     void clear() {
       clearSize();
       clearData();
+      Strides.clear();
+      Source = nullptr;
+    }
+
+    void computeStrides(IRBuilder<> &Builder, IntegerType *DataTy) {
+      // The sizes are stored starting from the innermost dimension
+      unsigned Rank = Sizes.size();
+      Strides.assign(Rank, ConstantInt::get(DataTy, 1));
+      for (unsigned Dim = Rank; Dim-- > 1;) {
+        auto *Size = Sizes[Rank - Dim - 1];
+        Strides[Dim - 1] =
+            Dim == Rank - 1 ? Size : Builder.CreateMul(Strides[Dim], Size);
+      }
     }
 
     static Value *calculateSize(IRBuilder<> &Builder, IntegerType *DataTy,
@@ -99,15 +124,35 @@ public:
   ResultTy visit(ast::statement_block *stm) override;
   ResultTy visit(ast::if_operator *stm) override;
   ResultTy visit(ast::while_operator *stm) override;
+  ResultTy visit(ast::pfor_operator *stm) override;
   ResultTy visit(ast::print_function *stm) override;
-
-  // Generate LLVM IR and write it to Os
-  void generateIRCode(ast::root_statement_block *RootBlock, raw_ostream &Os);
+  ResultTy visit(ast::reduce_function *Reduce) override;
+
+  // Generate LLVM IR, optimize it at the OptLevel and write it to Os in the
+  // format of the Kind
+  void generateCode(ast::root_statement_block *RootBlock,
+                    raw_pwrite_stream &Os,
+                    OptimizationLevel OptLevel = OptimizationLevel::O0,
+                    codegen::OutputKind Kind = codegen::OutputKind::IR);
+  // Generate LLVM IR and move the module out of the visitor
+  orc::ThreadSafeModule generateModule(ast::root_statement_block *RootBlock);
+  // Generate the module with the function FuncName that executes the loop
+  // While. The function takes the pointer to the values of LiveIns and stores
+  // their new values there when the loop ends.
+  orc::ThreadSafeModule generateLoopModule(ast::while_operator *While,
+                                           ArrayRef<LiveInVariable> LiveIns,
+                                           StringRef FuncName);
   void dumpInDotFormat(StringRef CFGName) const {
     codegen::dumpInDotFormat(*CodeGen.Mod.get(), CFGName);
   }
 
 private:
+  // The number of the elements stored at once by the fill of the heap arrays
+  static constexpr unsigned FillVectorWidth = 8;
+  // The number of the vector iterations executed at once by the element-wise
+  // loops over the arrays
+  static constexpr unsigned VectorLoopInterleaveCount = 2;
+
   IRBuilder<> &Builder() { return *CodeGen.Builder.get(); }
 
   Module &Module() { return *CodeGen.Mod.get(); }
@@ -123,9 +168,17 @@ private:
   std::pair<BasicBlock *, BasicBlock *> createStartIf();
   void createEndIf(BasicBlock *EndBlock);
 
+  // The loops are emitted in the rotated form: the condition guards the
+  // preheader and is checked again at the end of the body, which branches back
+  // to the body or to the dedicated exit block. The latch branch gets LoopID as
+  // its llvm.loop metadata.
   std::pair<BasicBlock *, BasicBlock *> createStartWhile(Value *Condition);
   void createEndWhile(Value *Condition, BasicBlock *BodyBlock,
-                      BasicBlock *EndBlock);
+                      BasicBlock *EndBlock, MDNode *LoopID = nullptr);
+
+  // Returns the new llvm.loop metadata that asks the vectorizer to vectorize
+  // and interleave the loop
+  MDNode *createVectorizeLoopID();
 
   // Generates an LLVM IR loop that increments a counter (LoopCounter) from 0 to
   // LoopLimit, invoking the provided CallLoopBody function in each iteration.
@@ -135,7 +188,7 @@ private:
   // it in the body of the loop.
   template <typename... ArgsTy>
   void
-  createUpCountLoop(Value *LoopLimit,
+  createUpCountLoop(Value *LoopLimit, MDNode *LoopID,
                     const std::function<void(Value *, ArgsTy...)> &CallLoopBody,
                     ArgsTy &&...Args) {
     auto *DataTy = CodeGen.getInt32Ty();
@@ -152,24 +205,76 @@ private:
     LoopCounter = Builder().CreateAdd(LoopCounter, ConstantInt::get(DataTy, 1));
     Builder().CreateStore(LoopCounter, AllocaCounter);
     Cond = Builder().CreateICmpSLT(LoopCounter, LoopLimit);
-    createEndWhile(Cond, BodyWhile, EndWhile);
+    createEndWhile(Cond, BodyWhile, EndWhile, LoopID);
   }
 
+  // Executes Body for every value of LoopVar from Begin to End - 1 in
+  // parallel, LoopVar is private to the iteration
+  void createParallelLoop(ast::variable *LoopVar, Value *Begin, Value *End,
+                          ast::statement *Body);
+  // Replaces the values of the other functions used by the outlined body of
+  // pfor with the fields of the context passed by the pointer Ctx. The context
+  // is filled at the insertion point of the builder. Returns the pointer to the
+  // context in the calling function.
+  Value *captureLoopContext(Function *BodyFunc, Value *Ctx);
+
   Value *createLogicAnd(ast::logic_expression *LogExp);
   Value *createLogicOr(ast::logic_expression *LogExp);
 
   Value *createArray(IntegerType *DataTy, const ArrayInfo &ArrInfo,
                      ast::statement_block *CurrScope);
+  // Creates the array of the element-wise expression Exp by one loop over the
+  // elements, the operands are evaluated before the loop
+  Value *createElementWiseArray(ast::expression *Exp,
+                                ast::statement_block *CurrScope);
+  Value *createElementOperation(runtime::ElementOp Op, Value *Lhs, Value *Rhs);
   AllocaInst *allocateLocalArray(Type *DataTy, ArrayRef<Value *> Elems,
                                  unsigned ArrSize, unsigned ElemSize);
+  // Fills the ArrSize elements of the heap array with the repeated Pattern: a
+  // single value is stored by memset or by the vector stores, a longer pattern
+  // is copied by the runtime
+  void fillHeapArray(IntegerType *DataTy, Value *Arr, Value *ArrSize,
+                     ArrayRef<Value *> Pattern, unsigned ElementSize);
+  // Fills the ArrSize elements of the array with the repeated elements of the
+  // Source array
+  void fillFromSource(IntegerType *DataTy, Value *Arr, Value *ArrSize,
+                      Value *Source);
+  // Appends the loads of the elements of the Source array to the data of the
+  // current array
+  void pushSourceElements(Value *Source);
 
   Value *getArrayAccessPtr(ast::ArrayAccess *ArrAccess);
+  // Remembers the load or the store of an array element for
+  // addArrayAliasScopes()
+  void recordArrayAccess(Instruction *Access, Value *ElemPtr) {
+    ArrayAccesses.emplace_back(Access,
+                               cast<GEPOperator>(ElemPtr)->getPointerOperand());
+  }
+  // Every array gets its own alias scope, so the accesses to the different
+  // arrays are known not to alias even if the arrays are loaded from the
+  // context of the outlined loop body
+  void addArrayAliasScopes();
+
+  // Reports the error at runtime if the Index isn't less than the Size of its
+  // dimension (-checked)
+  void createBoundsCheck(ast::ArrayAccess *ArrAccess, Value *Index,
+                         Value *Size);
+  // Reports the error by ErrorFuncName at runtime if the arrays of dot or of
+  // an element-wise expression have the different sizes
+  void createSizeCheck(ast::expression *Exp, StringRef ErrorFuncName,
+                       Value *LhsSize, Value *RhsSize);
+  // Reports the error at runtime if the Divisor is 0 (the loops compiled in
+  // the tiered mode)
+  void createDivisionCheck(ast::calc_expression *CalcExpr, Value *Divisor);
 
   LoadInst *createLocalVariable(Type *DataTy, Value *ToStore);
 
-  void printIntegerValue(Value *Val);
+  // Variables, temporaries and fixed-size arrays are allocated in the entry
+  // block of the function, so the stack doesn't grow when they are created in
+  // a loop body and mem2reg can promote them
+  AllocaInst *createEntryBlockAlloca(Type *DataTy, StringRef Name = "");
 
-  void printIRToOstream(raw_ostream &Os) const;
+  void printIntegerValue(Value *Val);
 
   void freeResources(ast::statement_block *StmBlock);
 
@@ -207,6 +312,11 @@ private:
   ArrayInfo CurrArrInfo;
   DenseMap<Value *, ArrayInfo> ArrInfoMap;
   DenseMap<ast::statement_block *, SmallVector<Value *>> ResourcesToFree;
+  // The loads and the stores of the elements with their arrays
+  SmallVector<std::pair<Instruction *, Value *>> ArrayAccesses;
+  // The loops compiled in the tiered mode report the division by zero like
+  // the interpreter
+  bool IsDivisionChecked = false;
 };
 
 } // namespace paracl
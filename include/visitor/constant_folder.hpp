@@ -0,0 +1,81 @@
+#pragma once
+
+#include <optional>
+
+#include "ast.hpp"
+#include "expression.hpp"
+#include "statement.hpp"
+#include "visitor.hpp"
+
+namespace paracl {
+
+// The node that replaces the visited one. Null means that the statement can be
+// removed from its block.
+struct FoldedNode : public ValueWrapper {
+  FoldedNode(ast::statement *Node = nullptr) : Node(Node) {}
+
+  ast::statement *Node;
+};
+
+// Simplifies the validated AST before the execution or the code generation:
+// folds the operators with constant operands, removes the identities (x * 1,
+// x + 0, !!x in the conditions) and prunes the branches of the if operators
+// with constant conditions. The operations that fail or overflow at runtime
+// are never folded, so the behavior of the program doesn't change.
+class ConstantFolder : public VisitorBase {
+public:
+  using WrapperTy = FoldedNode;
+  using ResultTy = WrapperTy &;
+
+  ConstantFolder(ast::ast &AST) : AST(AST) {}
+
+  ResultTy visit(ast::root_statement_block *StmBlock) override;
+  ResultTy visit(ast::statement_block *StmBlock) override;
+  ResultTy visit(ast::calc_expression *CalcExp) override;
+  ResultTy visit(ast::logic_expression *LogExp) override;
+  ResultTy visit(ast::un_operator *UnOp) override;
+  ResultTy visit(ast::number *Num) override;
+  ResultTy visit(ast::variable *Var) override;
+  ResultTy visit(ast::assignment *Assign) override;
+  ResultTy visit(ast::if_operator *If) override;
+  ResultTy visit(ast::while_operator *While) override;
+  ResultTy visit(ast::pfor_operator *PFor) override;
+  ResultTy visit(ast::read_expression *ReadExp) override;
+  ResultTy visit(ast::print_function *Print) override;
+  ResultTy visit(ast::reduce_function *Reduce) override;
+  ResultTy visit(ast::ArrayHolder *ArrStore) override;
+  ResultTy visit(ast::PresetArray *PresetArr) override;
+  ResultTy visit(ast::UniformArray *UnifArr) override;
+  ResultTy visit(ast::ArrayAccess *ArrAccess) override;
+  ResultTy visit(ast::ArrayAccessAssignment *ArrAssign) override;
+
+  void run(ast::root_statement_block *RootBlock) { acceptASTNode(RootBlock); }
+
+private:
+  ResultTy acceptASTNode(ast::statement *Stm) override {
+    return static_cast<ResultTy>(Stm->accept(this));
+  }
+
+  ResultTy createWrapperRef(ast::statement *Node = nullptr) {
+    return VisitorBase::createWrapperRef<WrapperTy>(Node);
+  }
+
+  ast::expression *foldExpression(ast::expression *Exp);
+  // Only the truth of the condition matters, so the double negations are
+  // removed too
+  ast::expression *foldCondition(ast::expression *Cond);
+  // The body of a control statement can't be removed, an empty block is
+  // placed instead
+  ast::statement *foldBody(ast::statement *Body);
+
+  ast::number *makeNumber(int Value, yy::location Loc) {
+    return AST.make_node<ast::number>(Value, Loc);
+  }
+
+  static std::optional<int> getConstant(ast::expression *Exp);
+  static ast::expression *stripDoubleNegation(ast::expression *Exp);
+
+  ast::ast &AST;
+};
+
+} // namespace paracl
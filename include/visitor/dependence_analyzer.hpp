@@ -0,0 +1,126 @@
+#pragma once
+
+#include <llvm/ADT/MapVector.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "array.hpp"
+#include "expression.hpp"
+#include "operator.hpp"
+#include "statement.hpp"
+#include "visitor.hpp"
+
+namespace paracl {
+
+struct DependenceWrapper : public ValueWrapper {};
+
+// Finds the while loops whose iterations don't depend on each other and marks
+// them for the parallel execution by the compiled code (-auto-par). The loop
+// must be counted by an integer variable:
+//
+//   while (i < n) { a[i] = a[i] * 2; i = i + 1; }
+//
+// where the limit doesn't change in the loop and the increment is the last
+// statement of the body. The body may only assign the variables declared in
+// it and the elements of the arrays. Every array written by the body must be
+// accessed at the same offset from i in one of its dimensions, so the
+// iterations touch the different elements. The output and the input keep
+// their order only if the loop runs sequentially, so they aren't allowed
+// either.
+class DependenceAnalyzer : public VisitorBase {
+public:
+  using WrapperTy = DependenceWrapper;
+  using ResultTy = WrapperTy &;
+
+  ResultTy visit(ast::root_statement_block *StmBlock) override;
+  ResultTy visit(ast::statement_block *StmBlock) override;
+  ResultTy visit(ast::calc_expression *CalcExp) override;
+  ResultTy visit(ast::logic_expression *LogExp) override;
+  ResultTy visit(ast::un_operator *UnOp) override;
+  ResultTy visit(ast::number *Num) override;
+  ResultTy visit(ast::variable *Var) override;
+  ResultTy visit(ast::assignment *Assign) override;
+  ResultTy visit(ast::if_operator *If) override;
+  ResultTy visit(ast::while_operator *While) override;
+  ResultTy visit(ast::pfor_operator *PFor) override;
+  ResultTy visit(ast::read_expression *ReadExp) override;
+  ResultTy visit(ast::print_function *Print) override;
+  ResultTy visit(ast::reduce_function *Reduce) override;
+  ResultTy visit(ast::ArrayHolder *ArrStore) override;
+  ResultTy visit(ast::PresetArray *PresetArr) override;
+  ResultTy visit(ast::UniformArray *UnifArr) override;
+  ResultTy visit(ast::ArrayAccess *ArrAccess) override;
+  ResultTy visit(ast::ArrayAccessAssignment *ArrAssign) override;
+
+  // Marks the parallel loops of the program, the variables must be resolved
+  void run(ast::root_statement_block *RootBlock);
+
+  // Tells for every analyzed loop whether it's parallelized and why not
+  void print_report(llvm::raw_ostream &Os, llvm::StringRef FileName) const;
+
+private:
+  using SlotKey = uint64_t;
+
+  // The accesses of one array declared outside of the loop
+  struct ArrayUses final {
+    bool IsWritten = false;
+    // Copied into a new array or reduced by a builtin
+    bool IsUsedWhole = false;
+    llvm::SmallVector<ast::ArrayAccess *, 4> Accesses;
+  };
+
+  struct Remark final {
+    yy::location Loc;
+    // Empty if the loop is parallelized
+    std::string Reason;
+  };
+
+  ResultTy acceptASTNode(ast::statement *Stm) override {
+    return static_cast<ResultTy>(Stm->accept(this));
+  }
+
+  ResultTy createWrapperRef() {
+    return VisitorBase::createWrapperRef<WrapperTy>();
+  }
+
+  static SlotKey getKey(ast::FrameSlot Slot) {
+    return static_cast<SlotKey>(Slot.Depth) << 32 | Slot.Index;
+  }
+
+  // Returns the reason why the loop can't be parallelized, or an empty string
+  std::string analyzeLoop(ast::while_operator *While);
+
+  // Returns c if Exp is i + c (or i - c) for the induction variable i
+  std::optional<int64_t> getInductionOffset(ast::expression *Exp);
+  bool isInductionVariable(ast::expression *Exp);
+  // Whether the value of Exp is the same in all the iterations
+  bool isLoopInvariant(ast::expression *Exp);
+  // Whether the variable is declared outside of the analyzed body
+  bool isDeclaredOutside(ast::variable *Var) const {
+    return Var->slot().Depth < BodyDepth;
+  }
+
+  void rejectLoop(std::string Reason) {
+    if (Rejection.empty())
+      Rejection = std::move(Reason);
+  }
+  void recordAccess(ast::ArrayAccess *ArrAccess, bool IsWrite);
+  // Records the use of all the elements if Exp is an array variable
+  void recordWholeUse(ast::expression *Exp);
+
+  // The loop being analyzed, null while looking for the loops
+  ast::while_operator *CurrLoop = nullptr;
+  ast::variable *Induction = nullptr;
+  unsigned BodyDepth = 0;
+  std::string Rejection;
+  llvm::MapVector<SlotKey, ArrayUses> Arrays;
+
+  llvm::SmallVector<Remark> Report;
+};
+
+} // namespace paracl
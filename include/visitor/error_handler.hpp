@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 
+#include "expression.hpp"
 #include "interpreter.hpp"
 #include "location.hh"
 
@@ -40,8 +41,10 @@ public:
   ResultTy visit(ast::variable *Assign) override;
   ResultTy visit(ast::if_operator *If) override;
   ResultTy visit(ast::while_operator *While) override;
+  ResultTy visit(ast::pfor_operator *PFor) override;
   ResultTy visit(ast::read_expression *ReadExp) override;
   ResultTy visit(ast::print_function *PrintFunc) override;
+  ResultTy visit(ast::reduce_function *Reduce) override;
   ResultTy visit(ast::ArrayHolder *ArrStore) override;
   ResultTy visit(ast::PresetArray *PresetArr) override;
   ResultTy visit(ast::UniformArray *UnifArr) override;
@@ -80,7 +83,38 @@ private:
 
   unsigned computeArrayDimension(ArrayTy *Arr);
 
+  // Visits the operands of the operator, they may be element-wise only if the
+  // operator itself may be
+  template <typename BinType>
+  std::pair<HandlerWrapper, HandlerWrapper>
+  acceptOperands(ast::bin_operator<BinType> *Op) {
+    bool MayBeElementWise = Op == ElementWiseRoot;
+    auto Accept = [&](ast::expression *Operand) -> HandlerWrapper {
+      ElementWiseRoot = MayBeElementWise ? Operand : nullptr;
+      return acceptASTNode(Operand);
+    };
+    auto Lhs = Accept(Op->left());
+    auto Rhs = Accept(Op->right());
+    ElementWiseRoot = MayBeElementWise ? Op : nullptr;
+    return {Lhs, Rhs};
+  }
+
+  // Checks the operands of the element-wise operator Exp and returns the type
+  // of the array it creates or null if it's invalid
+  ArrayTy *checkElementWise(ast::expression *Exp,
+                            std::pair<ast::expression *, PCLType *> Lhs,
+                            std::pair<ast::expression *, PCLType *> Rhs);
+
+  // Reports the statements that can't be executed by the iterations of pfor
+  // at the same time
+  void checkParallelUse(llvm::StringRef What, yy::location Loc);
+
   std::vector<ErrorType> Errors;
+  // The bodies of the pfor loops being visited, the innermost one is the last
+  llvm::SmallVector<ast::statement_block *> ParallelBodies;
+  // The expression that may be element-wise: the initializer of a new variable
+  // or an operand of an element-wise operator
+  ast::expression *ElementWiseRoot = nullptr;
 };
 
 } // namespace paracl
@@ -3,19 +3,32 @@
 #include <llvm/ADT/DenseMap.h>
 #include <llvm/ADT/SmallVector.h>
 
-#include <istream>
+#include <memory>
+#include <vector>
 
 #include "identifiers.hpp"
+#include "input_reader.hpp"
 #include "semantic_context.hpp"
 #include "statement.hpp"
 #include "visitor.hpp"
 
 namespace paracl {
 
-class PCLValueWrapper : public ValueWrapper,
-                        public ValueWrapperInterface<PCLValue> {
+namespace codegen {
+class HotLoopCompiler;
+} // namespace codegen
+
+// Integers are returned by value, arrays are returned by pointer, so the
+// evaluation of the integer expressions doesn't allocate any values.
+class PCLValueWrapper : public ValueWrapper {
 public:
-  using WrapperInterfaceTy::WrapperInterfaceTy;
+  PCLValueWrapper(TaggedValue Val = {}) : Val(Val) {}
+
+  TaggedValue get() const noexcept { return Val; }
+  int32_t getInt() const noexcept { return Val.getInt(); }
+
+private:
+  TaggedValue Val;
 };
 
 class InterpreterBase : public VisitorBase {
@@ -26,20 +39,18 @@ public:
 
   void run_program(ast::root_statement_block *StmBlock) { visit(StmBlock); }
 
+  // The semantics of the operators, also used to fold the constants
+  static int performLogicalOperation(ast::LogicOp Op, int Lhs, int Rhs);
+  static int performUnaryOperation(ast::UnOp Op, int Val);
+  static int performArithmeticOperation(ast::CalcOp Op, int Lhs, int Rhs,
+                                        yy::location Loc);
+
 protected:
   InterpreterBase() = default;
 
-  ResultTy performLogicalOperation(ast::LogicOp Op, IntegerVal *Lhs,
-                                   IntegerVal *Rhs, IntegerTy *Type);
-  ResultTy performUnaryOperation(ast::UnOp Op, IntegerVal *Val,
-                                 IntegerTy *Type);
-  ResultTy performArithmeticOperation(ast::CalcOp Op, IntegerVal *Lhs,
-                                      IntegerVal *Rhs, IntegerTy *Type,
-                                      yy::location Loc);
-
   ResultTy acceptStatementBlock(ast::statement_block *StmBlock);
 
-  ResultTy createWrapperRef(PCLValue *Val = nullptr) {
+  ResultTy createWrapperRef(TaggedValue Val = {}) {
     return VisitorBase::createWrapperRef<WrapperTy>(Val);
   }
 
@@ -49,8 +60,16 @@ protected:
 
 class Interpreter : public InterpreterBase {
 public:
-  Interpreter(std::istream &input, std::ostream &output)
-      : input_stream_(input), output_stream_(output) {}
+  Interpreter(runtime::InputReader &input, runtime::OutputBuffer &output)
+      : input_(input), output_(output) {}
+
+  // The loops that make HotLoopThreshold iterations are compiled by
+  // LoopCompiler and continued in the native code
+  Interpreter(runtime::InputReader &input, runtime::OutputBuffer &output,
+              codegen::HotLoopCompiler &LoopCompiler,
+              unsigned HotLoopThreshold)
+      : input_(input), output_(output),
+        LoopCompiler(&LoopCompiler), HotLoopThreshold(HotLoopThreshold) {}
 
   ResultTy visit(ast::ArrayHolder *ArrStore) override;
   ResultTy visit(ast::ArrayAccessAssignment *Arr) override;
@@ -68,21 +87,68 @@ public:
   ResultTy visit(ast::root_statement_block *StmBlock) override;
   ResultTy visit(ast::if_operator *If) override;
   ResultTy visit(ast::while_operator *While) override;
+  ResultTy visit(ast::pfor_operator *PFor) override;
   ResultTy visit(ast::print_function *Print) override;
+  ResultTy visit(ast::reduce_function *Reduce) override;
 
 private:
+  // The interpreter of the iterations of pfor executed by one worker of the
+  // thread pool. It has its own frames and values, the frames of the blocks
+  // enclosing the loop are shared with Parent.
+  explicit Interpreter(Interpreter &Parent)
+      : input_(Parent.input_), output_(Parent.output_), IsWorker(true) {}
+
   ResultTy acceptASTNode(ast::statement *Stm) override {
     return static_cast<ResultTy>(Stm->accept(this));
   }
 
-  void freeResources(ast::statement_block *StmBlock);
-  void addResourceForFree(PCLValue *ValToFree,
-                          ast::statement_block *ScopeToFree);
+  // Evaluates the indexes of ArrAccess into Indices and returns the accessed
+  // array. The indexes marked by the -checked mode are checked right after
+  // their evaluation.
+  ArrayBase *evaluateArrayAccess(ast::ArrayAccess *ArrAccess,
+                                 llvm::SmallVectorImpl<unsigned> &Indices);
+
+  // Creates the array computed by the element-wise expression Exp
+  ArrayBase *evaluateElementWise(ast::expression *Exp);
+
+  [[noreturn]] void reportDivisionByZero(yy::location Loc);
+  [[noreturn]] void reportIndexOutOfRange(ast::ArrayAccess *ArrAccess,
+                                          int Index, unsigned Size);
+  [[noreturn]] void reportSizeMismatch(ast::reduce_function *Reduce,
+                                       unsigned LhsSize, unsigned RhsSize);
+  [[noreturn]] void reportShapeMismatch(ast::expression *Exp,
+                                        const ArrayBase &Lhs,
+                                        const ArrayBase &Rhs);
+
+  // Transfers the execution of the loop to its compiled version. Returns false
+  // if the loop can't be compiled.
+  bool tryEnterCompiledLoop(ast::while_operator *While);
+
+  // Executes the body of pfor with the loop variable equal to Iteration
+  void runIteration(ast::pfor_operator *PFor, int32_t Iteration);
+
+  // Returns the place of the variable in the frame of its declaring block.
+  // The slot must be bound by the Resolver beforehand.
+  TaggedValue &getSlotValue(ast::FrameSlot Slot) {
+    assert(Slot.isValid() && Slot.Depth < ActiveFrames.size());
+    return ActiveFrames[Slot.Depth][Slot.Index];
+  }
 
-  std::istream &input_stream_;
-  std::ostream &output_stream_;
-  llvm::DenseMap<ast::statement_block *, llvm::SmallVector<PCLValue *>>
-      ResourceHandleMap;
+  runtime::InputReader &input_;
+  runtime::OutputBuffer &output_;
+  // Every block has one frame with the values of its variables. The frames of
+  // the blocks being executed are indexed by their nesting depth.
+  llvm::DenseMap<ast::statement_block *, std::vector<TaggedValue>> Frames;
+  llvm::SmallVector<TaggedValue *> ActiveFrames;
+
+  codegen::HotLoopCompiler *LoopCompiler = nullptr;
+  unsigned HotLoopThreshold = 0;
+  // The number of the iterations made by every loop in all its executions
+  llvm::DenseMap<ast::while_operator *, unsigned> BackedgeCounters;
+
+  // The nested parallel loops are executed by the worker sequentially
+  bool IsWorker = false;
+  std::vector<std::unique_ptr<Interpreter>> Workers;
 };
 
 } // namespace paracl
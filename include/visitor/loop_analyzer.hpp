@@ -0,0 +1,78 @@
+#pragma once
+
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/SmallVector.h>
+
+#include "expression.hpp"
+#include "operator.hpp"
+#include "statement.hpp"
+#include "visitor.hpp"
+
+namespace paracl {
+
+// The variable that is declared outside of the loop and used inside it, so its
+// value has to be passed into the compiled loop and back.
+struct LiveInVariable final {
+  SymTabKey DeclKey;
+  ast::FrameSlot Slot;
+};
+
+struct LoopAnalyzerWrapper : public ValueWrapper {};
+
+// Collects the live-in variables of a while loop and checks that the loop can
+// be compiled apart from the rest of the program. Only the loops working with
+// integers are supported: the arrays of the interpreter have another layout.
+// The parallel loops are run by the interpreter itself.
+class LoopAnalyzer : public VisitorBase {
+public:
+  using WrapperTy = LoopAnalyzerWrapper;
+  using ResultTy = WrapperTy &;
+
+  ResultTy visit(ast::root_statement_block *StmBlock) override;
+  ResultTy visit(ast::statement_block *StmBlock) override;
+  ResultTy visit(ast::calc_expression *CalcExp) override;
+  ResultTy visit(ast::logic_expression *LogExp) override;
+  ResultTy visit(ast::un_operator *UnOp) override;
+  ResultTy visit(ast::number *Num) override;
+  ResultTy visit(ast::variable *Var) override;
+  ResultTy visit(ast::assignment *Assign) override;
+  ResultTy visit(ast::if_operator *If) override;
+  ResultTy visit(ast::while_operator *While) override;
+  ResultTy visit(ast::pfor_operator *PFor) override;
+  ResultTy visit(ast::read_expression *ReadExp) override;
+  ResultTy visit(ast::print_function *Print) override;
+  ResultTy visit(ast::reduce_function *Reduce) override;
+  ResultTy visit(ast::ArrayHolder *ArrStore) override;
+  ResultTy visit(ast::PresetArray *PresetArr) override;
+  ResultTy visit(ast::UniformArray *UnifArr) override;
+  ResultTy visit(ast::ArrayAccess *ArrAccess) override;
+  ResultTy visit(ast::ArrayAccessAssignment *ArrAssign) override;
+
+  // Returns false if the loop can't be compiled
+  bool run(ast::while_operator *While);
+
+  llvm::ArrayRef<LiveInVariable> getLiveIns() const { return LiveIns; }
+
+private:
+  ResultTy acceptASTNode(ast::statement *Stm) override {
+    return static_cast<ResultTy>(Stm->accept(this));
+  }
+
+  ResultTy createWrapperRef() {
+    return VisitorBase::createWrapperRef<WrapperTy>();
+  }
+
+  ResultTy rejectLoop() {
+    IsCompilable = false;
+    return createWrapperRef();
+  }
+
+  void addIfLiveIn(ast::variable *Var);
+
+  ast::statement_block *LoopBody = nullptr;
+  bool IsCompilable = true;
+  llvm::SmallVector<LiveInVariable> LiveIns;
+  llvm::DenseSet<SymTabKey> Visited;
+};
+
+} // namespace paracl
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallBitVector.h>
+#include <llvm/ADT/SmallVector.h>
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+
+#include "array.hpp"
+#include "expression.hpp"
+#include "operator.hpp"
+#include "statement.hpp"
+#include "visitor.hpp"
+
+namespace paracl {
+
+// The range [Lo, Hi] of the values of an integer expression. The bounds are
+// wider than int32_t, so the overflows of the operations are detected.
+struct ValueRange final {
+  static constexpr int64_t Min = std::numeric_limits<int32_t>::min();
+  static constexpr int64_t Max = std::numeric_limits<int32_t>::max();
+
+  int64_t Lo = Min;
+  int64_t Hi = Max;
+
+  static ValueRange getConstant(int64_t Val) { return {Val, Val}; }
+
+  bool isEmpty() const noexcept { return Lo > Hi; }
+  bool operator==(const ValueRange &) const = default;
+};
+
+// The analysis identifies the variables by their frame slots
+using SlotKey = uint64_t;
+
+// The size of an array dimension. If SizeVar is set, the size is also equal to
+// the current value of that variable.
+struct DimensionInfo final {
+  ValueRange Size;
+  std::optional<SlotKey> SizeVar;
+
+  bool operator==(const DimensionInfo &) const = default;
+};
+
+// What is known about the value of a variable or an expression
+struct RangeInfo final {
+  enum class ValueKind { Unknown, Integer, Array };
+
+  static RangeInfo getInteger(ValueRange Range) {
+    RangeInfo Info;
+    Info.Kind = ValueKind::Integer;
+    Info.Range = Range;
+    return Info;
+  }
+  // The array of the unknown sizes
+  static RangeInfo getArray() {
+    RangeInfo Info;
+    Info.Kind = ValueKind::Array;
+    return Info;
+  }
+
+  ValueKind Kind = ValueKind::Unknown;
+  ValueRange Range;
+  // The variables that are known to be greater than this one
+  llvm::SmallVector<SlotKey, 2> LessThan;
+  // The dimensions of the array, empty if the value isn't an array or its
+  // sizes are unknown
+  llvm::SmallVector<DimensionInfo, 2> Dims;
+
+  bool operator==(const RangeInfo &) const = default;
+};
+
+struct RangeWrapper : public ValueWrapper {
+  RangeWrapper() = default;
+  RangeWrapper(RangeInfo Info) : Info(std::move(Info)) {}
+  RangeWrapper(RangeInfo Info, std::optional<SlotKey> Var, unsigned ReadStamp)
+      : Info(std::move(Info)), Var(Var), ReadStamp(ReadStamp) {}
+
+  RangeInfo Info;
+  // The variable the value was read from
+  std::optional<SlotKey> Var;
+  // The relations of the value to the other variables hold while no
+  // assignment happens after ReadStamp
+  unsigned ReadStamp = 0;
+};
+
+// Finds the array accesses whose indexes may be out of bounds and marks them
+// for the runtime checks of the -checked mode. The analysis computes the
+// ranges of the integer variables and the sizes of the arrays, the loops are
+// iterated until the ranges are stable (the growing bounds are widened to the
+// int32_t limits). The conditions narrow the ranges of the compared
+// variables, so the induction variables of the loops like
+//
+//   while (i < n) { a[i] = 0; i = i + 1; }
+//
+// are known to be less than n in the body. An index is proven to be in bounds
+// if its range fits into the size of the dimension, or if it's less than the
+// variable the array size was taken from.
+class RangeAnalyzer : public VisitorBase {
+public:
+  using WrapperTy = RangeWrapper;
+  using ResultTy = WrapperTy &;
+
+  ResultTy visit(ast::root_statement_block *StmBlock) override;
+  ResultTy visit(ast::statement_block *StmBlock) override;
+  ResultTy visit(ast::calc_expression *CalcExp) override;
+  ResultTy visit(ast::logic_expression *LogExp) override;
+  ResultTy visit(ast::un_operator *UnOp) override;
+  ResultTy visit(ast::number *Num) override;
+  ResultTy visit(ast::variable *Var) override;
+  ResultTy visit(ast::assignment *Assign) override;
+  ResultTy visit(ast::if_operator *If) override;
+  ResultTy visit(ast::while_operator *While) override;
+  ResultTy visit(ast::pfor_operator *PFor) override;
+  ResultTy visit(ast::read_expression *ReadExp) override;
+  ResultTy visit(ast::print_function *Print) override;
+  ResultTy visit(ast::reduce_function *Reduce) override;
+  ResultTy visit(ast::ArrayHolder *ArrStore) override;
+  ResultTy visit(ast::PresetArray *PresetArr) override;
+  ResultTy visit(ast::UniformArray *UnifArr) override;
+  ResultTy visit(ast::ArrayAccess *ArrAccess) override;
+  ResultTy visit(ast::ArrayAccessAssignment *ArrAssign) override;
+
+  // Marks the array accesses that need the bounds checks
+  void run(ast::root_statement_block *RootBlock);
+
+private:
+  // The ranges of the variables at a program point. The variables that aren't
+  // in the map can have any value.
+  struct State final {
+    llvm::DenseMap<SlotKey, RangeInfo> Vars;
+    bool IsReachable = true;
+
+    bool operator==(const State &Other) const;
+  };
+
+  // The dimensions of the access that may be out of bounds in any of the
+  // reachable states it was visited in
+  struct AccessInfo final {
+    bool IsReached = false;
+    llvm::SmallBitVector MayBeOutOfBounds;
+  };
+
+  ResultTy acceptASTNode(ast::statement *Stm) override {
+    return static_cast<ResultTy>(Stm->accept(this));
+  }
+
+  template <typename... ArgsTy> ResultTy createWrapperRef(ArgsTy &&...Args) {
+    return VisitorBase::createWrapperRef<WrapperTy>(
+        std::forward<ArgsTy>(Args)...);
+  }
+
+  static SlotKey getKey(ast::FrameSlot Slot) {
+    return static_cast<SlotKey>(Slot.Depth) << 32 | Slot.Index;
+  }
+
+  static State join(const State &Lhs, const State &Rhs);
+  // Extends the growing bounds of Prev to the limits, so the loops reach the
+  // fixed point after a few iterations
+  static State widen(const State &Prev, const State &Next);
+
+  // Moves the current state (taken after the evaluation of Cond) to the branch
+  // executed when the truth of Cond is Truth. The variables are narrowed only
+  // if nothing was assigned by Cond.
+  void enterBranch(ast::expression *Cond, const RangeWrapper &CondValue,
+                   bool CanNarrow, bool Truth);
+  // Narrows the current state by the assumption that Cond is equal to Truth.
+  // The operands of the comparisons were recorded by the last evaluation of
+  // Cond, so nothing may be assigned since then.
+  void assumeCondition(ast::expression *Cond, bool Truth);
+  void assumeComparison(ast::logic_expression *LogExp, ast::LogicOp Op);
+  // Narrows the variable by the assumption Var < Bound (or Var <= Bound if
+  // OrEqual is set)
+  void assumeLess(std::optional<SlotKey> Var, const ValueRange &Bound,
+                  std::optional<SlotKey> BoundVar, bool OrEqual);
+  void assumeGreater(std::optional<SlotKey> Var, const ValueRange &Bound,
+                     bool OrEqual);
+
+  // Binds the value to the variable, so the relations with the old value of
+  // the variable are forgotten
+  void assignVariable(SlotKey Var, RangeInfo Info);
+  void checkAccess(ast::ArrayAccess *ArrAccess,
+                   llvm::ArrayRef<RangeWrapper> Indexes);
+  // The array created by an element-wise expression, nothing was assigned
+  // before its operands were evaluated since Stamp
+  ResultTy createElementWiseRef(const RangeWrapper &Lhs,
+                                const RangeWrapper &Rhs, unsigned Stamp);
+
+  State Current;
+  // The number of the assignments analyzed so far, it tells whether the
+  // relations of the read values are still valid
+  unsigned AssignStamp = 0;
+  llvm::DenseMap<ast::logic_expression *, std::pair<RangeWrapper, RangeWrapper>>
+      ComparedValues;
+  llvm::DenseMap<ast::ArrayAccess *, AccessInfo> Accesses;
+};
+
+} // namespace paracl
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallVector.h>
+
+#include "expression.hpp"
+#include "operator.hpp"
+#include "statement.hpp"
+#include "visitor.hpp"
+
+namespace paracl {
+
+struct ResolverWrapper : public ValueWrapper {};
+
+// Binds every variable, assignment and array access to the frame slot of the
+// block where the variable was declared (first assigned). It runs once over
+// the validated AST, so the Interpreter doesn't look up the names during the
+// execution. The arrays shared by the iterations of pfor are recorded in the
+// loop as well.
+class Resolver : public VisitorBase {
+public:
+  using WrapperTy = ResolverWrapper;
+  using ResultTy = WrapperTy &;
+
+  ResultTy visit(ast::root_statement_block *StmBlock) override;
+  ResultTy visit(ast::statement_block *StmBlock) override;
+  ResultTy visit(ast::calc_expression *CalcExp) override;
+  ResultTy visit(ast::logic_expression *LogExp) override;
+  ResultTy visit(ast::un_operator *UnOp) override;
+  ResultTy visit(ast::number *Num) override;
+  ResultTy visit(ast::variable *Var) override;
+  ResultTy visit(ast::assignment *Assign) override;
+  ResultTy visit(ast::if_operator *If) override;
+  ResultTy visit(ast::while_operator *While) override;
+  ResultTy visit(ast::pfor_operator *PFor) override;
+  ResultTy visit(ast::read_expression *ReadExp) override;
+  ResultTy visit(ast::print_function *Print) override;
+  ResultTy visit(ast::reduce_function *Reduce) override;
+  ResultTy visit(ast::ArrayHolder *ArrStore) override;
+  ResultTy visit(ast::PresetArray *PresetArr) override;
+  ResultTy visit(ast::UniformArray *UnifArr) override;
+  ResultTy visit(ast::ArrayAccess *ArrAccess) override;
+  ResultTy visit(ast::ArrayAccessAssignment *ArrAssign) override;
+
+  void run(ast::root_statement_block *RootBlock) { acceptASTNode(RootBlock); }
+
+private:
+  ResultTy acceptASTNode(ast::statement *Stm) override {
+    return static_cast<ResultTy>(Stm->accept(this));
+  }
+
+  ResultTy createWrapperRef() {
+    return VisitorBase::createWrapperRef<WrapperTy>();
+  }
+
+  // Returns the slot of the variable visible from the scope of Var, or an
+  // invalid slot if the variable hasn't been declared yet.
+  ast::FrameSlot lookupSlot(ast::variable *Var);
+
+  // Remembers the variable used to create a new array, it may refer to an
+  // array shared by the enclosing pfor loops
+  void recordArrayInitializer(ast::expression *Exp);
+
+  struct ParallelLoop final {
+    ast::pfor_operator *PFor;
+    // The variables declared outside of the loop the arrays are created from
+    llvm::SmallVector<ast::FrameSlot, 2> Initializers;
+  };
+
+  llvm::DenseMap<SymTabKey, unsigned> SlotIndices;
+  llvm::DenseMap<ast::statement_block *, unsigned> SlotsNum;
+  unsigned CurrDepth = 0;
+  llvm::SmallVector<ParallelLoop> ParallelLoops;
+};
+
+} // namespace paracl
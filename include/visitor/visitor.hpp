@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cassert>
 #include <memory>
 #include <vector>
 
@@ -11,6 +12,7 @@ namespace ast {
 
 class ArrayAccessAssignment;
 class statement;
+class expression;
 class root_statement_block;
 class statement_block;
 class logic_expression;
@@ -21,7 +23,9 @@ class number;
 class variable;
 class if_operator;
 class while_operator;
+class pfor_operator;
 class print_function;
+class reduce_function;
 class read_expression;
 class ArrayAccess;
 class PresetArray;
@@ -53,8 +57,10 @@ public:
   virtual ResultTy visit(ast::assignment *Assign) = 0;
   virtual ResultTy visit(ast::if_operator *If) = 0;
   virtual ResultTy visit(ast::while_operator *While) = 0;
+  virtual ResultTy visit(ast::pfor_operator *PFor) = 0;
   virtual ResultTy visit(ast::read_expression *ReadExpr) = 0;
   virtual ResultTy visit(ast::print_function *Print) = 0;
+  virtual ResultTy visit(ast::reduce_function *Reduce) = 0;
   virtual ResultTy visit(ast::ArrayHolder *InitListArr) = 0;
   virtual ResultTy visit(ast::PresetArray *InitListArr) = 0;
   virtual ResultTy visit(ast::ArrayAccess *ArrAccess) = 0;
@@ -64,15 +70,55 @@ public:
 protected:
   virtual ResultTy acceptASTNode(ast::statement *Stm) = 0;
 
+  // The wrappers live in an arena: the visitor marks it before a statement or a
+  // loop iteration and releases it after, so the wrappers are reused and the
+  // memory depends on the expression depth only, not on the execution time.
   template <DerivedFromValueWrapper ResType, typename... ArgsTy>
   ResType &createWrapperRef(ArgsTy &&...Args) {
-    WrapperStorage.emplace_back(
-        std::make_unique<ResType>(std::forward<ArgsTy>(Args)...));
-    return *static_cast<ResType *>(WrapperStorage.back().get());
+    if (NumUsedWrappers == WrapperStorage.size()) {
+      WrapperStorage.push_back(
+          {std::make_unique<ResType>(std::forward<ArgsTy>(Args)...),
+           getWrapperKind<ResType>()});
+      ++NumUsedWrappers;
+      return *static_cast<ResType *>(WrapperStorage.back().Wrapper.get());
+    }
+
+    auto &[Wrapper, Kind] = WrapperStorage[NumUsedWrappers++];
+    if (Kind == getWrapperKind<ResType>()) {
+      auto &Result = *static_cast<ResType *>(Wrapper.get());
+      Result = ResType(std::forward<ArgsTy>(Args)...);
+      return Result;
+    }
+    Wrapper = std::make_unique<ResType>(std::forward<ArgsTy>(Args)...);
+    Kind = getWrapperKind<ResType>();
+    return *static_cast<ResType *>(Wrapper.get());
+  }
+
+  using WrapperMark = unsigned;
+
+  WrapperMark markWrappers() const noexcept { return NumUsedWrappers; }
+
+  // All the wrappers created after the Mark are reused by the next
+  // createWrapperRef calls, so the references to them become invalid.
+  void releaseWrappers(WrapperMark Mark) noexcept {
+    assert(Mark <= NumUsedWrappers);
+    NumUsedWrappers = Mark;
   }
 
 private:
-  std::vector<std::unique_ptr<ValueWrapper>> WrapperStorage;
+  template <DerivedFromValueWrapper ResType>
+  static const void *getWrapperKind() noexcept {
+    static const char Kind = 0;
+    return &Kind;
+  }
+
+  struct WrapperEntry final {
+    std::unique_ptr<ValueWrapper> Wrapper;
+    const void *Kind;
+  };
+
+  std::vector<WrapperEntry> WrapperStorage;
+  WrapperMark NumUsedWrappers = 0;
 };
 
 } // namespace paracl
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallVector.h>
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "element_wise.hpp"
+#include "location.hh"
+
+namespace paracl {
+namespace vm {
+
+// Register index in the integer register file (R) or in the array register
+// file (A) of the virtual machine.
+using RegisterID = int32_t;
+
+// Instruction set of the ParaCL register machine. All the operands are
+// resolved before the execution, so there are no name lookups and no
+// allocations for the integer operations. The comments describe the semantics
+// of the operands (A, B, C) for every opcode.
+enum class OpCode : uint8_t {
+  LoadConst, // R[A] = B
+  Move,      // R[A] = R[B]
+
+  Add,       // R[A] = R[B] + R[C]
+  Sub,       // R[A] = R[B] - R[C]
+  Mul,       // R[A] = R[B] * R[C]
+  Div,       // R[A] = R[B] / R[C], reports an error if R[C] == 0
+  Rem,       // R[A] = R[B] % R[C]
+  AddImm,    // R[A] = R[B] + C
+
+  Less,      // R[A] = R[B] < R[C]
+  LessEq,    // R[A] = R[B] <= R[C]
+  Greater,   // R[A] = R[B] > R[C]
+  GreaterEq, // R[A] = R[B] >= R[C]
+  Equal,     // R[A] = R[B] == R[C]
+  NotEqual,  // R[A] = R[B] != R[C]
+
+  Neg,       // R[A] = -R[B]
+  Not,       // R[A] = !R[B]
+  ToBool,    // R[A] = R[B] != 0
+
+  Jump,          // goto A
+  JumpIfZero,    // if (!R[A]) goto B
+  JumpIfNotZero, // if (R[A]) goto B
+  JumpIfGreaterEq, // if (R[A] >= R[B]) goto C (negated 'while (x < y)')
+
+  Scan,       // R[A] = ?
+  Print,      // print R[A]
+  PrintArray, // print A[A]
+
+  NewUniform,  // A[A] = repeat(R[B], R[C])
+  RepeatArray, // A[A] = repeat(A[B], R[C])
+  NewPreset,   // A[A] = array(), the elements are appended by the next ops
+  AppendValue, // A[A].push_back(R[B])
+  AppendArray, // A[A].append(A[B])
+  MoveArray,   // A[A] = std::move(A[B])
+  FreeArray,   // A[A] = {}
+
+  ScaleIndex, // R[A] = R[A] * dim(A[B], C), row-major offset computation
+  CheckIndex, // reports an error unless 0 <= R[A] < dim(A[B], C) (-checked)
+  LoadElem,   // R[A] = A[B].data[R[C]]
+  StoreElem,  // A[A].data[R[B]] = R[C]
+
+  ArraySum,   // R[A] = sum(A[B])
+  ArrayMin,   // R[A] = min(A[B])
+  ArrayMax,   // R[A] = max(A[B])
+  ArrayCount, // R[A] = count(A[B], R[C])
+  ArrayDot,   // R[A] = dot(A[B], A[C]), reports an error if the sizes differ
+  ElementWise, // A[A] = the element-wise expression B of the program, reports
+               // an error if the shapes of the arrays differ
+
+  Halt
+};
+
+struct Instruction final {
+  OpCode Op;
+  int32_t A = 0;
+  int32_t B = 0;
+  int32_t C = 0;
+};
+
+// The element-wise expression over the arrays, it's evaluated by one
+// instruction without the temporary arrays
+struct ElementWiseExpr final {
+  std::vector<runtime::ElementStep> Steps;
+  // The register of every operand step and whether it's an array register
+  llvm::SmallVector<std::pair<bool, RegisterID>, 4> Operands;
+  // The locations of the steps reported by the division by zero
+  std::vector<yy::location> StepLocations;
+};
+
+// The result of lowering the validated AST. It contains a flat instruction
+// stream and the sizes of both register files.
+class Program final {
+public:
+  using InstrStorage = std::vector<Instruction>;
+
+  unsigned emit(OpCode Op, int32_t A = 0, int32_t B = 0, int32_t C = 0) {
+    Code.push_back({Op, A, B, C});
+    return Code.size() - 1;
+  }
+
+  // Remember the source location for instructions that can report an error at
+  // runtime (division, scan, index check, dot)
+  void setLocation(unsigned InstrID, yy::location Loc) {
+    Locations.try_emplace(InstrID, Loc);
+  }
+
+  std::optional<yy::location> getLocation(unsigned InstrID) const {
+    if (auto Found = Locations.find(InstrID); Found != Locations.end())
+      return Found->second;
+    return std::nullopt;
+  }
+
+  unsigned addElementWise(ElementWiseExpr Expr) {
+    ElementWiseExprs.push_back(std::move(Expr));
+    return ElementWiseExprs.size() - 1;
+  }
+
+  const ElementWiseExpr &getElementWise(unsigned ExprID) const {
+    return ElementWiseExprs[ExprID];
+  }
+
+  Instruction &operator[](unsigned InstrID) { return Code[InstrID]; }
+  const Instruction &operator[](unsigned InstrID) const {
+    return Code[InstrID];
+  }
+
+  unsigned size() const noexcept { return Code.size(); }
+  const Instruction *data() const noexcept { return Code.data(); }
+
+  void setRegistersNumber(unsigned Num) noexcept { NumRegisters = Num; }
+  void setArrayRegistersNumber(unsigned Num) noexcept {
+    NumArrayRegisters = Num;
+  }
+  unsigned getRegistersNumber() const noexcept { return NumRegisters; }
+  unsigned getArrayRegistersNumber() const noexcept {
+    return NumArrayRegisters;
+  }
+
+private:
+  InstrStorage Code;
+  llvm::DenseMap<unsigned, yy::location> Locations;
+  std::vector<ElementWiseExpr> ElementWiseExprs;
+  unsigned NumRegisters = 0;
+  unsigned NumArrayRegisters = 0;
+};
+
+} // namespace vm
+} // namespace paracl
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/FormatVariadic.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "bytecode.hpp"
+#include "input_reader.hpp"
+#include "output_buffer.hpp"
+#include "utils.hpp"
+
+namespace paracl {
+namespace vm {
+
+// The array representation of the virtual machine. The elements of all the
+// dimensions are stored in one contiguous buffer in row-major order, Dims holds
+// the sizes of the dimensions starting from the outermost one.
+struct ArrayStorage final {
+  std::vector<int32_t> Data;
+  llvm::SmallVector<unsigned, 4> Dims;
+
+  void release() {
+    std::vector<int32_t>().swap(Data);
+    Dims.clear();
+  }
+};
+
+// Executes the bytecode program produced by the BytecodeCompiler. All the
+// registers are allocated once before the execution starts.
+class VirtualMachine final {
+public:
+  VirtualMachine(runtime::InputReader &Input, runtime::OutputBuffer &Output)
+      : Input(Input), Output(Output) {}
+
+  void run(const Program &Prog);
+
+private:
+  // Reports the runtime error at the location of the InstrID instruction.
+  // MessageFormat takes the location as the first argument followed by Args.
+  template <typename... ArgsTy>
+  [[noreturn]] void reportError(const Program &Prog, unsigned InstrID,
+                                const char *MessageFormat,
+                                ArgsTy &&...Args) const {
+    auto Location = prepareErrorReport(Prog, InstrID);
+    paracl::fatal(
+        llvm::formatv(MessageFormat, Location, std::forward<ArgsTy>(Args)...));
+  }
+
+  // Flushes the output before the error message and returns the location of
+  // the InstrID instruction
+  std::string prepareErrorReport(const Program &Prog, unsigned InstrID) const;
+  std::string prepareErrorReport(const yy::location &Loc) const;
+
+  // Computes the element-wise expression of the InstrID instruction
+  ArrayStorage evaluateElementWise(const Program &Prog, unsigned InstrID,
+                                   llvm::ArrayRef<int32_t> Regs,
+                                   llvm::ArrayRef<ArrayStorage> Arrays) const;
+
+  runtime::InputReader &Input;
+  runtime::OutputBuffer &Output;
+};
+
+} // namespace vm
+} // namespace paracl
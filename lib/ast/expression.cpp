@@ -1,3 +1,7 @@
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/Support/ErrorHandling.h>
+
+#include "element_wise.hpp"
 #include "expression.hpp"
 
 namespace paracl {
@@ -38,6 +42,79 @@ ResultValue logic_expression::accept(VisitorBasePtr Vis) {
   return Vis->visit(this);
 }
 
+bool is_element_wise(expression *exp) noexcept {
+  if (auto *calc = dynamic_cast<calc_expression *>(exp))
+    return calc->is_element_wise();
+  if (auto *logic = dynamic_cast<logic_expression *>(exp))
+    return logic->is_element_wise();
+  return false;
+}
+
+namespace {
+
+runtime::ElementOp get_element_op(CalcOp op) {
+  switch (op) {
+  case CalcOp::ADD:
+    return runtime::ElementOp::Add;
+  case CalcOp::SUB:
+    return runtime::ElementOp::Sub;
+  case CalcOp::MUL:
+    return runtime::ElementOp::Mul;
+  case CalcOp::DIV:
+    return runtime::ElementOp::Div;
+  case CalcOp::PERCENT:
+    return runtime::ElementOp::Rem;
+  default:
+    llvm_unreachable("Unsupported calculation operator");
+  }
+}
+
+runtime::ElementOp get_element_op(LogicOp op) {
+  switch (op) {
+  case LogicOp::LESS:
+    return runtime::ElementOp::Less;
+  case LogicOp::LESS_EQ:
+    return runtime::ElementOp::LessEq;
+  case LogicOp::GREATER:
+    return runtime::ElementOp::Greater;
+  case LogicOp::GREATER_EQ:
+    return runtime::ElementOp::GreaterEq;
+  case LogicOp::EQ:
+    return runtime::ElementOp::Equal;
+  case LogicOp::NEQ:
+    return runtime::ElementOp::NotEqual;
+  default:
+    llvm_unreachable("The logic operator isn't element-wise");
+  }
+}
+
+template <typename BinType>
+bool flatten_operator(expression *exp, std::vector<runtime::ElementStep> &steps,
+                      std::vector<expression *> &nodes) {
+  auto *op = dynamic_cast<bin_operator<BinType> *>(exp);
+  if (!op || !op->is_element_wise())
+    return false;
+  flatten_element_wise(op->left(), steps, nodes);
+  flatten_element_wise(op->right(), steps, nodes);
+  steps.push_back(runtime::ElementStep::makeOperator(get_element_op(op->type())));
+  nodes.push_back(exp);
+  return true;
+}
+
+} // namespace
+
+void flatten_element_wise(expression *exp,
+                          std::vector<runtime::ElementStep> &steps,
+                          std::vector<expression *> &nodes) {
+  if (flatten_operator<CalcOp>(exp, steps, nodes) ||
+      flatten_operator<LogicOp>(exp, steps, nodes))
+    return;
+  auto operand = llvm::count_if(
+      steps, [](auto &step) { return step.IsOperand; });
+  steps.push_back(runtime::ElementStep::makeOperand(operand));
+  nodes.push_back(exp);
+}
+
 assignment::assignment(statement_block *curr_block, variable *LValue,
                        expression *expr, yy::location loc)
     : expression{curr_block, loc}, LValue(LValue), Identifier{expr} {}
@@ -56,6 +133,11 @@ SymTabKey assignment::entityKey() {
   return LValue->entityKey();
 }
 
+FrameSlot assignment::slot() const noexcept {
+  assert(LValue);
+  return LValue->slot();
+}
+
 read_expression::read_expression(yy::location loc) : expression{loc} {}
 
 ResultValue read_expression::accept(VisitorBasePtr VisitorBase) {
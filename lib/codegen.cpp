@@ -16,7 +16,8 @@ cl::opt<std::string> TargetTriple("target-triple",
                                   cl::cat(ParaCLCategory));
 
 IRCodeGenerator::IRCodeGenerator(StringRef ModuleName)
-    : Builder(std::make_unique<IRBuilder<>>(Context)),
+    : ContextPtr(std::make_unique<LLVMContext>()), Context(*ContextPtr),
+      Builder(std::make_unique<IRBuilder<>>(Context)),
       Mod(std::make_unique<Module>(ModuleName, Context)) {
   assert(!TargetTriple.getValue().empty());
   Mod->setTargetTriple(TargetTriple.getValue());
@@ -47,9 +48,78 @@ void IRCodeGenerator::createParaCLStdLibFuncsDecls() {
   // Create __pcl_print
   createFunction(getVoidTy(), Function::ExternalLinkage, ParaCLPrintFuncName,
                  false, getInt32Ty());
+  // Create __pcl_print_array, it only reads the elements
+  auto *PrintArrayFunc = createFunction(
+      getVoidTy(), Function::ExternalLinkage, ParaCLPrintArrayFuncName, false,
+      PointerType::get(getInt32Ty(), 0), Type::getInt64Ty(Context));
+  PrintArrayFunc->addParamAttr(0, Attribute::ReadOnly);
+  PrintArrayFunc->addParamAttr(0, Attribute::NoCapture);
+  // Create __pcl_fill_array(array, size, pattern, pattern size)
+  auto *FillArrayFunc = createFunction(
+      getVoidTy(), Function::ExternalLinkage, ParaCLFillArrayFuncName, false,
+      PointerType::get(getInt32Ty(), 0), Type::getInt64Ty(Context),
+      PointerType::get(getInt32Ty(), 0), Type::getInt64Ty(Context));
+  FillArrayFunc->addParamAttr(0, Attribute::WriteOnly);
+  FillArrayFunc->addParamAttr(0, Attribute::NoCapture);
+  FillArrayFunc->addParamAttr(2, Attribute::ReadOnly);
+  FillArrayFunc->addParamAttr(2, Attribute::NoCapture);
+  FillArrayFunc->addFnAttr(Attribute::NoUnwind);
   // Create __pcl_scan
   createFunction(getInt32Ty(), Function::ExternalLinkage, ParaCLScanFuncName,
                  false);
+  // Create __pcl_index_error(line, column, index, size), it never returns
+  auto *IndexErrorFunc = createFunction(
+      getVoidTy(), Function::ExternalLinkage, ParaCLIndexErrorFuncName, false,
+      getInt32Ty(), getInt32Ty(), getInt32Ty(), getInt32Ty());
+  IndexErrorFunc->addFnAttr(Attribute::NoReturn);
+  IndexErrorFunc->addFnAttr(Attribute::Cold);
+  IndexErrorFunc->addFnAttr(Attribute::NoUnwind);
+  // Create __pcl_parallel_for(body, context, begin, end), it calls
+  // body(context, from, to) for the parts of [begin, end) in several threads
+  auto *PtrTy = PointerType::get(Context, 0);
+  createFunction(getVoidTy(), Function::ExternalLinkage,
+                 ParaCLParallelForFuncName, false, PtrTy, PtrTy, getInt32Ty(),
+                 getInt32Ty());
+  // Create the reductions of the builtins: __pcl_array_sum(array, size),
+  // min, max, __pcl_array_count(array, size, value) and
+  // __pcl_array_dot(array, array, size). They only read the arrays, so the
+  // calls with the same arguments may be combined.
+  auto *Int64Ty = Type::getInt64Ty(Context);
+  auto SetReadOnlyArgs = [](Function *Func, ArrayRef<unsigned> ArrayArgs) {
+    for (auto ArgNo : ArrayArgs) {
+      Func->addParamAttr(ArgNo, Attribute::ReadOnly);
+      Func->addParamAttr(ArgNo, Attribute::NoCapture);
+    }
+    Func->setOnlyReadsMemory();
+    Func->setOnlyAccessesArgMemory();
+    Func->addFnAttr(Attribute::NoUnwind);
+  };
+  for (auto Name :
+       {ParaCLArraySumFuncName, ParaCLArrayMinFuncName, ParaCLArrayMaxFuncName})
+    SetReadOnlyArgs(createFunction(getInt32Ty(), Function::ExternalLinkage,
+                                   Name, false, PtrTy, Int64Ty),
+                    {0});
+  SetReadOnlyArgs(createFunction(getInt32Ty(), Function::ExternalLinkage,
+                                 ParaCLArrayCountFuncName, false, PtrTy,
+                                 Int64Ty, getInt32Ty()),
+                  {0});
+  SetReadOnlyArgs(createFunction(getInt32Ty(), Function::ExternalLinkage,
+                                 ParaCLArrayDotFuncName, false, PtrTy, PtrTy,
+                                 Int64Ty),
+                  {0, 1});
+  // Create __pcl_size_error(line, column, size, size),
+  // __pcl_shape_error(line, column, size, size) and
+  // __pcl_division_error(line, column, end line, end column), they never
+  // return
+  for (auto Name : {ParaCLSizeErrorFuncName, ParaCLShapeErrorFuncName,
+                    ParaCLDivisionErrorFuncName}) {
+    auto *SizeErrorFunc =
+        createFunction(getVoidTy(), Function::ExternalLinkage, Name, false,
+                       getInt32Ty(), getInt32Ty(), getInt32Ty(), getInt32Ty());
+    SizeErrorFunc->addFnAttr(Attribute::NoReturn);
+    SizeErrorFunc->addFnAttr(Attribute::Cold);
+    SizeErrorFunc->addFnAttr(Attribute::NoUnwind);
+  }
 }
 
 Function *IRCodeGenerator::createFunction(Type *Ret, ArrayRef<Type *> Args,
@@ -73,5 +143,10 @@ BasicBlock *IRCodeGenerator::createBlockAndLinkWith(BasicBlock *CurrBlock,
 
 const Module &IRCodeGenerator::getModule() const { return *Mod.get(); }
 
+orc::ThreadSafeModule IRCodeGenerator::takeModule() {
+  assert(Mod && ContextPtr);
+  return orc::ThreadSafeModule(std::move(Mod), std::move(ContextPtr));
+}
+
 } // namespace codegen
 } // namespace paracl
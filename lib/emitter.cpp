@@ -0,0 +1,76 @@
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/Program.h>
+
+#include "emitter.hpp"
+#include "option_category.hpp"
+
+namespace paracl {
+namespace codegen {
+
+cl::opt<std::string>
+    Linker("linker",
+           cl::desc("The program used to link the executables (it's only "
+                    "invoked as a linker)"),
+           cl::value_desc("program"), cl::init("c++"),
+           cl::cat(ParaCLCategory));
+
+cl::opt<std::string>
+    RuntimeLib("runtime-lib",
+               cl::desc("The ParaCL runtime library the executables are "
+                        "linked with"),
+               cl::value_desc("archive"), cl::init(PARACL_RUNTIME_LIB),
+               cl::cat(ParaCLCategory));
+
+void emitModule(Module &Mod, TargetMachine &TM, OutputKind Kind,
+                raw_pwrite_stream &Os) {
+  switch (Kind) {
+  case OutputKind::IR:
+    Mod.print(Os, nullptr);
+    return;
+  case OutputKind::Bitcode:
+    WriteBitcodeToFile(Mod, Os);
+    return;
+  case OutputKind::Assembly:
+  case OutputKind::Object: {
+    // The object writer seeks back to patch the headers, so the output is
+    // buffered to support the pipes
+    buffer_ostream BufferOs(Os);
+    auto FileType = Kind == OutputKind::Assembly ? CodeGenFileType::AssemblyFile
+                                                 : CodeGenFileType::ObjectFile;
+    legacy::PassManager PM;
+    if (TM.addPassesToEmitFile(PM, BufferOs, nullptr, FileType))
+      report_fatal_error("the target can't emit a file of this type");
+    PM.run(Mod);
+    return;
+  }
+  case OutputKind::Executable:
+    llvm_unreachable("The executable is produced by linkExecutable");
+  }
+  llvm_unreachable("Unknown output kind");
+}
+
+Error linkExecutable(StringRef ObjectFile, StringRef ExecutableFile) {
+  auto LinkerPath = sys::findProgramByName(Linker);
+  if (!LinkerPath)
+    return createStringError(LinkerPath.getError(),
+                             "can't find the linker '%s'", Linker.c_str());
+
+  // The runtime executes the parallel loops in several threads
+  StringRef Args[] = {*LinkerPath, ObjectFile, RuntimeLib, "-pthread", "-o",
+                      ExecutableFile};
+  std::string ErrMsg;
+  auto RetCode = sys::ExecuteAndWait(*LinkerPath, Args, /*Env=*/{},
+                                     /*Redirects=*/{}, 0, 0, &ErrMsg);
+  if (RetCode < 0)
+    return createStringError(inconvertibleErrorCode(),
+                             "can't run the linker: %s", ErrMsg.c_str());
+  if (RetCode > 0)
+    return createStringError(inconvertibleErrorCode(),
+                             "the linker failed with exit code %d", RetCode);
+  return Error::success();
+}
+
+} // namespace codegen
+} // namespace paracl
@@ -0,0 +1,241 @@
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/Support/FormatVariadic.h>
+#include <llvm/Support/TargetSelect.h>
+
+#include <cstdlib>
+#include <sstream>
+
+#include "array_fill.hpp"
+#include "array_reduce.hpp"
+#include "codegen.hpp"
+#include "codegen_visitor.hpp"
+#include "jit.hpp"
+#include "loop_analyzer.hpp"
+#include "optimizer.hpp"
+#include "thread_pool.hpp"
+#include "utils.hpp"
+
+namespace paracl {
+namespace codegen {
+
+namespace {
+
+runtime::OutputBuffer *HostOutput = nullptr;
+runtime::InputReader *HostInput = nullptr;
+
+// The counterparts of lib/std_pcl_lib/pcllib.cpp for the JIT
+void hostPrint(int Val) { HostOutput->printInt(Val); }
+
+void hostPrintArray(const int32_t *Arr, int64_t Size) {
+  HostOutput->printInts(Arr, Size);
+}
+
+void hostFillArray(int32_t *Arr, int64_t Size, const int32_t *Pattern,
+                   int64_t PatternSize) {
+  runtime::fillArray(Arr, Size, Pattern, PatternSize);
+}
+
+void hostParallelFor(runtime::LoopBodyTy Body, void *Ctx, int32_t Begin,
+                     int32_t End) {
+  runtime::parallelFor(Body, Ctx, Begin, End);
+}
+
+int hostScan() {
+  int32_t Val = 0;
+  HostOutput->flushBeforeInput();
+  if (!HostInput->readInt(Val)) {
+    HostOutput->flush();
+    std::cerr << "Problem reading stdin\n";
+    std::exit(1);
+  }
+  return Val;
+}
+
+void hostIndexError(int Line, int Column, int Index, int Size) {
+  paracl::fatalRuntimeError(
+      *HostOutput, formatv("{0}.{1}: array index {2} is out of range [0, {3})",
+                           Line, Column, Index, Size));
+}
+
+void hostSizeError(int Line, int Column, int LhsSize, int RhsSize) {
+  paracl::fatalRuntimeError(
+      *HostOutput, formatv("{0}.{1}: dot of the arrays of the different sizes "
+                           "{2} and {3}",
+                           Line, Column, LhsSize, RhsSize));
+}
+
+void hostShapeError(int Line, int Column, int LhsSize, int RhsSize) {
+  paracl::fatalRuntimeError(
+      *HostOutput, formatv("{0}.{1}: element-wise operation on the arrays of "
+                           "the different sizes {2} and {3}",
+                           Line, Column, LhsSize, RhsSize));
+}
+
+// The error of the division in the loops compiled in the tiered mode, it's
+// reported like by the interpreter
+void hostDivisionError(int Line, int Column, int EndLine, int EndColumn) {
+  yy::location Loc(yy::position(nullptr, Line, Column),
+                   yy::position(nullptr, EndLine, EndColumn));
+  std::ostringstream Str;
+  Str << Loc;
+  paracl::fatalRuntimeError(
+      *HostOutput, formatv("{0}, trying to divide by 0", Str.str()));
+}
+
+} // namespace
+
+Expected<std::unique_ptr<ParaCLJIT>>
+ParaCLJIT::create(OptimizationLevel OptLevel, runtime::OutputBuffer &Output,
+                  runtime::InputReader &Input) {
+  InitializeNativeTarget();
+  InitializeNativeTargetAsmPrinter();
+
+  auto JTMB = orc::JITTargetMachineBuilder::detectHost();
+  if (!JTMB)
+    return JTMB.takeError();
+  setTargetCPU(*JTMB);
+  auto TM = JTMB->createTargetMachine();
+  if (!TM)
+    return TM.takeError();
+
+  auto Jit = orc::LLJITBuilder()
+                 .setJITTargetMachineBuilder(std::move(*JTMB))
+                 .create();
+  if (!Jit)
+    return Jit.takeError();
+
+  auto &MainJD = (*Jit)->getMainJITDylib();
+  // The arrays are allocated with malloc and free from the host libc
+  auto ProcessSymbols =
+      orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+          (*Jit)->getDataLayout().getGlobalPrefix());
+  if (!ProcessSymbols)
+    return ProcessSymbols.takeError();
+  MainJD.addGenerator(std::move(*ProcessSymbols));
+
+  orc::MangleAndInterner Mangle((*Jit)->getExecutionSession(),
+                                (*Jit)->getDataLayout());
+  orc::SymbolMap HostSymbols{
+      {Mangle(IRCodeGenerator::ParaCLPrintFuncName),
+       orc::ExecutorSymbolDef(orc::ExecutorAddr::fromPtr(&hostPrint),
+                              JITSymbolFlags::Exported)},
+      {Mangle(IRCodeGenerator::ParaCLPrintArrayFuncName),
+       orc::ExecutorSymbolDef(orc::ExecutorAddr::fromPtr(&hostPrintArray),
+                              JITSymbolFlags::Exported)},
+      {Mangle(IRCodeGenerator::ParaCLFillArrayFuncName),
+       orc::ExecutorSymbolDef(orc::ExecutorAddr::fromPtr(&hostFillArray),
+                              JITSymbolFlags::Exported)},
+      {Mangle(IRCodeGenerator::ParaCLParallelForFuncName),
+       orc::ExecutorSymbolDef(orc::ExecutorAddr::fromPtr(&hostParallelFor),
+                              JITSymbolFlags::Exported)},
+      {Mangle(IRCodeGenerator::ParaCLScanFuncName),
+       orc::ExecutorSymbolDef(orc::ExecutorAddr::fromPtr(&hostScan),
+                              JITSymbolFlags::Exported)},
+      {Mangle(IRCodeGenerator::ParaCLIndexErrorFuncName),
+       orc::ExecutorSymbolDef(orc::ExecutorAddr::fromPtr(&hostIndexError),
+                              JITSymbolFlags::Exported)},
+      // The kernels of the reductions take the arguments of the runtime
+      // functions as is
+      {Mangle(IRCodeGenerator::ParaCLArraySumFuncName),
+       orc::ExecutorSymbolDef(orc::ExecutorAddr::fromPtr(&runtime::sumArray),
+                              JITSymbolFlags::Exported)},
+      {Mangle(IRCodeGenerator::ParaCLArrayMinFuncName),
+       orc::ExecutorSymbolDef(orc::ExecutorAddr::fromPtr(&runtime::minArray),
+                              JITSymbolFlags::Exported)},
+      {Mangle(IRCodeGenerator::ParaCLArrayMaxFuncName),
+       orc::ExecutorSymbolDef(orc::ExecutorAddr::fromPtr(&runtime::maxArray),
+                              JITSymbolFlags::Exported)},
+      {Mangle(IRCodeGenerator::ParaCLArrayCountFuncName),
+       orc::ExecutorSymbolDef(
+           orc::ExecutorAddr::fromPtr(&runtime::countInArray),
+           JITSymbolFlags::Exported)},
+      {Mangle(IRCodeGenerator::ParaCLArrayDotFuncName),
+       orc::ExecutorSymbolDef(orc::ExecutorAddr::fromPtr(&runtime::dotArrays),
+                              JITSymbolFlags::Exported)},
+      {Mangle(IRCodeGenerator::ParaCLSizeErrorFuncName),
+       orc::ExecutorSymbolDef(orc::ExecutorAddr::fromPtr(&hostSizeError),
+                              JITSymbolFlags::Exported)},
+      {Mangle(IRCodeGenerator::ParaCLShapeErrorFuncName),
+       orc::ExecutorSymbolDef(orc::ExecutorAddr::fromPtr(&hostShapeError),
+                              JITSymbolFlags::Exported)},
+      {Mangle(IRCodeGenerator::ParaCLDivisionErrorFuncName),
+       orc::ExecutorSymbolDef(orc::ExecutorAddr::fromPtr(&hostDivisionError),
+                              JITSymbolFlags::Exported)}};
+  if (auto Err = MainJD.define(orc::absoluteSymbols(std::move(HostSymbols))))
+    return Err;
+
+  HostOutput = &Output;
+  HostInput = &Input;
+  return std::unique_ptr<ParaCLJIT>(
+      new ParaCLJIT(std::move(*Jit), std::move(*TM), OptLevel));
+}
+
+Error ParaCLJIT::addModule(orc::ThreadSafeModule TSM) {
+  TSM.withModuleDo([&](Module &Mod) {
+    setTargetAttributes(Mod, *TM);
+    optimizeModule(Mod, *TM, OptLevel);
+  });
+  return Jit->addIRModule(std::move(TSM));
+}
+
+Error runInJIT(orc::ThreadSafeModule TSM, OptimizationLevel OptLevel,
+               runtime::OutputBuffer &Output, runtime::InputReader &Input) {
+  auto Jit = ParaCLJIT::create(OptLevel, Output, Input);
+  if (!Jit)
+    return Jit.takeError();
+  if (auto Err = (*Jit)->addModule(std::move(TSM)))
+    return Err;
+
+  auto PCLStart = (*Jit)->lookup<void()>(IRCodeGenerator::ParaCLStartFuncName);
+  if (!PCLStart)
+    return PCLStart.takeError();
+  (*PCLStart)();
+  Output.flush();
+  return Error::success();
+}
+
+HotLoopCompiler::HotLoopCompiler(StringRef ModuleName,
+                                 OptimizationLevel OptLevel,
+                                 runtime::OutputBuffer &Output,
+                                 runtime::InputReader &Input)
+    : ModuleName(ModuleName) {
+  auto JitOrErr = ParaCLJIT::create(OptLevel, Output, Input);
+  if (!JitOrErr)
+    paracl::fatal(toString(JitOrErr.takeError()));
+  Jit = std::move(*JitOrErr);
+}
+
+const CompiledLoop *
+HotLoopCompiler::getCompiledLoop(ast::while_operator *While) {
+  auto [Found, IsNew] = Loops.try_emplace(While);
+  if (IsNew)
+    Found->second = compileLoop(While);
+  return Found->second.get();
+}
+
+std::unique_ptr<CompiledLoop>
+HotLoopCompiler::compileLoop(ast::while_operator *While) {
+  LoopAnalyzer Analyzer;
+  if (!Analyzer.run(While))
+    return nullptr;
+
+  auto LoopID = Loops.size();
+  auto FuncName = formatv("__pcl_loop_{0}", LoopID).str();
+  CodeGenVisitor CodeGenVis(formatv("{0}.loop{1}", ModuleName, LoopID).str());
+  auto LoopModule =
+      CodeGenVis.generateLoopModule(While, Analyzer.getLiveIns(), FuncName);
+  if (auto Err = Jit->addModule(std::move(LoopModule)))
+    paracl::fatal(toString(std::move(Err)));
+  auto Entry = Jit->lookup<CompiledLoop::EntryTy>(FuncName);
+  if (!Entry)
+    paracl::fatal(toString(Entry.takeError()));
+
+  auto Loop = std::make_unique<CompiledLoop>();
+  Loop->Entry = *Entry;
+  for (auto &LiveIn : Analyzer.getLiveIns())
+    Loop->LiveIns.push_back(LiveIn.Slot);
+  return Loop;
+}
+
+} // namespace codegen
+} // namespace paracl
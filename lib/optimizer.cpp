@@ -0,0 +1,104 @@
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/TargetParser/Host.h>
+#include <llvm/TargetParser/SubtargetFeature.h>
+
+#include "option_category.hpp"
+#include "optimizer.hpp"
+
+namespace paracl {
+namespace codegen {
+
+cl::opt<std::string>
+    TargetCPU("mcpu",
+              cl::desc("Target a specific cpu type (-mcpu=native for the "
+                       "host cpu)"),
+              cl::value_desc("cpu-name"), cl::init("generic"),
+              cl::cat(ParaCLCategory));
+
+namespace {
+
+// Returns the cpu selected by -mcpu and adds its features to Features
+std::string getTargetCPU(SubtargetFeatures &Features) {
+  std::string CPU = TargetCPU;
+  if (CPU == "native") {
+    CPU = sys::getHostCPUName().str();
+    for (auto &Feature : sys::getHostCPUFeatures())
+      Features.AddFeature(Feature.getKey(), Feature.getValue());
+  }
+  return CPU;
+}
+
+} // namespace
+
+Expected<std::unique_ptr<TargetMachine>>
+createTargetMachine(StringRef TargetTriple) {
+  InitializeAllTargetInfos();
+  InitializeAllTargets();
+  InitializeAllTargetMCs();
+  InitializeAllAsmParsers();
+  InitializeAllAsmPrinters();
+
+  std::string Error;
+  auto *Target = TargetRegistry::lookupTarget(TargetTriple.str(), Error);
+  if (!Target)
+    return createStringError(inconvertibleErrorCode(), Error);
+
+  SubtargetFeatures Features;
+  auto CPU = getTargetCPU(Features);
+
+  TargetOptions Options;
+  return std::unique_ptr<TargetMachine>(Target->createTargetMachine(
+      TargetTriple, CPU, Features.getString(), Options, Reloc::PIC_));
+}
+
+void setTargetCPU(orc::JITTargetMachineBuilder &JTMB) {
+  if (!TargetCPU.getNumOccurrences())
+    return;
+  SubtargetFeatures Features;
+  JTMB.setCPU(getTargetCPU(Features));
+  JTMB.setFeatures(Features.getString());
+}
+
+void setTargetAttributes(Module &Mod, const TargetMachine &TM) {
+  Mod.setDataLayout(TM.createDataLayout());
+  Mod.setTargetTriple(TM.getTargetTriple().str());
+  auto CPU = TM.getTargetCPU();
+  auto Features = TM.getTargetFeatureString();
+  for (auto &Func : Mod) {
+    if (Func.isDeclaration())
+      continue;
+    if (!CPU.empty())
+      Func.addFnAttr("target-cpu", CPU);
+    if (!Features.empty())
+      Func.addFnAttr("target-features", Features);
+  }
+}
+
+void optimizeModule(Module &Mod, TargetMachine &TM, OptimizationLevel Level) {
+  if (Level == OptimizationLevel::O0)
+    return;
+
+  LoopAnalysisManager LAM;
+  FunctionAnalysisManager FAM;
+  CGSCCAnalysisManager CGAM;
+  ModuleAnalysisManager MAM;
+
+  PipelineTuningOptions PTO;
+  PTO.LoopVectorization = Level.getSpeedupLevel() > 1;
+  PTO.SLPVectorization = Level.getSpeedupLevel() > 1;
+  PassBuilder PB(&TM, PTO);
+  PB.registerModuleAnalyses(MAM);
+  PB.registerCGSCCAnalyses(CGAM);
+  PB.registerFunctionAnalyses(FAM);
+  PB.registerLoopAnalyses(LAM);
+  PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+  auto MPM = PB.buildPerModuleDefaultPipeline(Level);
+  MPM.run(Mod, MAM);
+}
+
+} // namespace codegen
+} // namespace paracl
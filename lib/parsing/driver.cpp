@@ -1,10 +1,20 @@
 
 #include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/FileUtilities.h>
 
+#include "bytecode_compiler.hpp"
 #include "codegen_visitor.hpp"
+#include "constant_folder.hpp"
+#include "dependence_analyzer.hpp"
 #include "driver.hpp"
 #include "interpreter.hpp"
+#include "jit.hpp"
 #include "option_category.hpp"
+#include "range_analyzer.hpp"
+#include "resolver.hpp"
+#include "utils.hpp"
+#include "vm.hpp"
 
 namespace cl = llvm::cl;
 
@@ -14,6 +24,30 @@ cl::opt<std::string> DumpCfg("dump-cfg",
                              cl::init("paracl-dump-cfg.dot"),
                              cl::cat(paracl::ParaCLCategory));
 
+cl::opt<bool> DisableASTOpt(
+    "disable-ast-opt",
+    cl::desc("don't fold the constant expressions in the AST before the "
+             "execution"),
+    cl::init(false), cl::cat(paracl::ParaCLCategory));
+
+cl::opt<bool> Checked(
+    "checked",
+    cl::desc("check the indexes of the array accesses at runtime, except the "
+             "ones proven to be in bounds"),
+    cl::init(false), cl::cat(paracl::ParaCLCategory));
+
+cl::opt<bool> AutoPar(
+    "auto-par",
+    cl::desc("execute the while loops with the independent iterations in "
+             "parallel in the compiled code and report the rejected loops"),
+    cl::init(false), cl::cat(paracl::ParaCLCategory));
+
+cl::opt<unsigned> HotLoopThreshold(
+    "hot-loop-threshold",
+    cl::desc("the number of iterations after which a loop is compiled in the "
+             "tiered mode"),
+    cl::init(1000), cl::cat(paracl::ParaCLCategory));
+
 namespace yy {
 
 void driver::parse() { parser_.parse(); }
@@ -47,16 +81,97 @@ std::optional<paracl::ErrorHandler> driver::validate() const {
   return {std::move(Handler)};
 }
 
-void driver::evaluate(std::ostream &output, std::istream &input) {
-  paracl::Interpreter runner(input, output);
+void driver::optimize() {
+  if (DisableASTOpt)
+    return;
+  paracl::ConstantFolder Folder(ast_);
+  Folder.run(ast_.root_ptr());
+}
+
+void driver::resolve() {
+  paracl::Resolver VarResolver;
+  VarResolver.run(ast_.root_ptr());
+}
+
+void driver::insert_bounds_checks() {
+  if (!Checked)
+    return;
+  paracl::RangeAnalyzer Analyzer;
+  Analyzer.run(ast_.root_ptr());
+}
+
+void driver::parallelize_loops(llvm::StringRef FileName) {
+  if (!AutoPar)
+    return;
+  paracl::DependenceAnalyzer Analyzer;
+  Analyzer.run(ast_.root_ptr());
+  Analyzer.print_report(llvm::errs(), FileName);
+}
+
+void driver::evaluate(paracl::runtime::InputReader &input,
+                      std::ostream &output) {
+  paracl::runtime::OutputBuffer Output(output);
+  paracl::Interpreter runner(input, Output);
+  runner.run_program(ast_.root_ptr());
+}
+
+void driver::evaluate_tiered(llvm::StringRef ModuleName,
+                             llvm::OptimizationLevel OptLevel,
+                             paracl::runtime::InputReader &input,
+                             std::ostream &output) {
+  // The interpreter and the compiled loops print to the same buffer, so the
+  // order of the output is kept
+  paracl::runtime::OutputBuffer Output(output);
+  paracl::codegen::HotLoopCompiler LoopCompiler(ModuleName, OptLevel, Output,
+                                                input);
+  paracl::Interpreter runner(input, Output, LoopCompiler, HotLoopThreshold);
   runner.run_program(ast_.root_ptr());
 }
 
-void driver::compile(llvm::StringRef ModuleName, llvm::raw_ostream &Os) {
+void driver::execute(paracl::runtime::InputReader &input,
+                     std::ostream &output) {
+  paracl::BytecodeCompiler Compiler;
+  auto Prog = Compiler.compile(ast_.root_ptr());
+  paracl::runtime::OutputBuffer Output(output);
+  paracl::vm::VirtualMachine Machine(input, Output);
+  Machine.run(Prog);
+}
+
+void driver::compile(llvm::StringRef ModuleName, llvm::raw_pwrite_stream &Os,
+                     llvm::OptimizationLevel OptLevel,
+                     paracl::codegen::OutputKind Kind) {
   paracl::CodeGenVisitor CodeGenVis(ModuleName);
-  CodeGenVis.generateIRCode(ast_.root_ptr(), Os);
+  CodeGenVis.generateCode(ast_.root_ptr(), Os, OptLevel, Kind);
   if (DumpCfg.getNumOccurrences() > 0)
     CodeGenVis.dumpInDotFormat(DumpCfg);
 }
 
+void driver::build_executable(llvm::StringRef ModuleName,
+                              llvm::StringRef ExecutableFile,
+                              llvm::OptimizationLevel OptLevel) {
+  int ObjectFD = 0;
+  llvm::SmallString<128> ObjectFile;
+  if (auto ErrCode = llvm::sys::fs::createTemporaryFile(ModuleName, "o",
+                                                        ObjectFD, ObjectFile))
+    paracl::fatal(ErrCode.message());
+  llvm::FileRemover ObjectRemover(ObjectFile);
+  {
+    llvm::raw_fd_ostream ObjectOs(ObjectFD, /*shouldClose=*/true);
+    compile(ModuleName, ObjectOs, OptLevel,
+            paracl::codegen::OutputKind::Object);
+  }
+  if (auto Err = paracl::codegen::linkExecutable(ObjectFile, ExecutableFile))
+    paracl::fatal(llvm::toString(std::move(Err)));
+}
+
+void driver::jit(llvm::StringRef ModuleName, llvm::OptimizationLevel OptLevel,
+                 paracl::runtime::InputReader &input, std::ostream &output) {
+  paracl::CodeGenVisitor CodeGenVis(ModuleName);
+  auto Module = CodeGenVis.generateModule(ast_.root_ptr());
+  paracl::runtime::OutputBuffer Output(output);
+  if (auto Err = paracl::codegen::runInJIT(std::move(Module), OptLevel, Output,
+                                           input))
+    paracl::fatal(llvm::toString(std::move(Err)));
+}
+
 } // namespace yy
@@ -21,6 +21,7 @@
 #include <stdexcept>
 #include <utility>
 #include <cassert>
+#include <vector>
 
 #include "ast_includes.hpp"
 
@@ -90,6 +91,7 @@ static yy::parser::symbol_type yylex(yy::scanner &scanner) {
   IF         "if"
   ELSE       "else"
   WHILE      "while"
+  PFOR       "pfor"
   PRINT      "print"
   ARRAY      "array"
   REPEAT     "repeat"
@@ -144,7 +146,8 @@ static yy::parser::symbol_type yylex(yy::scanner &scanner) {
 %nterm <variable*>           variable
 
 %nterm <expression*>         print_expression
-%nterm <ctrl_statement*>     ctrl_statement
+%nterm <std::vector<expression*>> call_arguments
+%nterm <statement*>          ctrl_statement
 
 %left LESS LESS_EQ GREATER GREATER_EQ
 %left EQ NEQ
@@ -214,6 +217,27 @@ base_expression:
     | NUMBER { $$ = driver.make_node<number>($1, @$); }
     | SCAN { $$ = driver.make_node<read_expression>(@$); }
     | lvalue_operand { $$ = $1; }
+    | VAR OP_BRACK call_arguments CL_BRACK {
+        auto Name = std::string($1.str());
+        auto Op = reduce_function::find(Name);
+        if (!Op)
+            error(@1, "unknown function '" + Name + "'");
+        auto NumArgs = reduce_function::num_args(*Op);
+        if ($3.size() != NumArgs)
+            error(@$, "'" + Name + "' takes " + std::to_string(NumArgs) +
+                      (NumArgs == 1 ? " argument" : " arguments"));
+        $$ = driver.make_node<reduce_function>(
+            *Op, $3.front(), NumArgs > 1 ? $3.back() : nullptr, @$
+        );
+    }
+;
+
+call_arguments:
+    expression { $$.push_back($1); }
+    | call_arguments COMMA expression {
+        $$ = std::move($1);
+        $$.push_back($3);
+    }
 ;
 
 unary_expression:
@@ -428,6 +452,20 @@ ctrl_statement:
         driver.change_scope(blocks.top());
         $$ = driver.make_node<if_operator>($3, $5, $7, @$);
     }
+    | PFOR OP_BRACK VAR ASSIGN expression SCOLON VAR LESS expression CL_BRACK {
+        // The loop variable is declared in the block of the body, it's popped
+        // as the scope of the control statement
+        blocks.push(driver.make_block());
+        driver.change_scope(blocks.top());
+    } statement {
+        if ($3.str() != $7.str())
+            error(@7, "the condition of pfor must compare the loop variable '" +
+                      std::string($3.str()) + "'");
+        auto *Body = blocks.top();
+        Body->add($12);
+        auto *LoopVar = driver.make_node<variable>(Body, std::move($3), @3);
+        $$ = driver.make_node<pfor_operator>(LoopVar, $5, $9, Body, @$);
+    }
 ;
 
 %%
@@ -1,17 +1,101 @@
+#include <cstdint>
 #include <iostream>
 
+#include "array_fill.hpp"
+#include "array_reduce.hpp"
+#include "input_reader.hpp"
+#include "output_buffer.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+
+paracl::runtime::InputReader Input(STDIN_FILENO);
+paracl::runtime::OutputBuffer Output(std::cout);
+
+} // namespace
+
 extern "C" void __pcl_start();
 
-extern "C" void __pcl_print(int n) { std::cout << n << std::endl; }
+extern "C" void __pcl_print(int n) { Output.printInt(n); }
+
+extern "C" void __pcl_print_array(const int32_t *Arr, int64_t Size) {
+  Output.printInts(Arr, Size);
+}
+
+extern "C" void __pcl_fill_array(int32_t *Arr, int64_t Size,
+                                 const int32_t *Pattern, int64_t PatternSize) {
+  paracl::runtime::fillArray(Arr, Size, Pattern, PatternSize);
+}
+
+extern "C" void __pcl_parallel_for(paracl::runtime::LoopBodyTy Body, void *Ctx,
+                                   int32_t Begin, int32_t End) {
+  paracl::runtime::parallelFor(Body, Ctx, Begin, End);
+}
+
+extern "C" int32_t __pcl_array_sum(const int32_t *Arr, int64_t Size) {
+  return paracl::runtime::sumArray(Arr, Size);
+}
+
+extern "C" int32_t __pcl_array_min(const int32_t *Arr, int64_t Size) {
+  return paracl::runtime::minArray(Arr, Size);
+}
+
+extern "C" int32_t __pcl_array_max(const int32_t *Arr, int64_t Size) {
+  return paracl::runtime::maxArray(Arr, Size);
+}
+
+extern "C" int32_t __pcl_array_count(const int32_t *Arr, int64_t Size,
+                                     int32_t Val) {
+  return paracl::runtime::countInArray(Arr, Size, Val);
+}
+
+extern "C" int32_t __pcl_array_dot(const int32_t *Lhs, const int32_t *Rhs,
+                                   int64_t Size) {
+  return paracl::runtime::dotArrays(Lhs, Rhs, Size);
+}
 
 extern "C" int __pcl_scan() {
-  int n;
-  std::cin >> n;
-  if (!std::cin) {
+  int32_t n;
+  Output.flushBeforeInput();
+  if (!Input.readInt(n)) {
+    Output.flush();
     std::cerr << "Problem reading stdin\n";
     exit(1);
   }
   return n;
 }
 
-int main() { __pcl_start(); }
+extern "C" void __pcl_index_error(int Line, int Column, int Index,
+                                  int Size) {
+  paracl::runtime::exitWithError([&] {
+    Output.flush();
+    std::cerr << "error: " << Line << '.' << Column << ": array index "
+              << Index << " is out of range [0, " << Size << ")\n";
+  });
+}
+
+extern "C" void __pcl_size_error(int Line, int Column, int LhsSize,
+                                 int RhsSize) {
+  paracl::runtime::exitWithError([&] {
+    Output.flush();
+    std::cerr << "error: " << Line << '.' << Column
+              << ": dot of the arrays of the different sizes " << LhsSize
+              << " and " << RhsSize << "\n";
+  });
+}
+
+extern "C" void __pcl_shape_error(int Line, int Column, int LhsSize,
+                                  int RhsSize) {
+  paracl::runtime::exitWithError([&] {
+    Output.flush();
+    std::cerr << "error: " << Line << '.' << Column
+              << ": element-wise operation on the arrays of the different "
+                 "sizes "
+              << LhsSize << " and " << RhsSize << "\n";
+  });
+}
+
+int main() {
+  __pcl_start();
+  Output.flush();
+}
@@ -4,6 +4,8 @@
 #include <llvm/Support/raw_ostream.h>
 
 #include "codegen.hpp"
+#include "output_buffer.hpp"
+#include "thread_pool.hpp"
 #include "utils.hpp"
 
 namespace llvm {
@@ -69,6 +71,14 @@ void dumpInDotFormat(const Module &Mod, StringRef FileNameToDump) {
   llvm_unreachable("paracl::fatal should never return");
 }
 
+[[noreturn]] void fatalRuntimeError(runtime::OutputBuffer &Output,
+                                    Twine ErrMes) {
+  runtime::exitWithError([&] {
+    Output.flush();
+    errs() << "error: " << ErrMes << "\n";
+  });
+}
+
 const int ParaCLDiagnosticInfo::KindID = getNextAvailablePluginDiagnosticKind();
 
 } // namespace paracl
@@ -0,0 +1,506 @@
+#include <llvm/Support/ErrorHandling.h>
+
+#include <algorithm>
+#include <climits>
+
+#include "ast_includes.hpp"
+#include "bytecode_compiler.hpp"
+
+namespace paracl {
+
+using ResultTy = BytecodeCompiler::ResultTy;
+using vm::OpCode;
+
+ResultTy BytecodeCompiler::visit(ast::root_statement_block *StmBlock) {
+  visit(static_cast<ast::statement_block *>(StmBlock));
+  Prog.emit(OpCode::Halt);
+  return createWrapperRef();
+}
+
+ResultTy BytecodeCompiler::visit(ast::statement_block *StmBlock) {
+  for (auto *CurStatement : *StmBlock)
+    acceptStatement(CurStatement);
+  // The arrays declared in the block don't live after its exit
+  if (auto Found = ArraysToFree.find(StmBlock); Found != ArraysToFree.end())
+    for (auto ArrReg : Found->second)
+      Prog.emit(OpCode::FreeArray, ArrReg);
+  return createWrapperRef();
+}
+
+ResultTy BytecodeCompiler::visit(ast::calc_expression *CalcExp) {
+  if (CalcExp->is_element_wise())
+    return emitElementWise(CalcExp);
+  auto LhsReg = acceptASTNode(CalcExp->left()).Reg;
+  auto Dst = allocateRegister();
+  // Adding a constant is the most frequent operation in the loops, so it has
+  // a separate instruction with an immediate operand
+  if (auto *Num = dynamic_cast<ast::number *>(CalcExp->right());
+      Num && Num->get_value() != INT_MIN &&
+      (CalcExp->type() == ast::CalcOp::ADD ||
+       CalcExp->type() == ast::CalcOp::SUB)) {
+    auto Imm = CalcExp->type() == ast::CalcOp::ADD ? Num->get_value()
+                                                   : -Num->get_value();
+    Prog.emit(OpCode::AddImm, Dst, LhsReg, Imm);
+    return createWrapperRef(KindTy::Int, Dst);
+  }
+
+  auto RhsReg = acceptASTNode(CalcExp->right()).Reg;
+  switch (CalcExp->type()) {
+  case ast::CalcOp::ADD:
+    Prog.emit(OpCode::Add, Dst, LhsReg, RhsReg);
+    break;
+  case ast::CalcOp::SUB:
+    Prog.emit(OpCode::Sub, Dst, LhsReg, RhsReg);
+    break;
+  case ast::CalcOp::MUL:
+    Prog.emit(OpCode::Mul, Dst, LhsReg, RhsReg);
+    break;
+  case ast::CalcOp::PERCENT:
+    Prog.emit(OpCode::Rem, Dst, LhsReg, RhsReg);
+    break;
+  case ast::CalcOp::DIV:
+    Prog.setLocation(Prog.emit(OpCode::Div, Dst, LhsReg, RhsReg),
+                     CalcExp->location());
+    break;
+  default:
+    llvm_unreachable("Unsupported calculation operator");
+  }
+  return createWrapperRef(KindTy::Int, Dst);
+}
+
+ResultTy BytecodeCompiler::visit(ast::logic_expression *LogExp) {
+  if (LogExp->is_element_wise())
+    return emitElementWise(LogExp);
+  auto Dst = allocateRegister();
+  if (LogExp->type() == ast::LogicOp::AND ||
+      LogExp->type() == ast::LogicOp::OR) {
+    // Short-circuit evaluation: skip the right operand if the result is
+    // already known
+    auto LhsReg = acceptASTNode(LogExp->left()).Reg;
+    Prog.emit(OpCode::ToBool, Dst, LhsReg);
+    auto JumpID = Prog.emit(LogExp->type() == ast::LogicOp::AND
+                                ? OpCode::JumpIfZero
+                                : OpCode::JumpIfNotZero,
+                            Dst);
+    auto RhsReg = acceptASTNode(LogExp->right()).Reg;
+    Prog.emit(OpCode::ToBool, Dst, RhsReg);
+    patchJumpTarget(JumpID, Prog.size());
+    return createWrapperRef(KindTy::Int, Dst);
+  }
+
+  auto LhsReg = acceptASTNode(LogExp->left()).Reg;
+  auto RhsReg = acceptASTNode(LogExp->right()).Reg;
+  switch (LogExp->type()) {
+  case ast::LogicOp::LESS:
+    Prog.emit(OpCode::Less, Dst, LhsReg, RhsReg);
+    break;
+  case ast::LogicOp::LESS_EQ:
+    Prog.emit(OpCode::LessEq, Dst, LhsReg, RhsReg);
+    break;
+  case ast::LogicOp::GREATER:
+    Prog.emit(OpCode::Greater, Dst, LhsReg, RhsReg);
+    break;
+  case ast::LogicOp::GREATER_EQ:
+    Prog.emit(OpCode::GreaterEq, Dst, LhsReg, RhsReg);
+    break;
+  case ast::LogicOp::EQ:
+    Prog.emit(OpCode::Equal, Dst, LhsReg, RhsReg);
+    break;
+  case ast::LogicOp::NEQ:
+    Prog.emit(OpCode::NotEqual, Dst, LhsReg, RhsReg);
+    break;
+  default:
+    llvm_unreachable("Unsupported logic operator");
+  }
+  return createWrapperRef(KindTy::Int, Dst);
+}
+
+ResultTy BytecodeCompiler::visit(ast::un_operator *UnOp) {
+  auto ArgReg = acceptASTNode(UnOp->arg()).Reg;
+  switch (UnOp->type()) {
+  case ast::UnOp::PLUS:
+    return createWrapperRef(KindTy::Int, ArgReg);
+  case ast::UnOp::MINUS: {
+    auto Dst = allocateRegister();
+    Prog.emit(OpCode::Neg, Dst, ArgReg);
+    return createWrapperRef(KindTy::Int, Dst);
+  }
+  case ast::UnOp::NEGATE: {
+    auto Dst = allocateRegister();
+    Prog.emit(OpCode::Not, Dst, ArgReg);
+    return createWrapperRef(KindTy::Int, Dst);
+  }
+  default:
+    llvm_unreachable("Unsupported unary operator");
+  }
+}
+
+ResultTy BytecodeCompiler::visit(ast::number *Num) {
+  auto Dst = allocateRegister();
+  Prog.emit(OpCode::LoadConst, Dst, Num->get_value());
+  return createWrapperRef(KindTy::Int, Dst);
+}
+
+ResultTy BytecodeCompiler::visit(ast::variable *Var) {
+  auto Found = Variables.find(SymTbl.getDeclKeyFor(Var->entityKey()));
+  assert(Found != Variables.end());
+  return createWrapperRef(Found->second.Kind, Found->second.Reg);
+}
+
+ResultTy BytecodeCompiler::visit(ast::assignment *Assign) {
+  auto &IdentVal = acceptASTNode(Assign->getIdentExp());
+  auto [IdentKind, IdentReg] = std::make_pair(IdentVal.Kind, IdentVal.Reg);
+  auto EntityKey = Assign->entityKey();
+  if (!SymTbl.isDefined(EntityKey)) {
+    auto IsArray = IdentKind == KindTy::Array;
+    [[maybe_unused]] auto IsDefined = SymTbl.tryDefine(
+        EntityKey, IsArray ? static_cast<PCLType *>(SymTbl.getArrayTy(
+                                 TypeID::PresetArray, SymTbl.getInt32Ty()))
+                           : SymTbl.getInt32Ty());
+    assert(IsDefined);
+    VMOperand VarOperand(IdentKind);
+    if (IsArray) {
+      VarOperand.Reg = allocateArrayRegister();
+      LastArrayVariableRegister = VarOperand.Reg;
+      ArraysToFree[EntityKey.CurrScope].push_back(VarOperand.Reg);
+    } else {
+      VarOperand.Reg = allocateVariableRegister();
+    }
+    Variables.try_emplace(SymTbl.getDeclKeyFor(EntityKey), VarOperand);
+  }
+
+  auto Found = Variables.find(SymTbl.getDeclKeyFor(EntityKey));
+  assert(Found != Variables.end());
+  auto [VarKind, VarReg] = std::make_pair(Found->second.Kind, Found->second.Reg);
+  if (VarKind == KindTy::Array)
+    Prog.emit(OpCode::MoveArray, VarReg, IdentReg);
+  else if (!retargetLastInstruction(IdentReg, VarReg) && IdentReg != VarReg)
+    Prog.emit(OpCode::Move, VarReg, IdentReg);
+  return createWrapperRef(VarKind, VarReg);
+}
+
+ResultTy BytecodeCompiler::visit(ast::if_operator *If) {
+  auto JumpToElse = emitJumpIfFalse(If->condition());
+  acceptASTNode(If->body());
+  if (auto *ElseBlock = If->else_block()) {
+    auto JumpToEnd = Prog.emit(OpCode::Jump);
+    patchJumpTarget(JumpToElse, Prog.size());
+    acceptASTNode(ElseBlock);
+    patchJumpTarget(JumpToEnd, Prog.size());
+  } else {
+    patchJumpTarget(JumpToElse, Prog.size());
+  }
+  return createWrapperRef();
+}
+
+ResultTy BytecodeCompiler::visit(ast::while_operator *While) {
+  auto CondStart = Prog.size();
+  auto JumpToEnd = emitJumpIfFalse(While->condition());
+  acceptASTNode(While->body());
+  patchJumpTarget(Prog.emit(OpCode::Jump), CondStart);
+  patchJumpTarget(JumpToEnd, Prog.size());
+  return createWrapperRef();
+}
+
+ResultTy BytecodeCompiler::visit(ast::pfor_operator *PFor) {
+  // The bounds are evaluated once, the counter is kept apart from the loop
+  // variable, so the body may change the latter
+  auto InitReg = acceptASTNode(PFor->init()).Reg;
+  auto Counter = allocateRegister();
+  if (!retargetLastInstruction(InitReg, Counter))
+    Prog.emit(OpCode::Move, Counter, InitReg);
+  auto LimitReg = acceptASTNode(PFor->limit()).Reg;
+
+  auto LoopVarKey = PFor->loop_variable()->entityKey();
+  [[maybe_unused]] auto IsDefined =
+      SymTbl.tryDefine(LoopVarKey, SymTbl.getInt32Ty());
+  assert(IsDefined);
+  auto LoopVarReg = allocateVariableRegister();
+  Variables.try_emplace(LoopVarKey, KindTy::Int, LoopVarReg);
+
+  auto CondStart = Prog.size();
+  auto JumpToEnd = Prog.emit(OpCode::JumpIfGreaterEq, Counter, LimitReg);
+  Prog.emit(OpCode::Move, LoopVarReg, Counter);
+  acceptASTNode(PFor->body());
+  Prog.emit(OpCode::AddImm, Counter, Counter, 1);
+  patchJumpTarget(Prog.emit(OpCode::Jump), CondStart);
+  patchJumpTarget(JumpToEnd, Prog.size());
+  return createWrapperRef();
+}
+
+ResultTy BytecodeCompiler::visit(ast::read_expression *ReadExp) {
+  auto Dst = allocateRegister();
+  Prog.setLocation(Prog.emit(OpCode::Scan, Dst), ReadExp->location());
+  return createWrapperRef(KindTy::Int, Dst);
+}
+
+ResultTy BytecodeCompiler::visit(ast::print_function *Print) {
+  auto &Val = acceptASTNode(Print->get());
+  auto [Kind, Reg] = std::make_pair(Val.Kind, Val.Reg);
+  Prog.emit(Kind == KindTy::Array ? OpCode::PrintArray : OpCode::Print, Reg);
+  return createWrapperRef(Kind, Reg);
+}
+
+ResultTy BytecodeCompiler::visit(ast::reduce_function *Reduce) {
+  auto ArrReg = acceptASTNode(Reduce->array()).Reg;
+  vm::RegisterID OperandReg = 0;
+  if (auto *Operand = Reduce->operand())
+    OperandReg = acceptASTNode(Operand).Reg;
+  auto Dst = allocateRegister();
+  switch (Reduce->type()) {
+  case ast::ReduceOp::SUM:
+    Prog.emit(OpCode::ArraySum, Dst, ArrReg);
+    break;
+  case ast::ReduceOp::MIN:
+    Prog.emit(OpCode::ArrayMin, Dst, ArrReg);
+    break;
+  case ast::ReduceOp::MAX:
+    Prog.emit(OpCode::ArrayMax, Dst, ArrReg);
+    break;
+  case ast::ReduceOp::COUNT:
+    Prog.emit(OpCode::ArrayCount, Dst, ArrReg, OperandReg);
+    break;
+  case ast::ReduceOp::DOT:
+    Prog.setLocation(Prog.emit(OpCode::ArrayDot, Dst, ArrReg, OperandReg),
+                     yy::location(Reduce->location().begin));
+    break;
+  default:
+    llvm_unreachable("Unsupported reduction");
+  }
+  return createWrapperRef(KindTy::Int, Dst);
+}
+
+ResultTy BytecodeCompiler::visit(ast::ArrayHolder *ArrStore) {
+  auto *Arr = ArrStore->get();
+  assert(Arr);
+  return acceptASTNode(Arr);
+}
+
+ResultTy BytecodeCompiler::visit(ast::PresetArray *PresetArr) {
+  llvm::SmallVector<std::pair<KindTy, vm::RegisterID>> Elements;
+  Elements.reserve(PresetArr->size());
+  for (auto *CurrExp : *PresetArr) {
+    auto &Elem = acceptASTNode(CurrExp);
+    Elements.emplace_back(Elem.Kind, Elem.Reg);
+  }
+
+  auto Dst = allocateArrayRegister();
+  TempArrays.push_back(Dst);
+  Prog.emit(OpCode::NewPreset, Dst);
+  for (auto [Kind, Reg] : Elements)
+    Prog.emit(Kind == KindTy::Array ? OpCode::AppendArray
+                                    : OpCode::AppendValue,
+              Dst, Reg);
+  return createWrapperRef(KindTy::Array, Dst);
+}
+
+ResultTy BytecodeCompiler::visit(ast::UniformArray *UnifArr) {
+  auto &InitVal = acceptASTNode(UnifArr->getInitExpr());
+  auto [InitKind, InitReg] = std::make_pair(InitVal.Kind, InitVal.Reg);
+  auto SizeReg = acceptASTNode(UnifArr->getSize()).Reg;
+
+  auto Dst = allocateArrayRegister();
+  TempArrays.push_back(Dst);
+  Prog.emit(InitKind == KindTy::Array ? OpCode::RepeatArray
+                                      : OpCode::NewUniform,
+            Dst, InitReg, SizeReg);
+  return createWrapperRef(KindTy::Array, Dst);
+}
+
+ResultTy BytecodeCompiler::visit(ast::ArrayAccess *ArrAccess) {
+  auto [ArrReg, Offset] = emitElementOffset(ArrAccess, /* IsStore */ false);
+  auto Dst = allocateRegister();
+  Prog.emit(OpCode::LoadElem, Dst, ArrReg, Offset);
+  return createWrapperRef(KindTy::Int, Dst);
+}
+
+ResultTy BytecodeCompiler::visit(ast::ArrayAccessAssignment *ArrAssign) {
+  auto [ArrReg, Offset] =
+      emitElementOffset(ArrAssign->getArrayAccess(), /* IsStore */ true);
+  auto IdentReg = acceptASTNode(ArrAssign->getIdentExp()).Reg;
+  Prog.emit(OpCode::StoreElem, ArrReg, Offset, IdentReg);
+  return createWrapperRef(KindTy::Int, IdentReg);
+}
+
+ResultTy BytecodeCompiler::emitElementWise(ast::expression *Exp) {
+  vm::ElementWiseExpr Expr;
+  std::vector<ast::expression *> Nodes;
+  ast::flatten_element_wise(Exp, Expr.Steps, Nodes);
+  for (auto [Step, Node] : llvm::zip(Expr.Steps, Nodes)) {
+    Expr.StepLocations.push_back(Node->location());
+    if (Step.IsOperand) {
+      auto &Operand = acceptASTNode(Node);
+      Expr.Operands.emplace_back(Operand.isArray(), Operand.Reg);
+    }
+  }
+
+  auto Dst = allocateArrayRegister();
+  TempArrays.push_back(Dst);
+  auto ExprID = Prog.addElementWise(std::move(Expr));
+  Prog.setLocation(Prog.emit(OpCode::ElementWise, Dst, ExprID),
+                   yy::location(Exp->location().begin));
+  return createWrapperRef(KindTy::Array, Dst);
+}
+
+vm::Program BytecodeCompiler::compile(ast::root_statement_block *RootBlock) {
+  acceptASTNode(RootBlock);
+  Prog.setRegistersNumber(MaxRegisters);
+  Prog.setArrayRegistersNumber(MaxArrayRegisters);
+  return std::move(Prog);
+}
+
+vm::RegisterID BytecodeCompiler::allocateRegister() {
+  auto Reg = NextRegister++;
+  MaxRegisters = std::max<unsigned>(MaxRegisters, NextRegister);
+  return Reg;
+}
+
+vm::RegisterID BytecodeCompiler::allocateArrayRegister() {
+  auto Reg = NextArrayRegister++;
+  MaxArrayRegisters = std::max<unsigned>(MaxArrayRegisters, NextArrayRegister);
+  return Reg;
+}
+
+vm::RegisterID BytecodeCompiler::allocateVariableRegister() {
+  auto Reg = allocateRegister();
+  LastVariableRegister = Reg;
+  VariableRegisters.resize(std::max<unsigned>(VariableRegisters.size(), Reg + 1));
+  VariableRegisters.set(Reg);
+  return Reg;
+}
+
+void BytecodeCompiler::acceptStatement(ast::statement *Stm) {
+  auto RegisterMark = NextRegister;
+  auto ArrayRegisterMark = NextArrayRegister;
+  auto TempArraysMark = TempArrays.size();
+  auto WrappersMark = markWrappers();
+
+  acceptASTNode(Stm);
+  releaseWrappers(WrappersMark);
+
+  // Release the temporary arrays of the statement and reuse the temporary
+  // registers. The variables defined inside the statement stay alive.
+  for (auto ArrReg : llvm::drop_begin(TempArrays, TempArraysMark))
+    Prog.emit(OpCode::FreeArray, ArrReg);
+  TempArrays.resize(TempArraysMark);
+  NextRegister = std::max(RegisterMark, LastVariableRegister + 1);
+  NextArrayRegister =
+      std::max(ArrayRegisterMark, LastArrayVariableRegister + 1);
+}
+
+unsigned BytecodeCompiler::emitJumpIfFalse(ast::expression *Cond) {
+  // 'while (i < N)' is the most common loop condition, so the comparison and
+  // the jump are fused into one instruction
+  if (auto *LogExp = dynamic_cast<ast::logic_expression *>(Cond);
+      LogExp && LogExp->type() == ast::LogicOp::LESS) {
+    auto LhsReg = acceptASTNode(LogExp->left()).Reg;
+    auto RhsReg = acceptASTNode(LogExp->right()).Reg;
+    return Prog.emit(OpCode::JumpIfGreaterEq, LhsReg, RhsReg);
+  }
+  auto CondReg = acceptASTNode(Cond).Reg;
+  return Prog.emit(OpCode::JumpIfZero, CondReg);
+}
+
+void BytecodeCompiler::patchJumpTarget(unsigned JumpID, unsigned Target) {
+  auto &Jump = Prog[JumpID];
+  switch (Jump.Op) {
+  case OpCode::Jump:
+    Jump.A = Target;
+    break;
+  case OpCode::JumpIfZero:
+  case OpCode::JumpIfNotZero:
+    Jump.B = Target;
+    break;
+  case OpCode::JumpIfGreaterEq:
+    Jump.C = Target;
+    break;
+  default:
+    llvm_unreachable("Trying to patch the target of a non-jump instruction");
+  }
+  LastJumpTarget = std::max(LastJumpTarget, Target);
+}
+
+bool BytecodeCompiler::retargetLastInstruction(vm::RegisterID From,
+                                               vm::RegisterID To) {
+  // The result of the last instruction can be written directly to the
+  // variable register if it's a temporary value and no jump skips the
+  // instruction.
+  if (!Prog.size() || LastJumpTarget == Prog.size() || isVariableRegister(From))
+    return false;
+
+  auto &Last = Prog[Prog.size() - 1];
+  if (Last.A != From)
+    return false;
+  switch (Last.Op) {
+  case OpCode::LoadConst:
+  case OpCode::Move:
+  case OpCode::Add:
+  case OpCode::Sub:
+  case OpCode::Mul:
+  case OpCode::Div:
+  case OpCode::Rem:
+  case OpCode::AddImm:
+  case OpCode::Less:
+  case OpCode::LessEq:
+  case OpCode::Greater:
+  case OpCode::GreaterEq:
+  case OpCode::Equal:
+  case OpCode::NotEqual:
+  case OpCode::Neg:
+  case OpCode::Not:
+  case OpCode::ToBool:
+  case OpCode::Scan:
+  case OpCode::LoadElem:
+  case OpCode::ArraySum:
+  case OpCode::ArrayMin:
+  case OpCode::ArrayMax:
+  case OpCode::ArrayCount:
+  case OpCode::ArrayDot:
+    Last.A = To;
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool BytecodeCompiler::isVariableRegister(vm::RegisterID Reg) const {
+  return static_cast<unsigned>(Reg) < VariableRegisters.size() &&
+         VariableRegisters.test(Reg);
+}
+
+std::pair<vm::RegisterID, vm::RegisterID>
+BytecodeCompiler::emitElementOffset(ast::ArrayAccess *ArrAccess,
+                                    bool IsStore) {
+  auto Found = Variables.find(SymTbl.getDeclKeyFor(ArrAccess->entityKey()));
+  assert(Found != Variables.end() && Found->second.isArray());
+  auto ArrReg = Found->second.Reg;
+
+  // Calculate the row-major offset of an element A[i1][i2]...[in]:
+  // offset = ((i1 * D2 + i2) * D3 + i3) ... * Dn + in
+  vm::RegisterID Offset = 0;
+  for (unsigned Dim = 0; auto *IndexExp : *ArrAccess) {
+    auto IndexReg = acceptASTNode(IndexExp).Reg;
+    if (ArrAccess->needsBoundsCheck(Dim)) {
+      auto CheckID = Prog.emit(OpCode::CheckIndex, IndexReg, ArrReg, Dim);
+      Prog.setLocation(CheckID, yy::location(ArrAccess->location().begin));
+    }
+    if (Dim == 0) {
+      // The offset register is modified by the next dimensions, and the index
+      // of a store must not be changed by its right-hand side, so we copy the
+      // variables.
+      Offset = IndexReg;
+      if (isVariableRegister(IndexReg) &&
+          (IsStore || ArrAccess->getSize() > 1)) {
+        Offset = allocateRegister();
+        Prog.emit(OpCode::Move, Offset, IndexReg);
+      }
+    } else {
+      Prog.emit(OpCode::ScaleIndex, Offset, ArrReg, Dim);
+      Prog.emit(OpCode::Add, Offset, Offset, IndexReg);
+    }
+    ++Dim;
+  }
+  return {ArrReg, Offset};
+}
+
+} // namespace paracl
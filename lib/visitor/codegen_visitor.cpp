@@ -1,17 +1,98 @@
+#include <llvm/ADT/MapVector.h>
+#include <llvm/ADT/SetVector.h>
 #include <llvm/ADT/SmallVector.h>
+#include <llvm/Analysis/ValueTracking.h>
 #include <llvm/IR/BasicBlock.h>
 #include <llvm/IR/Constants.h>
 #include <llvm/IR/DerivedTypes.h>
 #include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/MDBuilder.h>
 #include <llvm/Support/FormatVariadic.h>
 
 #include "ast_includes.hpp"
+#include "element_wise.hpp"
 #include "codegen_visitor.hpp"
 
 namespace paracl {
 
 using ResultTy = CodeGenVisitor::ResultTy;
 
+namespace {
+
+// Whether the expression is computed without the branches and the calls
+bool isStraightLineExpression(ast::expression *Exp) {
+  if (dynamic_cast<ast::number *>(Exp))
+    return true;
+  // It allocates an array and runs its own loop
+  if (ast::is_element_wise(Exp))
+    return false;
+  if (auto *ArrAccess = dynamic_cast<ast::ArrayAccess *>(Exp)) {
+    for (unsigned Dim = 0; Dim < ArrAccess->getSize(); ++Dim)
+      if (ArrAccess->needsBoundsCheck(Dim))
+        return false;
+    return all_of(*ArrAccess, isStraightLineExpression);
+  }
+  if (dynamic_cast<ast::variable *>(Exp))
+    return true;
+  if (auto *CalcExp = dynamic_cast<ast::calc_expression *>(Exp))
+    return isStraightLineExpression(CalcExp->left()) &&
+           isStraightLineExpression(CalcExp->right());
+  if (auto *LogExp = dynamic_cast<ast::logic_expression *>(Exp))
+    return LogExp->type() != ast::LogicOp::AND &&
+           LogExp->type() != ast::LogicOp::OR &&
+           isStraightLineExpression(LogExp->left()) &&
+           isStraightLineExpression(LogExp->right());
+  if (auto *UnOp = dynamic_cast<ast::un_operator *>(Exp))
+    return isStraightLineExpression(UnOp->arg());
+  return false;
+}
+
+// Whether the statement is 'i = i + c' or 'i = i - c'
+bool isInductionStep(ast::assignment *Assign) {
+  auto *Step = dynamic_cast<ast::calc_expression *>(Assign->getIdentExp());
+  if (!Step || (Step->type() != ast::CalcOp::ADD &&
+                Step->type() != ast::CalcOp::SUB))
+    return false;
+  auto *Var = dynamic_cast<ast::variable *>(Step->left());
+  return Var && !dynamic_cast<ast::ArrayAccess *>(Var) &&
+         Var->slot() == Assign->slot() &&
+         dynamic_cast<ast::number *>(Step->right());
+}
+
+bool isElementWiseStatement(ast::statement *Stm, unsigned BodyDepth,
+                            bool &StoresToArray) {
+  if (auto *StmBlock = dynamic_cast<ast::statement_block *>(Stm))
+    return all_of(*StmBlock, [&](auto *CurStatement) {
+      return isElementWiseStatement(CurStatement, BodyDepth, StoresToArray);
+    });
+  if (auto *ArrAssign = dynamic_cast<ast::ArrayAccessAssignment *>(Stm)) {
+    StoresToArray = true;
+    return isStraightLineExpression(ArrAssign->getArrayAccess()) &&
+           isStraightLineExpression(ArrAssign->getIdentExp());
+  }
+  if (auto *Assign = dynamic_cast<ast::assignment *>(Stm))
+    return isStraightLineExpression(Assign->getIdentExp()) &&
+           (Assign->slot().Depth >= BodyDepth || isInductionStep(Assign));
+  return false;
+}
+
+// Whether the loop only computes the elements of the arrays from the values
+// known at its start. The vectorizer is asked to vectorize such loops: it
+// would report the failure for the loops with the branches, the calls or the
+// values carried between the iterations.
+bool isElementWiseLoop(ast::expression *Condition, ast::statement *Body) {
+  if (Condition && !isStraightLineExpression(Condition))
+    return false;
+  auto *StmBlock = dynamic_cast<ast::statement_block *>(Body);
+  bool StoresToArray = false;
+  return isElementWiseStatement(Body, StmBlock ? StmBlock->depth() : ~0u,
+                                StoresToArray) &&
+         StoresToArray;
+}
+
+} // namespace
+
 CodeGenVisitor::CodeGenVisitor(StringRef ModuleName) : CodeGen(ModuleName) {}
 
 // This visit method for root basic block represents the main module of the
@@ -35,17 +116,22 @@ ResultTy CodeGenVisitor::visit(ast::root_statement_block *RootBlock) {
   CodeGen.createBlockAndLinkWith(Builder().GetInsertBlock(), "pcl_exit");
   // Return void for __pcl_start
   Builder().CreateRetVoid();
+  addArrayAliasScopes();
   return createWrapperRef();
 }
 
 ResultTy CodeGenVisitor::visit(ast::statement_block *StmBlock) {
-  for (auto &&CurStatement : *StmBlock)
+  for (auto &&CurStatement : *StmBlock) {
+    auto Mark = markWrappers();
     acceptASTNode(CurStatement);
+    releaseWrappers(Mark);
+  }
   freeResources(StmBlock);
   return createWrapperRef();
 }
 
 ResultTy CodeGenVisitor::visit(ast::calc_expression *CalcExpr) {
+  assert(!CalcExpr->is_element_wise() && "Created by the assignment");
   auto &Lhs = acceptASTNode(CalcExpr->left());
   auto &Rhs = acceptASTNode(CalcExpr->right());
   assert(Lhs && Rhs);
@@ -66,6 +152,8 @@ ResultTy CodeGenVisitor::visit(ast::calc_expression *CalcExpr) {
     return createWrapperRef(Builder().CreateSRem(Lhs, Rhs));
     break;
   case ast::CalcOp::DIV:
+    if (IsDivisionChecked)
+      createDivisionCheck(CalcExpr, Rhs);
     return createWrapperRef(Builder().CreateSDiv(Lhs, Rhs));
     break;
   default:
@@ -74,6 +162,7 @@ ResultTy CodeGenVisitor::visit(ast::calc_expression *CalcExpr) {
 }
 
 ResultTy CodeGenVisitor::visit(ast::logic_expression *LogicExp) {
+  assert(!LogicExp->is_element_wise() && "Created by the assignment");
   auto LogTy = LogicExp->type();
   switch (LogTy) {
   case ast::LogicOp::AND:
@@ -126,7 +215,7 @@ ResultTy CodeGenVisitor::visit(ast::un_operator *UnOper) {
     break;
   case ast::UnOp::NEGATE:
     return createWrapperRef(
-        Builder().CreateICmpEQ(Val, CodeGen.createConstantInt32(0)));
+        Builder().CreateICmpEQ(Val, Constant::getNullValue(Val->getType())));
     break;
   default:
     llvm_unreachable("unrecognized type for un_operator");
@@ -152,7 +241,12 @@ ResultTy CodeGenVisitor::visit(ast::variable *Var) {
 }
 
 ResultTy CodeGenVisitor::visit(ast::assignment *Assign) {
-  auto &AcceptIdentVal = acceptASTNode(Assign->getIdentExp());
+  auto *IdentExp = Assign->getIdentExp();
+  auto &AcceptIdentVal =
+      ast::is_element_wise(IdentExp)
+          ? createWrapperRef(createElementWiseArray(
+                IdentExp, Assign->entityKey().CurrScope))
+          : acceptASTNode(IdentExp);
   assert(AcceptIdentVal);
   auto EntityKey = Assign->entityKey();
   Value *InitValue = AcceptIdentVal;
@@ -160,7 +254,7 @@ ResultTy CodeGenVisitor::visit(ast::assignment *Assign) {
     SymTbl.tryDefine(EntityKey, ValManager.getTypeFor(AcceptIdentVal));
     if (InitValue->getType()->isIntegerTy()) {
       auto *Alloca =
-          Builder().CreateAlloca(CodeGen.getInt32Ty(), 0, Assign->name());
+          createEntryBlockAlloca(CodeGen.getInt32Ty(), Assign->name());
 
       Builder().CreateStore(InitValue, Alloca);
       AcceptIdentVal = Alloca;
@@ -201,13 +295,42 @@ ResultTy CodeGenVisitor::visit(ast::if_operator *If) {
 }
 
 ResultTy CodeGenVisitor::visit(ast::while_operator *While) {
+  if (auto *Induction = While->parallel_induction()) {
+    auto *DataTy = CodeGen.getInt32Ty();
+    auto *Cond = static_cast<ast::logic_expression *>(While->condition());
+    auto *Begin =
+        Builder().CreateZExtOrTrunc(acceptASTNode(Cond->left()), DataTy);
+    auto *End =
+        Builder().CreateZExtOrTrunc(acceptASTNode(Cond->right()), DataTy);
+    createParallelLoop(Induction, Begin, End, While->body());
+    // The variable reaches the limit if the loop makes any iteration
+    auto *Last = Builder().CreateSelect(Builder().CreateICmpSLT(Begin, End),
+                                        End, Begin);
+    Builder().CreateStore(Last, ValManager.getValueFor(SymTbl.getDeclKeyFor(
+                                    Induction->entityKey())));
+    return createWrapperRef();
+  }
+
+  auto *LoopID = isElementWiseLoop(While->condition(), While->body())
+                     ? createVectorizeLoopID()
+                     : nullptr;
   auto [WhileBodyBlock, WhileEndBlock] =
       createStartWhile(acceptASTNode(While->condition()));
   // While body codegen
   acceptASTNode(While->body());
 
   createEndWhile(acceptASTNode(While->condition()), WhileBodyBlock,
-                 WhileEndBlock);
+                 WhileEndBlock, LoopID);
+  return createWrapperRef();
+}
+
+ResultTy CodeGenVisitor::visit(ast::pfor_operator *PFor) {
+  auto *DataTy = CodeGen.getInt32Ty();
+  auto *Begin =
+      Builder().CreateZExtOrTrunc(acceptASTNode(PFor->init()), DataTy);
+  auto *End = Builder().CreateZExtOrTrunc(acceptASTNode(PFor->limit()), DataTy);
+  SymTbl.tryDefine(PFor->loop_variable()->entityKey(), DataTy);
+  createParallelLoop(PFor->loop_variable(), Begin, End, PFor->body());
   return createWrapperRef();
 }
 
@@ -226,17 +349,15 @@ ResultTy CodeGenVisitor::visit(ast::print_function *PrintFuncNode) {
 
   if (PrintType->isPointerTy()) {
     assert(ArrInfoMap.contains(PrintVal));
-    auto *ArrType = ValManager.getTypeFor(PrintVal);
-    assert(ArrType);
-    auto *DataTy = CodeGen.getInt32Ty();
+    assert(ValManager.getTypeFor(PrintVal));
     auto *ArrSize = ArrayInfo::calculateSize(Builder(), CodeGen.getInt32Ty(),
                                              ArrInfoMap[PrintVal].Sizes);
-    // Print array in loop
-    std::function<void(Value *)> LoopBody = [&](Value *LoopCounter) {
-      auto *ElemPtr = Builder().CreateGEP(DataTy, PrintVal, LoopCounter);
-      printIntegerValue(Builder().CreateLoad(DataTy, ElemPtr));
-    };
-    createUpCountLoop(ArrSize, LoopBody);
+    // The whole array is printed by one runtime call
+    auto *PrintArrayFunc = CodeGen.Mod->getFunction(
+        codegen::IRCodeGenerator::ParaCLPrintArrayFuncName);
+    Builder().CreateCall(
+        PrintArrayFunc,
+        {PrintVal, Builder().CreateZExt(ArrSize, Builder().getInt64Ty())});
   } else if (PrintType->isIntegerTy())
     printIntegerValue(PrintVal);
   else {
@@ -250,6 +371,50 @@ ResultTy CodeGenVisitor::visit(ast::print_function *PrintFuncNode) {
   return PrintVal;
 }
 
+ResultTy CodeGenVisitor::visit(ast::reduce_function *Reduce) {
+  auto GetArraySize = [&](Value *ArrPtr) {
+    assert(ArrInfoMap.contains(ArrPtr));
+    return ArrayInfo::calculateSize(Builder(), CodeGen.getInt32Ty(),
+                                    ArrInfoMap[ArrPtr].Sizes);
+  };
+  Value *ArrPtr = acceptASTNode(Reduce->array());
+  auto *ArrSize = GetArraySize(ArrPtr);
+  SmallVector<Value *, 3> Args{ArrPtr};
+  StringRef FuncName;
+  switch (Reduce->type()) {
+  case ast::ReduceOp::SUM:
+    FuncName = codegen::IRCodeGenerator::ParaCLArraySumFuncName;
+    break;
+  case ast::ReduceOp::MIN:
+    FuncName = codegen::IRCodeGenerator::ParaCLArrayMinFuncName;
+    break;
+  case ast::ReduceOp::MAX:
+    FuncName = codegen::IRCodeGenerator::ParaCLArrayMaxFuncName;
+    break;
+  case ast::ReduceOp::COUNT:
+    FuncName = codegen::IRCodeGenerator::ParaCLArrayCountFuncName;
+    break;
+  case ast::ReduceOp::DOT: {
+    FuncName = codegen::IRCodeGenerator::ParaCLArrayDotFuncName;
+    Value *OtherPtr = acceptASTNode(Reduce->operand());
+    createSizeCheck(Reduce, codegen::IRCodeGenerator::ParaCLSizeErrorFuncName,
+                    ArrSize, GetArraySize(OtherPtr));
+    Args.push_back(OtherPtr);
+    break;
+  }
+  default:
+    llvm_unreachable("Unsupported reduction");
+  }
+  Args.push_back(Builder().CreateZExt(ArrSize, Builder().getInt64Ty()));
+  if (Reduce->type() == ast::ReduceOp::COUNT)
+    Args.push_back(acceptASTNode(Reduce->operand()));
+
+  // The whole array is reduced by the vectorized kernel of the runtime
+  auto *ReduceFunc = CodeGen.Mod->getFunction(FuncName);
+  assert(ReduceFunc);
+  return createWrapperRef(Builder().CreateCall(ReduceFunc, Args));
+}
+
 ResultTy CodeGenVisitor::visit(ast::ArrayHolder *ArrStore) {
   CodeGen.createBlockAndLinkWith(Builder().GetInsertBlock(),
                                  "array.creat.block");
@@ -260,6 +425,10 @@ ResultTy CodeGenVisitor::visit(ast::ArrayHolder *ArrStore) {
 
   auto *DataTy = CodeGen.getInt32Ty();
   Value *ArrPtr = createArray(DataTy, CurrArrInfo, ArrStore->scope());
+  CurrArrInfo.computeStrides(Builder(), DataTy);
+  // The next copies read the elements from the created array
+  if (CurrArrInfo.Source)
+    CurrArrInfo.Source = ArrPtr;
 
   // Save the array's metadata (initialization values and dimensions). This may
   // be necessary when initializing a new array with values from an existing
@@ -293,6 +462,19 @@ ResultTy CodeGenVisitor::visit(ast::UniformArray *UnifArr) {
   if (Found != ArrInfoMap.end())
     isConstantNotZeroSize &= isConstantData(Found->second.Sizes);
 
+  if (Found != ArrInfoMap.end() && Found->second.Source) {
+    // The elements of the initializer are known only at runtime, e.g
+    // -- Arr = Lhs + Rhs;
+    // -- Arr2 = repeat(Arr, Sz);
+    auto &InitArrInfo = Found->second;
+    CurrArrInfo.Source = InitArrInfo.Source;
+    CurrArrInfo.Sizes.insert(CurrArrInfo.Sizes.begin(),
+                             InitArrInfo.Sizes.begin(),
+                             InitArrInfo.Sizes.end());
+    CurrArrInfo.pushSize(Size);
+    return createWrapperRef(nullptr);
+  }
+
   auto TransformWithAlloca = [&](ArrayRef<Value *> From, auto &To) {
     llvm::transform(From, std::back_inserter(To), [&](auto *CopyVal) {
       return createLocalVariable(DataTy, CopyVal);
@@ -383,7 +565,11 @@ ResultTy CodeGenVisitor::visit(ast::PresetArray *PresetArr) {
   llvm::for_each(*PresetArr, [&](auto *Exp) {
     auto &Val = acceptASTNode(Exp);
     if (Val) {
-      if (auto Found = ArrInfoMap.find(Val); Found != ArrInfoMap.end()) {
+      if (auto Found = ArrInfoMap.find(Val);
+          Found != ArrInfoMap.end() && Found->second.Source) {
+        // The elements are known only at runtime
+        pushSourceElements(Found->second.Source);
+      } else if (Found != ArrInfoMap.end()) {
         // We have a previously created array as an initializer, e.g
         // -- Arr = repeat(10, 5);
         // -- Arr2 = array(..., Arr, ...);
@@ -417,59 +603,134 @@ ResultTy CodeGenVisitor::visit(ast::PresetArray *PresetArr) {
 ResultTy CodeGenVisitor::visit(ast::ArrayAccess *ArrAccess) {
   auto ElemPtr = getArrayAccessPtr(ArrAccess);
   auto *Load = Builder().CreateLoad(CodeGen.getInt32Ty(), ElemPtr);
+  recordArrayAccess(Load, ElemPtr);
   return createWrapperRef(Load);
 }
 
 ResultTy CodeGenVisitor::visit(ast::ArrayAccessAssignment *Assign) {
   auto *AccessPtr = getArrayAccessPtr(Assign->getArrayAccess());
   auto &IdentValue = acceptASTNode(Assign->getIdentExp());
-  Builder().CreateStore(IdentValue, AccessPtr);
+  recordArrayAccess(Builder().CreateStore(IdentValue, AccessPtr), AccessPtr);
   return createWrapperRef(IdentValue);
 }
 
 Value *CodeGenVisitor::getArrayAccessPtr(ast::ArrayAccess *ArrAccess) {
   auto *DataTy = CodeGen.getInt32Ty();
+  auto DeclKey = SymTbl.getDeclKeyFor(ArrAccess->entityKey());
+  auto *ArrPtr = ValManager.getValueFor(DeclKey);
+  assert(ArrPtr);
+  [[maybe_unused]] auto *ArrType = ValManager.getTypeFor(ArrPtr);
+  assert(ArrType);
+  assert(ArrType->isPointerTy());
+  const auto &ArrInfo = ArrInfoMap[ArrPtr];
+  // The sizes are stored starting from the innermost dimension
+  const auto &ArrSizes = ArrInfo.Sizes;
+  assert(ArrSizes.size() == ArrAccess->getSize());
+  assert(ArrInfo.Strides.size() == ArrSizes.size());
+
   llvm::SmallVector<llvm::Value *> Indexes;
   Indexes.reserve(ArrAccess->getSize() + 1);
   // Get access indexes for an array
   llvm::for_each(*ArrAccess, [&](auto *Exp) {
     Value *IndexVal = acceptASTNode(Exp);
     assert(IndexVal->getType()->isIntegerTy());
+    auto Dim = Indexes.size();
+    if (ArrAccess->needsBoundsCheck(Dim))
+      createBoundsCheck(ArrAccess, IndexVal,
+                        ArrSizes[ArrSizes.size() - Dim - 1]);
     Indexes.push_back(IndexVal);
   });
 
-  auto DeclKey = SymTbl.getDeclKeyFor(ArrAccess->entityKey());
-  auto *ArrPtr = ValManager.getValueFor(DeclKey);
-  assert(ArrPtr);
-  [[maybe_unused]] auto *ArrType = ValManager.getTypeFor(ArrPtr);
-  assert(ArrType);
-  assert(ArrType->isPointerTy());
-
-  // Calculate the offset of an element A[i1][i2]...[in]
-  // in a n-dimensional array A of size D1 x D2 x ... x Dn:
-  // offset = (i1 × D2 × D3 × ... × Dn +
-  //     i2  D3  D4  ...  Dn +
-  //     i3  D4  D5  ...  Dn +
-  //      ...           +
-  //     i(n-2)  D(n-1)  Dn   +
-  //     i(n-1) * Dn       +
-  //     in) * element_size
-  Value *AccessIndex = ConstantInt::get(DataTy, 0);
-  const auto &ArrSizes = ArrInfoMap[ArrPtr].Sizes;
-  assert(ArrSizes.size() == Indexes.size());
-  for (unsigned i = 0, IndexNum = Indexes.size(); i < IndexNum; ++i) {
-    auto *CurrIndex = Indexes[i];
-    Value *Multiplier = ConstantInt::get(DataTy, 1);
-    for (unsigned j = i + 1; j < IndexNum; ++j) {
-      auto *Dim = ArrSizes[IndexNum - j - 1];
-      Multiplier = Builder().CreateMul(Multiplier, Dim);
-    }
-    Value *Term = Builder().CreateMul(CurrIndex, Multiplier);
-    AccessIndex = Builder().CreateAdd(AccessIndex, Term, "access_index");
+  // The offset of an element A[i1][i2]...[in] is
+  // i1 * S1 + i2 * S2 + ... + i(n-1) * S(n-1) + in,
+  // the strides Sk don't change after the creation of the array
+  Value *AccessIndex = Indexes.back();
+  for (unsigned Dim = Indexes.size() - 1; Dim > 0; --Dim) {
+    auto *Term =
+        Builder().CreateMul(Indexes[Dim - 1], ArrInfo.Strides[Dim - 1]);
+    AccessIndex = Builder().CreateAdd(Term, AccessIndex, "access_index");
   }
   return Builder().CreateGEP(DataTy, ArrPtr, AccessIndex);
 }
 
+void CodeGenVisitor::createBoundsCheck(ast::ArrayAccess *ArrAccess,
+                                       Value *Index, Value *Size) {
+  // The negative indexes are huge unsigned ones, so one comparison is enough
+  auto *IsInBounds = Builder().CreateICmpULT(Index, Size, "in_bounds");
+  auto *Func = Builder().GetInsertBlock()->getParent();
+  auto *ErrorBlock = BasicBlock::Create(CodeGen.Context, "index.error", Func);
+  auto *ContBlock = BasicBlock::Create(CodeGen.Context, "index.ok", Func);
+  Builder().CreateCondBr(
+      IsInBounds, ContBlock, ErrorBlock,
+      MDBuilder(CodeGen.Context).createBranchWeights(1 << 20, 1));
+
+  Builder().SetInsertPoint(ErrorBlock);
+  auto Loc = ArrAccess->location().begin;
+  auto *IndexErrorFunc = CodeGen.Mod->getFunction(
+      codegen::IRCodeGenerator::ParaCLIndexErrorFuncName);
+  assert(IndexErrorFunc);
+  Builder().CreateCall(IndexErrorFunc,
+                       {CodeGen.createConstantInt32(Loc.line),
+                        CodeGen.createConstantInt32(Loc.column), Index, Size});
+  Builder().CreateUnreachable();
+  Builder().SetInsertPoint(ContBlock);
+}
+
+void CodeGenVisitor::createDivisionCheck(ast::calc_expression *CalcExpr,
+                                         Value *Divisor) {
+  if (auto *Const = isConstantInt(Divisor); Const && !Const->isZero())
+    return;
+  auto *IsNotZero = Builder().CreateICmpNE(
+      Divisor, CodeGen.createConstantInt32(0), "not_zero");
+  auto *Func = Builder().GetInsertBlock()->getParent();
+  auto *ErrorBlock = BasicBlock::Create(CodeGen.Context, "div.error", Func);
+  auto *ContBlock = BasicBlock::Create(CodeGen.Context, "div.ok", Func);
+  Builder().CreateCondBr(
+      IsNotZero, ContBlock, ErrorBlock,
+      MDBuilder(CodeGen.Context).createBranchWeights(1 << 20, 1));
+
+  Builder().SetInsertPoint(ErrorBlock);
+  auto Loc = CalcExpr->location();
+  auto *DivErrorFunc = CodeGen.Mod->getFunction(
+      codegen::IRCodeGenerator::ParaCLDivisionErrorFuncName);
+  assert(DivErrorFunc);
+  Builder().CreateCall(DivErrorFunc,
+                       {CodeGen.createConstantInt32(Loc.begin.line),
+                        CodeGen.createConstantInt32(Loc.begin.column),
+                        CodeGen.createConstantInt32(Loc.end.line),
+                        CodeGen.createConstantInt32(Loc.end.column)});
+  Builder().CreateUnreachable();
+  Builder().SetInsertPoint(ContBlock);
+}
+
+void CodeGenVisitor::createSizeCheck(ast::expression *Exp,
+                                     StringRef ErrorFuncName, Value *LhsSize,
+                                     Value *RhsSize) {
+  // The sizes known to be equal aren't checked
+  if (LhsSize == RhsSize)
+    return;
+  auto *IsSameSize = Builder().CreateICmpEQ(LhsSize, RhsSize, "same_size");
+  if (auto *Const = dyn_cast<ConstantInt>(IsSameSize); Const && Const->isOne())
+    return;
+  auto *Func = Builder().GetInsertBlock()->getParent();
+  auto *ErrorBlock = BasicBlock::Create(CodeGen.Context, "size.error", Func);
+  auto *ContBlock = BasicBlock::Create(CodeGen.Context, "size.ok", Func);
+  Builder().CreateCondBr(
+      IsSameSize, ContBlock, ErrorBlock,
+      MDBuilder(CodeGen.Context).createBranchWeights(1 << 20, 1));
+
+  Builder().SetInsertPoint(ErrorBlock);
+  auto Loc = Exp->location().begin;
+  auto *SizeErrorFunc = CodeGen.Mod->getFunction(ErrorFuncName);
+  assert(SizeErrorFunc);
+  Builder().CreateCall(SizeErrorFunc,
+                       {CodeGen.createConstantInt32(Loc.line),
+                        CodeGen.createConstantInt32(Loc.column), LhsSize,
+                        RhsSize});
+  Builder().CreateUnreachable();
+  Builder().SetInsertPoint(ContBlock);
+}
+
 std::pair<BasicBlock *, BasicBlock *> CodeGenVisitor::createStartIf() {
   auto *CurrBlock = Builder().GetInsertBlock();
   auto *IfBodyBlock =
@@ -492,23 +753,179 @@ CodeGenVisitor::createStartWhile(Value *Condition) {
   // Condition codegen
   auto *EntryCondValue = CodeGen.createCondValueIfNeed(Condition);
 
-  auto *WhileBodyBlock =
-      BasicBlock::Create(CodeGen.Context, "while.body", CurrBlock->getParent());
-  auto *WhileEndBlock =
-      BasicBlock::Create(CodeGen.Context, "while.end", CurrBlock->getParent());
-  Builder().CreateCondBr(EntryCondValue, WhileBodyBlock, WhileEndBlock);
+  auto *Func = CurrBlock->getParent();
+  auto *PreheaderBlock =
+      BasicBlock::Create(CodeGen.Context, "while.preheader", Func);
+  auto *WhileBodyBlock = BasicBlock::Create(CodeGen.Context, "while.body", Func);
+  auto *WhileEndBlock = BasicBlock::Create(CodeGen.Context, "while.end", Func);
+  Builder().CreateCondBr(EntryCondValue, PreheaderBlock, WhileEndBlock);
 
+  Builder().SetInsertPoint(PreheaderBlock);
+  Builder().CreateBr(WhileBodyBlock);
   Builder().SetInsertPoint(WhileBodyBlock);
   return std::make_pair(WhileBodyBlock, WhileEndBlock);
 }
 
 void CodeGenVisitor::createEndWhile(Value *Condition, BasicBlock *BodyBlock,
-                                    BasicBlock *EndBlock) {
+                                    BasicBlock *EndBlock, MDNode *LoopID) {
   auto *CondValue = CodeGen.createCondValueIfNeed(Condition);
-  Builder().CreateCondBr(CondValue, BodyBlock, EndBlock);
+  auto *ExitBlock = BasicBlock::Create(CodeGen.Context, "while.exit",
+                                       EndBlock->getParent(), EndBlock);
+  auto *Latch = Builder().CreateCondBr(CondValue, BodyBlock, ExitBlock);
+  if (LoopID)
+    Latch->setMetadata(LLVMContext::MD_loop, LoopID);
+  Builder().SetInsertPoint(ExitBlock);
+  Builder().CreateBr(EndBlock);
   Builder().SetInsertPoint(EndBlock);
 }
 
+MDNode *CodeGenVisitor::createVectorizeLoopID() {
+  auto &Context = CodeGen.Context;
+  auto *Enable =
+      MDNode::get(Context, {MDString::get(Context, "llvm.loop.vectorize.enable"),
+                            ConstantAsMetadata::get(ConstantInt::getTrue(Context))});
+  auto *Interleave = MDNode::get(
+      Context, {MDString::get(Context, "llvm.loop.interleave.count"),
+                ConstantAsMetadata::get(
+                    CodeGen.createConstantInt32(VectorLoopInterleaveCount))});
+  // The loop ID refers to itself, so it's distinct from the IDs of the other
+  // loops
+  auto Placeholder = MDNode::getTemporary(Context, {});
+  Metadata *Operands[] = {Placeholder.get(), Enable, Interleave};
+  auto *LoopID = MDNode::getDistinct(Context, Operands);
+  LoopID->replaceOperandWith(0, LoopID);
+  return LoopID;
+}
+
+void CodeGenVisitor::addArrayAliasScopes() {
+  MapVector<Value *, MDNode *> Scopes;
+  for (auto [Access, Arr] : ArrayAccesses)
+    Scopes.insert({Arr, nullptr});
+  if (Scopes.size() < 2)
+    return;
+
+  MDBuilder MDB(CodeGen.Context);
+  auto *Domain = MDB.createAnonymousAliasScopeDomain("pcl_arrays");
+  for (auto &[Arr, Scope] : Scopes)
+    Scope = MDB.createAnonymousAliasScope(Domain, Arr->getName());
+  // The scope of the array and the scopes of all the other arrays
+  DenseMap<Value *, std::pair<MDNode *, MDNode *>> AliasInfo;
+  for (auto &[Arr, Scope] : Scopes) {
+    SmallVector<Metadata *> Others;
+    for (auto &[OtherArr, OtherScope] : Scopes)
+      if (OtherArr != Arr)
+        Others.push_back(OtherScope);
+    AliasInfo[Arr] = {MDNode::get(CodeGen.Context, Scope),
+                      MDNode::get(CodeGen.Context, Others)};
+  }
+  for (auto [Access, Arr] : ArrayAccesses) {
+    auto [ScopeList, NoAliasList] = AliasInfo[Arr];
+    Access->setMetadata(LLVMContext::MD_alias_scope, ScopeList);
+    Access->setMetadata(LLVMContext::MD_noalias, NoAliasList);
+  }
+  ArrayAccesses.clear();
+}
+
+// The body is outlined to the function that executes the iterations
+// [From, To). The runtime splits the iterations between the threads and calls
+// the function for every part of them.
+void CodeGenVisitor::createParallelLoop(ast::variable *LoopVar, Value *Begin,
+                                        Value *End, ast::statement *Body) {
+  auto *DataTy = CodeGen.getInt32Ty();
+  auto *CallerBlock = Builder().GetInsertBlock();
+  auto *PtrTy = PointerType::get(CodeGen.Context, 0);
+  auto *BodyFunc =
+      CodeGen.createFunction(CodeGen.getVoidTy(), Function::InternalLinkage,
+                             "__pcl_pfor_body", false, PtrTy, DataTy, DataTy);
+  auto *EntryBlock = BasicBlock::Create(CodeGen.Context, "pfor_entry", BodyFunc);
+  Builder().SetInsertPoint(EntryBlock);
+
+  // Every iteration has its own copy of the loop variable
+  auto DeclKey = SymTbl.getDeclKeyFor(LoopVar->entityKey());
+  auto *OuterValue = ValManager.getValueFor(DeclKey);
+  auto *LoopVarAlloca = createEntryBlockAlloca(DataTy, LoopVar->name());
+  ValManager.linkValueWithName(DeclKey, LoopVarAlloca);
+  auto *From = BodyFunc->getArg(1);
+  // The loop variable is in [From, To), so it doesn't overflow and the indexes
+  // computed from it are known to be affine
+  std::function<void(Value *)> RunIteration = [&](Value *Counter) {
+    Builder().CreateStore(Builder().CreateNSWAdd(From, Counter), LoopVarAlloca);
+    acceptASTNode(Body);
+  };
+  auto *LoopID =
+      isElementWiseLoop(nullptr, Body) ? createVectorizeLoopID() : nullptr;
+  createUpCountLoop(Builder().CreateSub(BodyFunc->getArg(2), From), LoopID,
+                    RunIteration);
+  Builder().CreateRetVoid();
+  if (OuterValue)
+    ValManager.linkValueWithName(DeclKey, OuterValue);
+
+  Builder().SetInsertPoint(CallerBlock);
+  auto *Ctx = captureLoopContext(BodyFunc, BodyFunc->getArg(0));
+  auto *ParallelForFunc = CodeGen.Mod->getFunction(
+      codegen::IRCodeGenerator::ParaCLParallelForFuncName);
+  assert(ParallelForFunc);
+  Builder().CreateCall(ParallelForFunc, {BodyFunc, Ctx, Begin, End});
+}
+
+Value *CodeGenVisitor::captureLoopContext(Function *BodyFunc, Value *Ctx) {
+  SetVector<Value *> Captures;
+  for (auto &Inst : instructions(BodyFunc))
+    for (auto *Operand : Inst.operand_values()) {
+      auto *OperandInst = dyn_cast<Instruction>(Operand);
+      auto *Arg = dyn_cast<Argument>(Operand);
+      if ((OperandInst && OperandInst->getFunction() != BodyFunc) ||
+          (Arg && Arg->getParent() != BodyFunc))
+        Captures.insert(Operand);
+    }
+  if (Captures.empty())
+    return ConstantPointerNull::get(PointerType::get(CodeGen.Context, 0));
+
+  // The integer variables of the caller are only read by the body, so their
+  // values are copied to the context. The arrays are passed by pointer.
+  auto IsReadOnlyVariable = [&](Value *Val) {
+    auto *Alloca = dyn_cast<AllocaInst>(Val);
+    return Alloca && Alloca->getAllocatedType()->isIntegerTy() &&
+           all_of(Alloca->users(), [&](User *AllocaUser) {
+             auto *UserInst = cast<Instruction>(AllocaUser);
+             return UserInst->getFunction() != BodyFunc ||
+                    isa<LoadInst>(UserInst);
+           });
+  };
+  SmallVector<bool> IsCopied;
+  SmallVector<Type *> FieldTypes;
+  for (auto *Val : Captures) {
+    IsCopied.push_back(IsReadOnlyVariable(Val));
+    FieldTypes.push_back(IsCopied.back()
+                             ? cast<AllocaInst>(Val)->getAllocatedType()
+                             : Val->getType());
+  }
+  auto *CtxTy = StructType::get(CodeGen.Context, FieldTypes);
+  auto *CtxAlloca = createEntryBlockAlloca(CtxTy, "pfor_ctx");
+
+  auto &EntryBlock = BodyFunc->getEntryBlock();
+  IRBuilder<> EntryBuilder(&EntryBlock, EntryBlock.begin());
+  for (unsigned Id = 0; Id < Captures.size(); ++Id) {
+    auto *Val = Captures[Id];
+    auto *FieldTy = FieldTypes[Id];
+    auto *Field = IsCopied[Id] ? Builder().CreateLoad(FieldTy, Val) : Val;
+    Builder().CreateStore(Field, Builder().CreateStructGEP(CtxTy, CtxAlloca, Id));
+
+    Value *Replacement = EntryBuilder.CreateLoad(
+        FieldTy, EntryBuilder.CreateStructGEP(CtxTy, Ctx, Id));
+    if (IsCopied[Id]) {
+      auto *Copy = EntryBuilder.CreateAlloca(FieldTy, nullptr, Val->getName());
+      EntryBuilder.CreateStore(Replacement, Copy);
+      Replacement = Copy;
+    }
+    Val->replaceUsesWithIf(Replacement, [BodyFunc](Use &U) {
+      auto *UserInst = dyn_cast<Instruction>(U.getUser());
+      return UserInst && UserInst->getFunction() == BodyFunc;
+    });
+  }
+  return CtxAlloca;
+}
+
 Value *CodeGenVisitor::createLogicAnd(ast::logic_expression *LogExp) {
   auto *DataTy = CodeGen.getInt32Ty();
   auto &Lhs = acceptASTNode(LogExp->left());
@@ -532,6 +949,8 @@ Value *CodeGenVisitor::createLogicAnd(ast::logic_expression *LogExp) {
   Rhs = Builder().CreateZExt(Rhs, DataTy);
   auto *IsRhsNonZero =
       Builder().CreateICmpNE(Rhs, ConstantInt::get(DataTy, 0), "tobool");
+  // The right operand may end in another block, e.g. after a bounds check
+  auto *RhsEndBlock = Builder().GetInsertBlock();
   Builder().CreateBr(MergeBlock);
 
   Builder().SetInsertPoint(FalseBlock);
@@ -539,7 +958,7 @@ Value *CodeGenVisitor::createLogicAnd(ast::logic_expression *LogExp) {
 
   Builder().SetInsertPoint(MergeBlock);
   auto *Phi = Builder().CreatePHI(Type::getInt1Ty(CodeGen.Context), 2);
-  Phi->addIncoming(IsRhsNonZero, RhsBlock);
+  Phi->addIncoming(IsRhsNonZero, RhsEndBlock);
   Phi->addIncoming(Builder().getFalse(), FalseBlock);
 
   return Phi;
@@ -566,12 +985,13 @@ Value *CodeGenVisitor::createLogicOr(ast::logic_expression *LogExp) {
   Rhs = Builder().CreateZExt(Rhs, DataTy);
   auto *IsRhsNonZero =
       Builder().CreateICmpNE(Rhs, ConstantInt::get(DataTy, 0), "tobool");
+  auto *RhsEndBlock = Builder().GetInsertBlock();
   Builder().CreateBr(MergeBlock);
 
   Builder().SetInsertPoint(MergeBlock);
   auto *Phi = Builder().CreatePHI(Type::getInt1Ty(CodeGen.Context), 2);
   Phi->addIncoming(Builder().getTrue(), LhsBlock);
-  Phi->addIncoming(IsRhsNonZero, RhsBlock);
+  Phi->addIncoming(IsRhsNonZero, RhsEndBlock);
 
   return Phi;
 }
@@ -585,44 +1005,230 @@ Value *CodeGenVisitor::createArray(IntegerType *DataTy,
   if (auto ConstSizesOpt = tryConvertDataToConstant<ConstantInt>(ArrInfo.Sizes);
       ConstSizesOpt.has_value()) {
     auto *ArrSize = ArrayInfo::calculateSize(DataTy, ConstSizesOpt.value());
-    return allocateLocalArray(DataTy, ArrInfo.Data, ArrSize->getZExtValue(),
-                              ElementSize);
+    if (!ArrInfo.Source)
+      return allocateLocalArray(DataTy, ArrInfo.Data, ArrSize->getZExtValue(),
+                                ElementSize);
+    auto *AllocaArr = createEntryBlockAlloca(
+        ArrayType::get(DataTy, ArrSize->getZExtValue()), "array");
+    fillFromSource(DataTy, AllocaArr, ArrSize, ArrInfo.Source);
+    return AllocaArr;
   }
   // Heap allocation
   Constant *ElemSize = ConstantInt::get(DataTy, ElementSize);
   // Calculate the array size to allocate memory.
   auto *ArraySize = ArrayInfo::calculateSize(Builder(), DataTy, ArrInfo.Sizes);
   auto *MallocCall = Builder().CreateMalloc(DataTy, 0, ElemSize, ArraySize);
-  //  Create support array with init data
-  auto *InitArrSize = ConstantInt::get(DataTy, ArrInfo.Data.size());
-  auto *SupportArr = allocateLocalArray(
-      DataTy, ArrInfo.Data, InitArrSize->getZExtValue(), ElementSize);
-
-  std::function<void(Value *)> LoopBody = [&](Value *LoopCounter) {
-    // Copy support array elements into the malloc-allocated array within the
-    // loop.
-    Value *InitVal;
-    if (InitArrSize->equalsInt(1)) {
-      InitVal = ArrInfo.Data.front();
+  if (ArrInfo.Source)
+    fillFromSource(DataTy, MallocCall, ArraySize, ArrInfo.Source);
+  else
+    fillHeapArray(DataTy, MallocCall, ArraySize, ArrInfo.Data, ElementSize);
+
+  // Dont't forget to free the pointer
+  ResourcesToFree[CurrScope].push_back(MallocCall);
+  return MallocCall;
+}
+
+Value *CodeGenVisitor::createElementWiseArray(ast::expression *Exp,
+                                              ast::statement_block *CurrScope) {
+  auto *DataTy = CodeGen.getInt32Ty();
+  std::vector<runtime::ElementStep> Steps;
+  std::vector<ast::expression *> Nodes;
+  ast::flatten_element_wise(Exp, Steps, Nodes);
+
+  // The integer operands are computed once before the loop
+  SmallVector<Value *, 4> Operands;
+  Value *Shaped = nullptr;
+  for (auto [Step, Node] : llvm::zip(Steps, Nodes)) {
+    if (!Step.IsOperand)
+      continue;
+    Value *Operand = acceptASTNode(Node);
+    if (Operand->getType()->isIntegerTy()) {
+      Operand = Builder().CreateZExtOrTrunc(Operand, DataTy);
+    } else if (!Shaped) {
+      Shaped = Operand;
     } else {
-      // Access the indices of the support array by taking the remainder of
-      // the main loop counter divided by the size of the support array. This
-      // allows the malloc-allocated array to be filled in batches of values
-      // from the support array.
-      auto *InitArrInd = Builder().CreateSRem(LoopCounter, InitArrSize);
-      auto *InitArrPtr = Builder().CreateGEP(DataTy, SupportArr, InitArrInd);
-      InitVal = Builder().CreateLoad(DataTy, InitArrPtr);
+      // The sizes are stored starting from the innermost dimension
+      for (auto [LhsSize, RhsSize] :
+           llvm::reverse(llvm::zip(ArrInfoMap[Shaped].Sizes,
+                                   ArrInfoMap[Operand].Sizes)))
+        createSizeCheck(Exp, codegen::IRCodeGenerator::ParaCLShapeErrorFuncName,
+                        LhsSize, RhsSize);
     }
+    Operands.push_back(Operand);
+  }
+  assert(Shaped);
+
+  ArrayInfo ArrInfo;
+  ArrInfo.Sizes = ArrInfoMap[Shaped].Sizes;
+  ArrInfo.Strides = ArrInfoMap[Shaped].Strides;
+  auto *ArrSize = ArrayInfo::calculateSize(Builder(), DataTy, ArrInfo.Sizes);
+  Value *Arr = nullptr;
+  if (auto *ConstSize = isConstantInt(ArrSize)) {
+    Arr = createEntryBlockAlloca(
+        ArrayType::get(DataTy, ConstSize->getZExtValue()), "array");
+  } else {
+    DataLayout Layout(&Module());
+    Constant *ElemSize =
+        ConstantInt::get(DataTy, Layout.getTypeAllocSize(DataTy));
+    Arr = Builder().CreateMalloc(DataTy, 0, ElemSize, ArrSize);
+    ResourcesToFree[CurrScope].push_back(Arr);
+  }
 
-    auto *GEPtr = Builder().CreateGEP(DataTy, MallocCall, LoopCounter);
-    Builder().CreateStore(InitVal, GEPtr);
+  // All the operators are fused into one vectorizable loop, so no array is
+  // created for the intermediate values
+  std::function<void(Value *)> ComputeElement = [&](Value *Id) {
+    SmallVector<Value *, 8> Stack;
+    for (auto &Step : Steps) {
+      if (Step.IsOperand) {
+        auto *Operand = Operands[Step.Operand];
+        if (Operand->getType()->isPointerTy()) {
+          auto *ElemPtr = Builder().CreateGEP(DataTy, Operand, Id);
+          auto *Load = Builder().CreateLoad(DataTy, ElemPtr);
+          recordArrayAccess(Load, ElemPtr);
+          Operand = Load;
+        }
+        Stack.push_back(Operand);
+        continue;
+      }
+      auto *Rhs = Stack.pop_back_val();
+      Stack.back() = createElementOperation(Step.Op, Stack.back(), Rhs);
+    }
+    auto *ElemPtr = Builder().CreateGEP(DataTy, Arr, Id);
+    recordArrayAccess(Builder().CreateStore(Stack.back(), ElemPtr), ElemPtr);
   };
-  // Initialize the malloc array in loop
-  createUpCountLoop(ArraySize, LoopBody);
+  createUpCountLoop(ArrSize, createVectorizeLoopID(), ComputeElement);
 
-  // Dont't forget to free the pointer
-  ResourcesToFree[CurrScope].push_back(MallocCall);
-  return MallocCall;
+  ArrInfo.Source = Arr;
+  [[maybe_unused]] auto [_, IsEmplaced] =
+      ArrInfoMap.try_emplace(Arr, std::move(ArrInfo));
+  assert(IsEmplaced);
+  ValManager.setValueTypeLink(Arr, PointerType::get(DataTy, 0));
+  return Arr;
+}
+
+Value *CodeGenVisitor::createElementOperation(runtime::ElementOp Op,
+                                              Value *Lhs, Value *Rhs) {
+  using enum runtime::ElementOp;
+  Value *Cmp = nullptr;
+  switch (Op) {
+  case Add:
+    return Builder().CreateAdd(Lhs, Rhs);
+  case Sub:
+    return Builder().CreateSub(Lhs, Rhs);
+  case Mul:
+    return Builder().CreateMul(Lhs, Rhs);
+  case Div:
+    return Builder().CreateSDiv(Lhs, Rhs);
+  case Rem:
+    return Builder().CreateSRem(Lhs, Rhs);
+  case Less:
+    Cmp = Builder().CreateICmpSLT(Lhs, Rhs);
+    break;
+  case LessEq:
+    Cmp = Builder().CreateICmpSLE(Lhs, Rhs);
+    break;
+  case Greater:
+    Cmp = Builder().CreateICmpSGT(Lhs, Rhs);
+    break;
+  case GreaterEq:
+    Cmp = Builder().CreateICmpSGE(Lhs, Rhs);
+    break;
+  case Equal:
+    Cmp = Builder().CreateICmpEQ(Lhs, Rhs);
+    break;
+  case NotEqual:
+    Cmp = Builder().CreateICmpNE(Lhs, Rhs);
+    break;
+  }
+  // The elements of the comparisons are 0 or 1
+  return Builder().CreateZExt(Cmp, CodeGen.getInt32Ty());
+}
+
+void CodeGenVisitor::fillHeapArray(IntegerType *DataTy, Value *Arr,
+                                   Value *ArrSize, ArrayRef<Value *> Pattern,
+                                   unsigned ElementSize) {
+  if (Pattern.empty())
+    return;
+  auto *Int64Ty = Type::getInt64Ty(CodeGen.Context);
+  // The sizes of the invalid arrays are negative, nothing is filled then
+  auto *Size = Builder().CreateBinaryIntrinsic(Intrinsic::smax, ArrSize,
+                                               ConstantInt::get(DataTy, 0));
+  bool IsSingleValue = all_of(
+      Pattern, [&](Value *Elem) { return Elem == Pattern.front(); });
+  if (!IsSingleValue) {
+    // The runtime copies the pattern by the doubling memcpy
+    auto *PatternArr =
+        allocateLocalArray(DataTy, Pattern, Pattern.size(), ElementSize);
+    auto *FillArrayFunc = CodeGen.Mod->getFunction(
+        codegen::IRCodeGenerator::ParaCLFillArrayFuncName);
+    assert(FillArrayFunc);
+    Builder().CreateCall(FillArrayFunc,
+                         {Arr, Builder().CreateZExt(Size, Int64Ty), PatternArr,
+                          ConstantInt::get(Int64Ty, Pattern.size())});
+    return;
+  }
+
+  auto *FillVal = Pattern.front();
+  // The values like 0 and -1 consist of the same bytes
+  if (auto *Byte = isBytewiseValue(FillVal, Module().getDataLayout())) {
+    auto *BytesNum = Builder().CreateMul(Builder().CreateZExt(Size, Int64Ty),
+                                         ConstantInt::get(Int64Ty, ElementSize));
+    Builder().CreateMemSet(Arr, Byte, BytesNum, MaybeAlign(ElementSize));
+    return;
+  }
+
+  // Other values are stored by the vectors of the copies of the value, the
+  // remaining elements are stored one by one
+  auto *Splat = Builder().CreateVectorSplat(FillVectorWidth, FillVal);
+  auto *Width = ConstantInt::get(DataTy, FillVectorWidth);
+  auto *VectorsNum = Builder().CreateUDiv(Size, Width);
+  std::function<void(Value *)> StoreVector = [&](Value *Counter) {
+    auto *Ptr =
+        Builder().CreateGEP(DataTy, Arr, Builder().CreateMul(Counter, Width));
+    Builder().CreateAlignedStore(Splat, Ptr, Align(ElementSize));
+  };
+  createUpCountLoop(VectorsNum, nullptr, StoreVector);
+
+  auto *TailStart = Builder().CreateMul(VectorsNum, Width);
+  auto *Tail = Builder().CreateGEP(DataTy, Arr, TailStart);
+  std::function<void(Value *)> StoreElement = [&](Value *Counter) {
+    auto *Ptr = Builder().CreateGEP(DataTy, Tail, Counter);
+    Builder().CreateStore(FillVal, Ptr);
+  };
+  createUpCountLoop(Builder().CreateSub(Size, TailStart), nullptr,
+                    StoreElement);
+}
+
+void CodeGenVisitor::fillFromSource(IntegerType *DataTy, Value *Arr,
+                                    Value *ArrSize, Value *Source) {
+  auto *Int64Ty = Type::getInt64Ty(CodeGen.Context);
+  auto *Size = Builder().CreateBinaryIntrinsic(Intrinsic::smax, ArrSize,
+                                               ConstantInt::get(DataTy, 0));
+  auto *SourceSize =
+      ArrayInfo::calculateSize(Builder(), DataTy, ArrInfoMap[Source].Sizes);
+  auto *FillArrayFunc = CodeGen.Mod->getFunction(
+      codegen::IRCodeGenerator::ParaCLFillArrayFuncName);
+  assert(FillArrayFunc);
+  Builder().CreateCall(FillArrayFunc,
+                       {Arr, Builder().CreateZExt(Size, Int64Ty), Source,
+                        Builder().CreateZExt(SourceSize, Int64Ty)});
+}
+
+void CodeGenVisitor::pushSourceElements(Value *Source) {
+  auto *DataTy = CodeGen.getInt32Ty();
+  auto SizesOpt =
+      tryConvertDataToConstant<ConstantInt>(ArrInfoMap[Source].Sizes);
+  assert(SizesOpt.has_value() &&
+         "The preset array should be able to output the size");
+  auto SourceSize =
+      ArrayInfo::calculateSize(DataTy, SizesOpt.value())->getZExtValue();
+  for (uint64_t Id = 0; Id < SourceSize; ++Id) {
+    auto *ElemPtr =
+        Builder().CreateGEP(DataTy, Source, CodeGen.createConstantInt32(Id));
+    auto *Load = Builder().CreateLoad(DataTy, ElemPtr);
+    recordArrayAccess(Load, ElemPtr);
+    CurrArrInfo.pushData(Load);
+  }
 }
 
 AllocaInst *CodeGenVisitor::allocateLocalArray(Type *DataTy,
@@ -639,7 +1245,7 @@ AllocaInst *CodeGenVisitor::allocateLocalArray(Type *DataTy,
   // depending on the case.
   // Note: zero-sized arrays (size 0) also produce an empty array.
   auto *ArrType = ArrayType::get(DataTy, ArrSize);
-  auto *AllocaArr = Builder().CreateAlloca(ArrType, nullptr, "array");
+  auto *AllocaArr = createEntryBlockAlloca(ArrType, "array");
 
   if (ArrSize == 0)
     // Don't initialize
@@ -662,8 +1268,15 @@ AllocaInst *CodeGenVisitor::allocateLocalArray(Type *DataTy,
   return AllocaArr;
 }
 
+AllocaInst *CodeGenVisitor::createEntryBlockAlloca(Type *DataTy,
+                                                   StringRef Name) {
+  auto &EntryBlock = Builder().GetInsertBlock()->getParent()->getEntryBlock();
+  IRBuilder<> EntryBuilder(&EntryBlock, EntryBlock.begin());
+  return EntryBuilder.CreateAlloca(DataTy, nullptr, Name);
+}
+
 LoadInst *CodeGenVisitor::createLocalVariable(Type *DataTy, Value *ToStore) {
-  auto *Alloca = Builder().CreateAlloca(DataTy);
+  auto *Alloca = createEntryBlockAlloca(DataTy);
   Builder().CreateStore(ToStore, Alloca);
   return Builder().CreateLoad(DataTy, Alloca);
 }
@@ -702,14 +1315,59 @@ void CodeGenVisitor::printIntegerValue(Value *Val) {
   Builder().CreateCall(PrintType, PrintFunc, ArgValue);
 }
 
-void CodeGenVisitor::generateIRCode(ast::root_statement_block *RootBlock,
-                                    raw_ostream &Os) {
+void CodeGenVisitor::generateCode(ast::root_statement_block *RootBlock,
+                                  raw_pwrite_stream &Os,
+                                  OptimizationLevel OptLevel,
+                                  codegen::OutputKind Kind) {
+  acceptASTNode(RootBlock);
+  auto TM = codegen::createTargetMachine(Module().getTargetTriple());
+  if (!TM)
+    paracl::fatal(toString(TM.takeError()));
+  codegen::setTargetAttributes(Module(), **TM);
+  codegen::optimizeModule(Module(), **TM, OptLevel);
+  codegen::emitModule(Module(), **TM, Kind, Os);
+}
+
+orc::ThreadSafeModule
+CodeGenVisitor::generateModule(ast::root_statement_block *RootBlock) {
   acceptASTNode(RootBlock);
-  printIRToOstream(Os);
+  return CodeGen.takeModule();
 }
 
-void CodeGenVisitor::printIRToOstream(raw_ostream &Os) const {
-  CodeGen.Mod->print(Os, nullptr);
+orc::ThreadSafeModule
+CodeGenVisitor::generateLoopModule(ast::while_operator *While,
+                                   ArrayRef<LiveInVariable> LiveIns,
+                                   StringRef FuncName) {
+  auto *DataTy = CodeGen.getInt32Ty();
+  auto *LoopFunc =
+      CodeGen.createFunction(CodeGen.getVoidTy(), Function::ExternalLinkage,
+                             FuncName, false, PointerType::get(DataTy, 0));
+  auto *EntryBlock = BasicBlock::Create(CodeGen.Context, "osr_entry", LoopFunc);
+  Builder().SetInsertPoint(EntryBlock);
+  IsDivisionChecked = true;
+
+  // The live-in variables are copied to the local ones, so they can be
+  // promoted to registers
+  auto *LiveInValues = LoopFunc->getArg(0);
+  SmallVector<std::pair<AllocaInst *, Value *>> LiveInPlaces;
+  for (unsigned Id = 0; Id < LiveIns.size(); ++Id) {
+    auto &LiveIn = LiveIns[Id];
+    auto *ValuePtr = Builder().CreateGEP(DataTy, LiveInValues,
+                                         CodeGen.createConstantInt32(Id));
+    auto *Alloca = createEntryBlockAlloca(DataTy, LiveIn.DeclKey.Name);
+    Builder().CreateStore(Builder().CreateLoad(DataTy, ValuePtr), Alloca);
+    SymTbl.tryDefine(LiveIn.DeclKey, DataTy);
+    ValManager.linkValueWithName(LiveIn.DeclKey, Alloca);
+    LiveInPlaces.emplace_back(Alloca, ValuePtr);
+  }
+
+  acceptASTNode(While);
+
+  CodeGen.createBlockAndLinkWith(Builder().GetInsertBlock(), "osr_exit");
+  for (auto [Alloca, ValuePtr] : LiveInPlaces)
+    Builder().CreateStore(Builder().CreateLoad(DataTy, Alloca), ValuePtr);
+  Builder().CreateRetVoid();
+  return CodeGen.takeModule();
 }
 
 } // namespace paracl
@@ -0,0 +1,275 @@
+#include <llvm/Support/MathExtras.h>
+
+#include <limits>
+
+#include "ast_includes.hpp"
+#include "constant_folder.hpp"
+#include "interpreter.hpp"
+
+namespace paracl {
+
+using ResultTy = ConstantFolder::ResultTy;
+
+namespace {
+
+// Returns nullopt if the operation overflows or fails (e.g. division by 0), so
+// it's left until the execution
+std::optional<int> tryFoldArithmetic(ast::CalcOp Op, int Lhs, int Rhs,
+                                     yy::location Loc) {
+  int Result = 0;
+  switch (Op) {
+  case ast::CalcOp::ADD:
+    if (llvm::AddOverflow(Lhs, Rhs, Result))
+      return std::nullopt;
+    return Result;
+  case ast::CalcOp::SUB:
+    if (llvm::SubOverflow(Lhs, Rhs, Result))
+      return std::nullopt;
+    return Result;
+  case ast::CalcOp::MUL:
+    if (llvm::MulOverflow(Lhs, Rhs, Result))
+      return std::nullopt;
+    return Result;
+  case ast::CalcOp::DIV:
+  case ast::CalcOp::PERCENT:
+    if (!Rhs || (Lhs == std::numeric_limits<int>::min() && Rhs == -1))
+      return std::nullopt;
+    return InterpreterBase::performArithmeticOperation(Op, Lhs, Rhs, Loc);
+  default:
+    llvm_unreachable("Unsupported calculation operator");
+  }
+}
+
+} // namespace
+
+ResultTy ConstantFolder::visit(ast::root_statement_block *StmBlock) {
+  return visit(static_cast<ast::statement_block *>(StmBlock));
+}
+
+ResultTy ConstantFolder::visit(ast::statement_block *StmBlock) {
+  for (auto &CurStatement : *StmBlock) {
+    auto Mark = markWrappers();
+    CurStatement = acceptASTNode(CurStatement).Node;
+    releaseWrappers(Mark);
+  }
+  StmBlock->erase_null_statements();
+  return createWrapperRef(StmBlock);
+}
+
+ResultTy ConstantFolder::visit(ast::calc_expression *CalcExp) {
+  auto *Lhs = foldExpression(CalcExp->left());
+  auto *Rhs = foldExpression(CalcExp->right());
+  CalcExp->set_left(Lhs);
+  CalcExp->set_right(Rhs);
+  // A * 1 is still a new array
+  if (CalcExp->is_element_wise())
+    return createWrapperRef(CalcExp);
+
+  auto LhsConst = getConstant(Lhs);
+  auto RhsConst = getConstant(Rhs);
+  if (LhsConst && RhsConst)
+    if (auto Folded = tryFoldArithmetic(CalcExp->type(), *LhsConst, *RhsConst,
+                                        CalcExp->location()))
+      return createWrapperRef(makeNumber(*Folded, CalcExp->location()));
+
+  switch (CalcExp->type()) {
+  case ast::CalcOp::ADD:
+    if (LhsConst == 0)
+      return createWrapperRef(Rhs);
+    [[fallthrough]];
+  case ast::CalcOp::SUB:
+    if (RhsConst == 0)
+      return createWrapperRef(Lhs);
+    break;
+  case ast::CalcOp::MUL:
+    if (LhsConst == 1)
+      return createWrapperRef(Rhs);
+    [[fallthrough]];
+  case ast::CalcOp::DIV:
+    if (RhsConst == 1)
+      return createWrapperRef(Lhs);
+    break;
+  default:
+    break;
+  }
+  return createWrapperRef(CalcExp);
+}
+
+ResultTy ConstantFolder::visit(ast::logic_expression *LogExp) {
+  auto Op = LogExp->type();
+  auto IsShortCircuit = Op == ast::LogicOp::AND || Op == ast::LogicOp::OR;
+  auto *Lhs = IsShortCircuit ? foldCondition(LogExp->left())
+                             : foldExpression(LogExp->left());
+  auto *Rhs = IsShortCircuit ? foldCondition(LogExp->right())
+                             : foldExpression(LogExp->right());
+  LogExp->set_left(Lhs);
+  LogExp->set_right(Rhs);
+
+  auto LhsConst = getConstant(Lhs);
+  // The right operand isn't evaluated in these cases
+  if (LhsConst && ((Op == ast::LogicOp::AND && !*LhsConst) ||
+                   (Op == ast::LogicOp::OR && *LhsConst)))
+    return createWrapperRef(makeNumber(Op == ast::LogicOp::OR,
+                                       LogExp->location()));
+
+  auto RhsConst = getConstant(Rhs);
+  if (LhsConst && RhsConst)
+    return createWrapperRef(makeNumber(
+        InterpreterBase::performLogicalOperation(Op, *LhsConst, *RhsConst),
+        LogExp->location()));
+  return createWrapperRef(LogExp);
+}
+
+ResultTy ConstantFolder::visit(ast::un_operator *UnOp) {
+  auto Op = UnOp->type();
+  auto *Arg = Op == ast::UnOp::NEGATE ? foldCondition(UnOp->arg())
+                                      : foldExpression(UnOp->arg());
+  UnOp->set_arg(Arg);
+
+  if (auto ArgConst = getConstant(Arg);
+      ArgConst && !(Op == ast::UnOp::MINUS &&
+                    *ArgConst == std::numeric_limits<int>::min()))
+    return createWrapperRef(makeNumber(
+        InterpreterBase::performUnaryOperation(Op, *ArgConst),
+        UnOp->location()));
+
+  if (Op == ast::UnOp::PLUS)
+    return createWrapperRef(Arg);
+  // -(-x) is x
+  if (auto *InnerOp = dynamic_cast<ast::un_operator *>(Arg);
+      Op == ast::UnOp::MINUS && InnerOp && InnerOp->type() == ast::UnOp::MINUS)
+    return createWrapperRef(InnerOp->arg());
+  return createWrapperRef(UnOp);
+}
+
+ResultTy ConstantFolder::visit(ast::number *Num) {
+  return createWrapperRef(Num);
+}
+
+ResultTy ConstantFolder::visit(ast::variable *Var) {
+  return createWrapperRef(Var);
+}
+
+ResultTy ConstantFolder::visit(ast::assignment *Assign) {
+  Assign->setIdentExp(foldExpression(Assign->getIdentExp()));
+  return createWrapperRef(Assign);
+}
+
+ResultTy ConstantFolder::visit(ast::if_operator *If) {
+  If->set_condition(foldCondition(If->condition()));
+  If->set_body(foldBody(If->body()));
+  if (auto *ElseBlock = If->else_block())
+    If->set_else_block(foldBody(ElseBlock));
+
+  auto CondConst = getConstant(If->condition());
+  if (!CondConst)
+    return createWrapperRef(If);
+  // The statement without braces may declare a variable in the enclosing
+  // scope, so only the blocks are pruned
+  auto IsBlock = [](ast::statement *Stm) {
+    return !Stm || dynamic_cast<ast::statement_block *>(Stm);
+  };
+  if (!IsBlock(If->body()) || !IsBlock(If->else_block()))
+    return createWrapperRef(If);
+  return createWrapperRef(*CondConst ? If->body() : If->else_block());
+}
+
+ResultTy ConstantFolder::visit(ast::while_operator *While) {
+  While->set_condition(foldCondition(While->condition()));
+  While->set_body(foldBody(While->body()));
+  return createWrapperRef(While);
+}
+
+ResultTy ConstantFolder::visit(ast::pfor_operator *PFor) {
+  PFor->set_init(foldExpression(PFor->init()));
+  PFor->set_limit(foldExpression(PFor->limit()));
+  // The body is the block with the loop variable, so it's never removed
+  acceptASTNode(PFor->body());
+  return createWrapperRef(PFor);
+}
+
+ResultTy ConstantFolder::visit(ast::read_expression *ReadExp) {
+  return createWrapperRef(ReadExp);
+}
+
+ResultTy ConstantFolder::visit(ast::print_function *Print) {
+  Print->set(foldExpression(Print->get()));
+  return createWrapperRef(Print);
+}
+
+ResultTy ConstantFolder::visit(ast::reduce_function *Reduce) {
+  // The arrays are the variables, only the value counted by count may fold
+  if (auto *Operand = Reduce->operand())
+    Reduce->set_operand(foldExpression(Operand));
+  return createWrapperRef(Reduce);
+}
+
+ResultTy ConstantFolder::visit(ast::ArrayHolder *ArrStore) {
+  assert(ArrStore->get());
+  acceptASTNode(ArrStore->get());
+  return createWrapperRef(ArrStore);
+}
+
+ResultTy ConstantFolder::visit(ast::PresetArray *PresetArr) {
+  for (auto &CurrExp : *PresetArr)
+    CurrExp = foldExpression(CurrExp);
+  return createWrapperRef(PresetArr);
+}
+
+ResultTy ConstantFolder::visit(ast::UniformArray *UnifArr) {
+  UnifArr->setInitExpr(foldExpression(UnifArr->getInitExpr()));
+  UnifArr->setSize(foldExpression(UnifArr->getSize()));
+  return createWrapperRef(UnifArr);
+}
+
+ResultTy ConstantFolder::visit(ast::ArrayAccess *ArrAccess) {
+  for (auto &IndexExp : *ArrAccess)
+    IndexExp = foldExpression(IndexExp);
+  return createWrapperRef(ArrAccess);
+}
+
+ResultTy ConstantFolder::visit(ast::ArrayAccessAssignment *ArrAssign) {
+  acceptASTNode(ArrAssign->getArrayAccess());
+  ArrAssign->setIdentExp(foldExpression(ArrAssign->getIdentExp()));
+  return createWrapperRef(ArrAssign);
+}
+
+ast::expression *ConstantFolder::foldExpression(ast::expression *Exp) {
+  assert(Exp);
+  auto *Folded = acceptASTNode(Exp).Node;
+  assert(Folded);
+  return static_cast<ast::expression *>(Folded);
+}
+
+ast::expression *ConstantFolder::foldCondition(ast::expression *Cond) {
+  return stripDoubleNegation(foldExpression(Cond));
+}
+
+ast::statement *ConstantFolder::foldBody(ast::statement *Body) {
+  assert(Body);
+  if (auto *Folded = acceptASTNode(Body).Node)
+    return Folded;
+  return AST.make_node<ast::statement_block>(nullptr);
+}
+
+std::optional<int> ConstantFolder::getConstant(ast::expression *Exp) {
+  if (auto *Num = dynamic_cast<ast::number *>(Exp))
+    return Num->get_value();
+  return std::nullopt;
+}
+
+ast::expression *ConstantFolder::stripDoubleNegation(ast::expression *Exp) {
+  auto AsNegation = [](ast::expression *Exp) -> ast::un_operator * {
+    auto *UnOp = dynamic_cast<ast::un_operator *>(Exp);
+    return UnOp && UnOp->type() == ast::UnOp::NEGATE ? UnOp : nullptr;
+  };
+  while (auto *Outer = AsNegation(Exp)) {
+    auto *Inner = AsNegation(Outer->arg());
+    if (!Inner)
+      break;
+    Exp = Inner->arg();
+  }
+  return Exp;
+}
+
+} // namespace paracl
@@ -0,0 +1,327 @@
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/Support/FormatVariadic.h>
+
+#include <iterator>
+#include <sstream>
+
+#include "ast_includes.hpp"
+#include "dependence_analyzer.hpp"
+
+namespace paracl {
+
+using ResultTy = DependenceAnalyzer::ResultTy;
+
+namespace {
+
+std::string toString(yy::location Loc) {
+  std::ostringstream Str;
+  Str << Loc;
+  return Str.str();
+}
+
+} // namespace
+
+void DependenceAnalyzer::run(ast::root_statement_block *RootBlock) {
+  Report.clear();
+  acceptASTNode(RootBlock);
+}
+
+void DependenceAnalyzer::print_report(llvm::raw_ostream &Os,
+                                      llvm::StringRef FileName) const {
+  for (auto &[Loc, Reason] : Report) {
+    std::ostringstream LocStr;
+    LocStr << Loc.begin;
+    if (Reason.empty())
+      Os << llvm::formatv("{0}:{1}: remark: the loop is parallelized\n",
+                          FileName, LocStr.str());
+    else
+      Os << llvm::formatv("{0}:{1}: remark: the loop isn't parallelized: {2}\n",
+                          FileName, LocStr.str(), Reason);
+  }
+}
+
+ResultTy DependenceAnalyzer::visit(ast::root_statement_block *StmBlock) {
+  return visit(static_cast<ast::statement_block *>(StmBlock));
+}
+
+ResultTy DependenceAnalyzer::visit(ast::statement_block *StmBlock) {
+  for (auto *CurStatement : *StmBlock) {
+    auto Mark = markWrappers();
+    acceptASTNode(CurStatement);
+    releaseWrappers(Mark);
+  }
+  return createWrapperRef();
+}
+
+ResultTy DependenceAnalyzer::visit(ast::calc_expression *CalcExp) {
+  acceptASTNode(CalcExp->left());
+  acceptASTNode(CalcExp->right());
+  // All the elements of the array operands are read
+  if (CalcExp->is_element_wise()) {
+    recordWholeUse(CalcExp->left());
+    recordWholeUse(CalcExp->right());
+  }
+  return createWrapperRef();
+}
+
+ResultTy DependenceAnalyzer::visit(ast::logic_expression *LogExp) {
+  acceptASTNode(LogExp->left());
+  acceptASTNode(LogExp->right());
+  // All the elements of the array operands are read
+  if (LogExp->is_element_wise()) {
+    recordWholeUse(LogExp->left());
+    recordWholeUse(LogExp->right());
+  }
+  return createWrapperRef();
+}
+
+ResultTy DependenceAnalyzer::visit(ast::un_operator *UnOp) {
+  acceptASTNode(UnOp->arg());
+  return createWrapperRef();
+}
+
+ResultTy DependenceAnalyzer::visit(ast::number *) { return createWrapperRef(); }
+
+ResultTy DependenceAnalyzer::visit(ast::variable *) {
+  return createWrapperRef();
+}
+
+ResultTy DependenceAnalyzer::visit(ast::assignment *Assign) {
+  acceptASTNode(Assign->getIdentExp());
+  if (!CurrLoop || !isDeclaredOutside(Assign->getLValue()))
+    return createWrapperRef();
+  if (Assign->slot() == Induction->slot())
+    rejectLoop(llvm::formatv("'{0}' is assigned at {1} before the increment",
+                             Assign->name(), toString(Assign->location())));
+  else
+    rejectLoop(llvm::formatv("'{0}' declared outside of the loop is assigned "
+                             "at {1}, its value is carried to the next "
+                             "iteration",
+                             Assign->name(), toString(Assign->location())));
+  return createWrapperRef();
+}
+
+ResultTy DependenceAnalyzer::visit(ast::if_operator *If) {
+  acceptASTNode(If->condition());
+  acceptASTNode(If->body());
+  if (auto *ElseBlock = If->else_block())
+    acceptASTNode(ElseBlock);
+  return createWrapperRef();
+}
+
+ResultTy DependenceAnalyzer::visit(ast::while_operator *While) {
+  if (CurrLoop) {
+    acceptASTNode(While->condition());
+    acceptASTNode(While->body());
+    return createWrapperRef();
+  }
+
+  auto Reason = analyzeLoop(While);
+  Report.push_back({While->location(), Reason});
+  if (Reason.empty())
+    While->set_parallel_induction(Induction);
+  else
+    // The inner loops may be parallelized on their own
+    acceptASTNode(While->body());
+  return createWrapperRef();
+}
+
+ResultTy DependenceAnalyzer::visit(ast::pfor_operator *PFor) {
+  // The loops in the body of pfor are already executed in parallel
+  if (!CurrLoop)
+    return createWrapperRef();
+  acceptASTNode(PFor->init());
+  acceptASTNode(PFor->limit());
+  acceptASTNode(PFor->body());
+  return createWrapperRef();
+}
+
+ResultTy DependenceAnalyzer::visit(ast::read_expression *ReadExp) {
+  if (CurrLoop)
+    rejectLoop(llvm::formatv("the input is read at {0}",
+                             toString(ReadExp->location())));
+  return createWrapperRef();
+}
+
+ResultTy DependenceAnalyzer::visit(ast::print_function *Print) {
+  acceptASTNode(Print->get());
+  if (CurrLoop)
+    rejectLoop(llvm::formatv("the output at {0} would be reordered",
+                             toString(Print->location())));
+  return createWrapperRef();
+}
+
+ResultTy DependenceAnalyzer::visit(ast::reduce_function *Reduce) {
+  acceptASTNode(Reduce->array());
+  recordWholeUse(Reduce->array());
+  if (auto *Operand = Reduce->operand()) {
+    acceptASTNode(Operand);
+    recordWholeUse(Operand);
+  }
+  return createWrapperRef();
+}
+
+ResultTy DependenceAnalyzer::visit(ast::ArrayHolder *ArrStore) {
+  return acceptASTNode(ArrStore->get());
+}
+
+ResultTy DependenceAnalyzer::visit(ast::PresetArray *PresetArr) {
+  for (auto *Elem : *PresetArr) {
+    acceptASTNode(Elem);
+    recordWholeUse(Elem);
+  }
+  return createWrapperRef();
+}
+
+ResultTy DependenceAnalyzer::visit(ast::UniformArray *UnifArr) {
+  auto *InitExpr = UnifArr->getInitExpr();
+  acceptASTNode(InitExpr);
+  acceptASTNode(UnifArr->getSize());
+  recordWholeUse(InitExpr);
+  return createWrapperRef();
+}
+
+ResultTy DependenceAnalyzer::visit(ast::ArrayAccess *ArrAccess) {
+  for (auto *Index : *ArrAccess)
+    acceptASTNode(Index);
+  if (CurrLoop)
+    recordAccess(ArrAccess, /*IsWrite=*/false);
+  return createWrapperRef();
+}
+
+ResultTy DependenceAnalyzer::visit(ast::ArrayAccessAssignment *ArrAssign) {
+  auto *ArrAccess = ArrAssign->getArrayAccess();
+  for (auto *Index : *ArrAccess)
+    acceptASTNode(Index);
+  acceptASTNode(ArrAssign->getIdentExp());
+  if (CurrLoop)
+    recordAccess(ArrAccess, /*IsWrite=*/true);
+  return createWrapperRef();
+}
+
+std::string DependenceAnalyzer::analyzeLoop(ast::while_operator *While) {
+  auto *Cond = dynamic_cast<ast::logic_expression *>(While->condition());
+  Induction = Cond ? dynamic_cast<ast::variable *>(Cond->left()) : nullptr;
+  if (!Induction || dynamic_cast<ast::ArrayAccess *>(Induction) ||
+      Cond->type() != ast::LogicOp::LESS)
+    return "the condition isn't of the form 'i < limit'";
+
+  auto *Body = dynamic_cast<ast::statement_block *>(While->body());
+  auto *Increment = Body && Body->size()
+                        ? dynamic_cast<ast::assignment *>(*std::prev(Body->end()))
+                        : nullptr;
+  if (!Increment || !(Increment->slot() == Induction->slot()) ||
+      getInductionOffset(Increment->getIdentExp()) != 1)
+    return llvm::formatv("the body doesn't end with '{0} = {0} + 1'",
+                         Induction->name());
+  if (!isLoopInvariant(Cond->right()))
+    return "the limit may change in the body";
+
+  CurrLoop = While;
+  BodyDepth = Body->depth();
+  Rejection.clear();
+  Arrays.clear();
+  for (auto *CurStatement : llvm::make_range(Body->begin(), std::prev(Body->end()))) {
+    auto Mark = markWrappers();
+    acceptASTNode(CurStatement);
+    releaseWrappers(Mark);
+  }
+  CurrLoop = nullptr;
+  if (!Rejection.empty())
+    return Rejection;
+
+  for (auto &[Key, Uses] : Arrays) {
+    if (!Uses.IsWritten)
+      continue;
+    auto *First = Uses.Accesses.front();
+    auto Name = First->name();
+    if (Uses.IsUsedWhole)
+      return llvm::formatv("the written array '{0}' is used as a whole", Name);
+    // The iterations access the different elements if all the accesses have
+    // the same offset from i in one dimension
+    unsigned Dim = llvm::find_if(*First, [this](auto *Index) {
+                     return getInductionOffset(Index).has_value();
+                   }) -
+                   First->begin();
+    if (Dim == First->getSize())
+      return llvm::formatv("'{0}' is written, but none of its indexes at {1} "
+                           "is '{2}' plus a constant",
+                           Name, toString(First->location()),
+                           Induction->name());
+    auto FirstOffset = getInductionOffset(First->begin()[Dim]);
+    for (auto *Access : Uses.Accesses) {
+      if (Access->getSize() <= Dim)
+        return llvm::formatv("'{0}' is written, but its part is accessed at "
+                             "{1}",
+                             Name, toString(Access->location()));
+      if (getInductionOffset(Access->begin()[Dim]) != FirstOffset)
+        return llvm::formatv("'{0}' is accessed at {1} and at {2} with the "
+                             "different offsets from '{3}', the iterations "
+                             "depend on each other",
+                             Name, toString(First->location()),
+                             toString(Access->location()), Induction->name());
+    }
+  }
+  return {};
+}
+
+std::optional<int64_t>
+DependenceAnalyzer::getInductionOffset(ast::expression *Exp) {
+  if (isInductionVariable(Exp))
+    return 0;
+  auto *CalcExp = dynamic_cast<ast::calc_expression *>(Exp);
+  if (!CalcExp)
+    return {};
+  auto *Num = dynamic_cast<ast::number *>(CalcExp->right());
+  auto *Other = CalcExp->left();
+  if (!Num && CalcExp->type() == ast::CalcOp::ADD) {
+    Num = dynamic_cast<ast::number *>(CalcExp->left());
+    Other = CalcExp->right();
+  }
+  if (!Num || !isInductionVariable(Other))
+    return {};
+  if (CalcExp->type() == ast::CalcOp::ADD)
+    return Num->get_value();
+  if (CalcExp->type() == ast::CalcOp::SUB)
+    return -static_cast<int64_t>(Num->get_value());
+  return {};
+}
+
+bool DependenceAnalyzer::isInductionVariable(ast::expression *Exp) {
+  auto *Var = dynamic_cast<ast::variable *>(Exp);
+  return Var && !dynamic_cast<ast::ArrayAccess *>(Var) &&
+         Var->slot() == Induction->slot();
+}
+
+bool DependenceAnalyzer::isLoopInvariant(ast::expression *Exp) {
+  // The variables assigned in the body are rejected by the analysis of the body
+  if (dynamic_cast<ast::number *>(Exp))
+    return true;
+  if (auto *Var = dynamic_cast<ast::variable *>(Exp))
+    return !dynamic_cast<ast::ArrayAccess *>(Var) && !isInductionVariable(Var);
+  if (auto *CalcExp = dynamic_cast<ast::calc_expression *>(Exp))
+    return isLoopInvariant(CalcExp->left()) && isLoopInvariant(CalcExp->right());
+  if (auto *LogExp = dynamic_cast<ast::logic_expression *>(Exp))
+    return isLoopInvariant(LogExp->left()) && isLoopInvariant(LogExp->right());
+  if (auto *UnOp = dynamic_cast<ast::un_operator *>(Exp))
+    return isLoopInvariant(UnOp->arg());
+  return false;
+}
+
+void DependenceAnalyzer::recordAccess(ast::ArrayAccess *ArrAccess,
+                                      bool IsWrite) {
+  if (!isDeclaredOutside(ArrAccess))
+    return;
+  auto &Uses = Arrays[getKey(ArrAccess->slot())];
+  Uses.IsWritten |= IsWrite;
+  Uses.Accesses.push_back(ArrAccess);
+}
+
+void DependenceAnalyzer::recordWholeUse(ast::expression *Exp) {
+  auto *Var = dynamic_cast<ast::variable *>(Exp);
+  if (CurrLoop && Var && !dynamic_cast<ast::ArrayAccess *>(Var) &&
+      isDeclaredOutside(Var))
+    Arrays[getKey(Var->slot())].IsUsedWhole = true;
+}
+
+} // namespace paracl
@@ -3,6 +3,7 @@
 #include <llvm/Support/FormatVariadic.h>
 
 #include <sstream>
+#include <utility>
 
 #include "ast_includes.hpp"
 #include "error_handler.hpp"
@@ -21,14 +22,22 @@ ResultTy ErrorHandler::visit(ast::statement_block *StmBlock) {
 }
 
 ResultTy ErrorHandler::visit(ast::calc_expression *CalcExp) {
-  auto [LhsTy, LhsVal] = acceptASTNode(CalcExp->left());
-  auto [RhsTy, RhsVal] = acceptASTNode(CalcExp->right());
+  auto [Lhs, Rhs] = acceptOperands(CalcExp);
+  auto [LhsTy, LhsVal] = Lhs;
+  auto [RhsTy, RhsVal] = Rhs;
+  if ((LhsTy && LhsTy->isArrayTy()) || (RhsTy && RhsTy->isArrayTy())) {
+    auto *Type = checkElementWise(CalcExp, {CalcExp->left(), LhsTy},
+                                  {CalcExp->right(), RhsTy});
+    if (Type)
+      CalcExp->set_element_wise();
+    return createWrapperRef(Type);
+  }
   if (!LhsTy || !RhsTy) {
     Errors.emplace_back("expression is not computable. Couldn't deduce the "
                         "types for arithmetic operation.",
                         CalcExp->location());
   } else {
-    if (*LhsTy != *RhsTy)
+    if (LhsTy->getTypeID() != RhsTy->getTypeID())
       Errors.push_back(
           {llvm::formatv("expression is not computable. Couldn't compute "
                          "values with types '{0}' and '{1}'",
@@ -42,24 +51,37 @@ ResultTy ErrorHandler::visit(ast::calc_expression *CalcExp) {
            CalcExp->location()});
     else if (LhsVal && RhsVal)
       return createWrapperRef(
-          LhsTy, performArithmeticOperation(
-                     CalcExp->type(), static_cast<IntegerVal *>(LhsVal),
-                     static_cast<IntegerVal *>(RhsVal),
-                     static_cast<IntegerTy *>(LhsTy), CalcExp->location()));
+          LhsTy, ValManager.createValue<IntegerVal>(
+                     performArithmeticOperation(
+                         CalcExp->type(), *static_cast<IntegerVal *>(LhsVal),
+                         *static_cast<IntegerVal *>(RhsVal),
+                         CalcExp->location()),
+                     static_cast<IntegerTy *>(LhsTy)));
     return createWrapperRef(LhsTy, nullptr);
   }
   return createWrapperRef();
 }
 
 ResultTy ErrorHandler::visit(ast::logic_expression *LogExp) {
-  auto [LhsTy, LhsVal] = acceptASTNode(LogExp->left());
-  auto [RhsTy, RhsVal] = acceptASTNode(LogExp->right());
+  auto [Lhs, Rhs] = acceptOperands(LogExp);
+  auto [LhsTy, LhsVal] = Lhs;
+  auto [RhsTy, RhsVal] = Rhs;
+  // The short-circuit operators need the truth of the whole operand
+  if (LogExp->type() != ast::LogicOp::AND &&
+      LogExp->type() != ast::LogicOp::OR &&
+      ((LhsTy && LhsTy->isArrayTy()) || (RhsTy && RhsTy->isArrayTy()))) {
+    auto *Type = checkElementWise(LogExp, {LogExp->left(), LhsTy},
+                                  {LogExp->right(), RhsTy});
+    if (Type)
+      LogExp->set_element_wise();
+    return createWrapperRef(Type);
+  }
   if (!LhsTy || !RhsTy) {
     Errors.emplace_back("expression is not comparable. Couldn't deduce the "
                         "types for logic comparison.",
                         LogExp->location());
   } else {
-    if (*LhsTy != *RhsTy)
+    if (LhsTy->getTypeID() != RhsTy->getTypeID())
       Errors.push_back({llvm::formatv("expression is not comparable. "
                                       "Couldn't compare '{0}' and '{1}'",
                                       LhsTy->getName(), RhsTy->getName()),
@@ -72,10 +94,11 @@ ResultTy ErrorHandler::visit(ast::logic_expression *LogExp) {
            LogExp->location()});
     else if (LhsVal && RhsVal)
       return createWrapperRef(
-          LhsTy, performLogicalOperation(LogExp->type(),
-                                         static_cast<IntegerVal *>(LhsVal),
-                                         static_cast<IntegerVal *>(RhsVal),
-                                         static_cast<IntegerTy *>(LhsTy)));
+          LhsTy, ValManager.createValue<IntegerVal>(
+                     performLogicalOperation(
+                         LogExp->type(), *static_cast<IntegerVal *>(LhsVal),
+                         *static_cast<IntegerVal *>(RhsVal)),
+                     static_cast<IntegerTy *>(LhsTy)));
     else
       return createWrapperRef(LhsTy, nullptr);
   }
@@ -96,9 +119,10 @@ ResultTy ErrorHandler::visit(ast::un_operator *UnOp) {
            UnOp->location()});
     else if (Value)
       return createWrapperRef(
-          Type,
-          performUnaryOperation(UnOp->type(), static_cast<IntegerVal *>(Value),
-                                static_cast<IntegerTy *>(Type)));
+          Type, ValManager.createValue<IntegerVal>(
+                    performUnaryOperation(UnOp->type(),
+                                          *static_cast<IntegerVal *>(Value)),
+                    static_cast<IntegerTy *>(Type)));
     else
       return createWrapperRef(Type, nullptr);
   }
@@ -106,7 +130,7 @@ ResultTy ErrorHandler::visit(ast::un_operator *UnOp) {
 }
 
 ResultTy ErrorHandler::visit(ast::number *Num) {
-  auto *Type = SymTbl.createType<TypeID::Int32>();
+  auto *Type = SymTbl.getInt32Ty();
   return createWrapperRef(
       Type, ValManager.createValue<IntegerVal>(Num->get_value(), Type));
 }
@@ -128,11 +152,17 @@ ResultTy ErrorHandler::visit(ast::variable *Var) {
 ResultTy ErrorHandler::visit(ast::assignment *Assign) {
   static constexpr llvm::StringRef ErrDesc = "expression is not assignable";
 
+  auto *SavedRoot = std::exchange(ElementWiseRoot, Assign->getIdentExp());
   auto [IdentType, IdentVal] = acceptASTNode(Assign->getIdentExp());
+  ElementWiseRoot = SavedRoot;
   auto EntityKey = Assign->entityKey();
   if (!SymTbl.isDefined(EntityKey) && IdentType) {
     assert(IdentType);
-    if (SymTbl.containsKeyWithType(IdentType) && IdentType->isArrayTy()) {
+    // Only a newly created array can be bound to a name, any other array
+    // expression refers to an existing array
+    if (IdentType->isArrayTy() &&
+        !dynamic_cast<ast::ArrayHolder *>(Assign->getIdentExp()) &&
+        !ast::is_element_wise(Assign->getIdentExp())) {
       Errors.emplace_back(
           llvm::formatv("{0}: arrays cannot be copy constructed", ErrDesc),
           Assign->location());
@@ -146,6 +176,19 @@ ResultTy ErrorHandler::visit(ast::assignment *Assign) {
         Assign->location());
   }
 
+  // The variables declared outside of pfor are shared by its iterations
+  if (auto *DeclScope = SymTbl.getDeclScopeFor(EntityKey);
+      DeclScope && !ParallelBodies.empty()) {
+    auto *Scope = DeclScope;
+    while (Scope && Scope != ParallelBodies.back())
+      Scope = Scope->scope();
+    if (!Scope)
+      Errors.emplace_back(
+          llvm::formatv("{0}: '{1}' is declared outside of the pfor body",
+                        ErrDesc, Assign->name()),
+          Assign->location());
+  }
+
   auto [LValueType, LVal] = acceptASTNode(Assign->getLValue());
   if (!IdentType || !LValueType)
     Errors.emplace_back(
@@ -153,7 +196,7 @@ ResultTy ErrorHandler::visit(ast::assignment *Assign) {
                       "types for initializing the '{1}' variable",
                       ErrDesc, Assign->name()),
         Assign->location());
-  else if (IdentType && LValueType && *IdentType != *LValueType)
+  else if (IdentType->getTypeID() != LValueType->getTypeID())
     Errors.push_back(
         {llvm::formatv("{0}: couldn't convert '{1}' to '{2}'", ErrDesc,
                        IdentType->getName(), LValueType->getName()),
@@ -198,12 +241,40 @@ ResultTy ErrorHandler::visit(ast::while_operator *While) {
   return acceptASTNode(While->body());
 }
 
-ResultTy ErrorHandler::visit(ast::read_expression * /*unused*/) {
+ResultTy ErrorHandler::visit(ast::pfor_operator *PFor) {
+  for (auto *Bound : {PFor->init(), PFor->limit()}) {
+    auto [Type, Value] = acceptASTNode(Bound);
+    if (!Type)
+      Errors.emplace_back("couldn't calculate the bound of the pfor statement. "
+                          "Type is unknown",
+                          Bound->location());
+    else if (!Type->isInt32Ty())
+      Errors.emplace_back(
+          llvm::formatv("couldn't calculate the bound of the '{0}' type for "
+                        "the pfor statement. Only integer types are expected "
+                        "in the bounds.",
+                        Type->getName()),
+          Bound->location());
+  }
+
+  // The value of the loop variable is different in every iteration
+  [[maybe_unused]] auto IsDefined = SymTbl.tryDefine(
+      PFor->loop_variable()->entityKey(), SymTbl.getInt32Ty());
+  assert(IsDefined);
+  ParallelBodies.push_back(PFor->body());
+  acceptASTNode(PFor->body());
+  ParallelBodies.pop_back();
+  return createWrapperRef();
+}
+
+ResultTy ErrorHandler::visit(ast::read_expression *ReadExp) {
+  checkParallelUse("'?'", ReadExp->location());
   // Pass nullptr as Value* because we handle only 'compile time' cases
-  return createWrapperRef(SymTbl.createType<TypeID::Int32>());
+  return createWrapperRef(SymTbl.getInt32Ty());
 }
 
 ResultTy ErrorHandler::visit(ast::print_function *Print) {
+  checkParallelUse("print", Print->location());
   auto [Type, _] = acceptASTNode(Print->get());
   if (Type && !isPrintableType(*Type)) {
     Errors.emplace_back(
@@ -215,6 +286,31 @@ ResultTy ErrorHandler::visit(ast::print_function *Print) {
   return createWrapperRef(Type);
 }
 
+ResultTy ErrorHandler::visit(ast::reduce_function *Reduce) {
+  auto CheckArgument = [&](ast::expression *Arg, bool IsArray) {
+    auto [Type, _] = acceptASTNode(Arg);
+    if (!Type)
+      return;
+    if (Type->isArrayTy() != IsArray)
+      Errors.emplace_back(
+          llvm::formatv("invalid operand type to {0}: '{1}'", Reduce->name(),
+                        Type->getName()),
+          Arg->location());
+    // The arrays are reduced in place, so they must be named
+    else if (IsArray && (!dynamic_cast<ast::variable *>(Arg) ||
+                         dynamic_cast<ast::ArrayAccess *>(Arg)))
+      Errors.emplace_back(
+          llvm::formatv("the operand of {0} must be an array variable",
+                        Reduce->name()),
+          Arg->location());
+  };
+
+  CheckArgument(Reduce->array(), /* IsArray */ true);
+  if (auto *Operand = Reduce->operand())
+    CheckArgument(Operand, Reduce->type() == ast::ReduceOp::DOT);
+  return createWrapperRef(SymTbl.getInt32Ty());
+}
+
 ResultTy ErrorHandler::visit(ast::ArrayHolder *ArrStore) {
   auto *Arr = ArrStore->get();
   assert(Arr);
@@ -262,17 +358,14 @@ ResultTy ErrorHandler::visit(ast::PresetArray *PresetArr) {
     Errors.emplace_back(TopErrorMes + llvm::join(InvalidArrArgs, "\n"),
                         PresetArr->location());
   }
-  auto *ArrType = SymTbl.createType<TypeID::PresetArray>();
-  ArrType->setContainedType(SymTbl.createType<TypeID::Int32>());
-  if (ArrSz.has_value())
-    ArrType->setSize(ArrSz.value());
-  return createWrapperRef(ArrType);
+  return createWrapperRef(
+      SymTbl.getArrayTy(TypeID::PresetArray, SymTbl.getInt32Ty(), ArrSz));
 }
 
 ResultTy ErrorHandler::visit(ast::UniformArray *UnifArr) {
   auto [ContainType, _] = acceptASTNode(UnifArr->getInitExpr());
   auto [SizeType, SizeVal] = acceptASTNode(UnifArr->getSize());
-  auto *ArrType = SymTbl.createType<TypeID::UniformArray>();
+  std::optional<unsigned> ArrSz;
   if (SizeType) {
     if (!SizeType->isInt32Ty())
       Errors.emplace_back(
@@ -280,10 +373,10 @@ ResultTy ErrorHandler::visit(ast::UniformArray *UnifArr) {
                         SizeType->getName()),
           UnifArr->location());
     else if (SizeVal)
-      ArrType->setSize(static_cast<IntegerVal *>(SizeVal)->getValue());
+      ArrSz = static_cast<IntegerVal *>(SizeVal)->getValue();
   }
-  ArrType->setContainedType(ContainType);
-  return createWrapperRef(ArrType);
+  return createWrapperRef(
+      SymTbl.getArrayTy(TypeID::UniformArray, ContainType, ArrSz));
 }
 
 ResultTy ErrorHandler::visit(ast::ArrayAccess *ArrAccess) {
@@ -334,7 +427,7 @@ ResultTy ErrorHandler::visit(ast::ArrayAccess *ArrAccess) {
     }
     CurrArrTy = static_cast<ArrayTy *>(CurrArrTy->getContainedType());
   }
-  return createWrapperRef(SymTbl.createType<TypeID::Int32>());
+  return createWrapperRef(SymTbl.getInt32Ty());
 }
 
 ResultTy ErrorHandler::visit(ast::ArrayAccessAssignment *ArrAssign) {
@@ -350,7 +443,7 @@ ResultTy ErrorHandler::visit(ast::ArrayAccessAssignment *ArrAssign) {
     Errors.emplace_back(
         "expression is not assignable. Arrays cannot be assigned",
         ArrAssign->location());
-  if (LhsTy && RhsTy && *LhsTy != *RhsTy) {
+  if (LhsTy && RhsTy && LhsTy != RhsTy) {
     Errors.push_back({llvm::formatv("expression is not assignable. "
                                     "Couldn't convert '{0}' to '{1}'",
                                     RhsTy->getName(), LhsTy->getName()),
@@ -399,6 +492,77 @@ ErrorHandler::makeValidationMessage(ErrorType Err,
   return llvm::formatv("{0}: {2}{1}", ErrPos.str(), Err.first, DiagnosticStr);
 }
 
+void ErrorHandler::checkParallelUse(llvm::StringRef What, yy::location Loc) {
+  if (!ParallelBodies.empty())
+    Errors.emplace_back(
+        llvm::formatv("{0} can't be used in the body of pfor, its iterations "
+                      "are executed in any order",
+                      What),
+        Loc);
+}
+
+ArrayTy *
+ErrorHandler::checkElementWise(ast::expression *Exp,
+                               std::pair<ast::expression *, PCLType *> Lhs,
+                               std::pair<ast::expression *, PCLType *> Rhs) {
+  if (Exp != ElementWiseRoot) {
+    Errors.emplace_back("an element-wise expression can only initialize a new "
+                        "array",
+                        Exp->location());
+    return nullptr;
+  }
+  ArrayTy *ResultTy = nullptr;
+  for (auto [Operand, Type] : {Lhs, Rhs}) {
+    // The error is already reported
+    if (!Type)
+      return nullptr;
+    if (!Type->isArrayTy())
+      continue;
+    // The arrays are read in place, so they have to be named
+    if (!ast::is_element_wise(Operand) &&
+        (!dynamic_cast<ast::variable *>(Operand) ||
+         dynamic_cast<ast::ArrayAccess *>(Operand))) {
+      Errors.emplace_back("the array operands of an element-wise expression "
+                          "must be array variables",
+                          Operand->location());
+      return nullptr;
+    }
+    auto *ArrTy = static_cast<ArrayTy *>(Type);
+    if (!ResultTy) {
+      ResultTy = ArrTy;
+      continue;
+    }
+    auto LhsRank = computeArrayDimension(ResultTy);
+    auto RhsRank = computeArrayDimension(ArrTy);
+    if (LhsRank != RhsRank) {
+      Errors.push_back({llvm::formatv("element-wise operation on the arrays of "
+                                      "the different ranks {0} and {1}",
+                                      LhsRank, RhsRank),
+                        Exp->location()});
+      return nullptr;
+    }
+    // The sizes unknown before the execution are checked at runtime
+    for (auto *LhsArr = ResultTy, *RhsArr = ArrTy;;) {
+      auto LhsSize = LhsArr->getSize(), RhsSize = RhsArr->getSize();
+      if (LhsSize && RhsSize && *LhsSize != *RhsSize) {
+        Errors.push_back({llvm::formatv("element-wise operation on the arrays "
+                                        "of the different sizes {0} and {1}",
+                                        *LhsSize, *RhsSize),
+                          Exp->location()});
+        return nullptr;
+      }
+      auto *ContainedTy = LhsArr->getContainedType();
+      if (!ContainedTy || !ContainedTy->isArrayTy())
+        break;
+      LhsArr = static_cast<ArrayTy *>(LhsArr->getContainedType());
+      RhsArr = static_cast<ArrayTy *>(RhsArr->getContainedType());
+    }
+    if (!ResultTy->getSize() && ArrTy->getSize())
+      ResultTy = ArrTy;
+  }
+  return ResultTy;
+}
+
 unsigned ErrorHandler::computeArrayDimension(ArrayTy *Arr) {
   assert(Arr);
   auto *ContainedType = Arr->getContainedType();
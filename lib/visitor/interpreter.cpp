@@ -1,115 +1,154 @@
+#include <llvm/ADT/STLExtras.h>
 #include <llvm/Support/FormatVariadic.h>
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
+#include <vector>
 
+#include "array_reduce.hpp"
 #include "ast_includes.hpp"
+#include "element_wise.hpp"
 #include "identifiers.hpp"
 #include "interpreter.hpp"
+#include "jit.hpp"
+#include "thread_pool.hpp"
 #include "utils.hpp"
 
 namespace paracl {
 
 using ResultTy = InterpreterBase::ResultTy;
 
-ResultTy InterpreterBase::performLogicalOperation(ast::LogicOp Op,
-                                                  IntegerVal *Lhs,
-                                                  IntegerVal *Rhs,
-                                                  IntegerTy *Type) {
-  assert(Lhs);
-  assert(Rhs);
-  assert(Type);
+namespace {
+
+// The integers wrap around like in the compiled code
+int32_t wrapAdd(int32_t Lhs, uint32_t Rhs) {
+  return static_cast<int32_t>(static_cast<uint32_t>(Lhs) + Rhs);
+}
+
+int32_t wrapMul(int32_t Lhs, uint32_t Rhs) {
+  return static_cast<int32_t>(static_cast<uint32_t>(Lhs) * Rhs);
+}
+
+// Reduces the rows one by one, so the rows that aren't written yet are never
+// materialized
+int32_t reduceArray(ast::ReduceOp Op, const ArrayBase &Arr, int32_t Val) {
+  auto RowSize = Arr.getRowSize();
+  auto Fill = Arr.getFill();
+  int32_t Acc = Op == ast::ReduceOp::MIN   ? INT32_MAX
+                : Op == ast::ReduceOp::MAX ? INT32_MIN
+                                           : 0;
+  if (!RowSize)
+    return Acc;
+  for (auto &Row : Arr.getRows()) {
+    switch (Op) {
+    case ast::ReduceOp::SUM:
+      Acc = wrapAdd(Acc, Row ? runtime::sumArray(Row.get(), RowSize)
+                             : wrapMul(Fill, RowSize));
+      break;
+    case ast::ReduceOp::MIN:
+      Acc = std::min(Acc, Row ? runtime::minArray(Row.get(), RowSize) : Fill);
+      break;
+    case ast::ReduceOp::MAX:
+      Acc = std::max(Acc, Row ? runtime::maxArray(Row.get(), RowSize) : Fill);
+      break;
+    case ast::ReduceOp::COUNT:
+      Acc = wrapAdd(Acc, Row ? runtime::countInArray(Row.get(), RowSize, Val)
+                             : (Fill == Val) * RowSize);
+      break;
+    default:
+      llvm_unreachable("dot isn't a reduction of one array");
+    }
+  }
+  return Acc;
+}
+
+// The arrays must have the same size
+int32_t dotArrays(const ArrayBase &Lhs, const ArrayBase &Rhs) {
+  auto RowSize = Lhs.getRowSize();
+  // The arrays of the different shapes are flattened first
+  if (RowSize != Rhs.getRowSize()) {
+    std::vector<int32_t> LhsElems(Lhs.getSize()), RhsElems(Rhs.getSize());
+    Lhs.copyTo(LhsElems.data());
+    Rhs.copyTo(RhsElems.data());
+    return runtime::dotArrays(LhsElems.data(), RhsElems.data(),
+                              LhsElems.size());
+  }
+  int32_t Acc = 0;
+  for (auto [LhsRow, RhsRow] : llvm::zip(Lhs.getRows(), Rhs.getRows())) {
+    if (LhsRow && RhsRow)
+      Acc = wrapAdd(Acc,
+                    runtime::dotArrays(LhsRow.get(), RhsRow.get(), RowSize));
+    else if (LhsRow)
+      Acc = wrapAdd(Acc, wrapMul(runtime::sumArray(LhsRow.get(), RowSize),
+                                 Rhs.getFill()));
+    else if (RhsRow)
+      Acc = wrapAdd(Acc, wrapMul(runtime::sumArray(RhsRow.get(), RowSize),
+                                 Lhs.getFill()));
+    else
+      Acc = wrapAdd(Acc, wrapMul(wrapMul(Lhs.getFill(), Rhs.getFill()),
+                                 RowSize));
+  }
+  return Acc;
+}
+
+} // namespace
+
+int InterpreterBase::performLogicalOperation(ast::LogicOp Op, int Lhs,
+                                             int Rhs) {
   switch (Op) {
   case ast::LogicOp::LESS:
-    return createWrapperRef(
-        ValManager.createValue<IntegerVal>(*Lhs < *Rhs, Type));
+    return Lhs < Rhs;
   case ast::LogicOp::LESS_EQ:
-    return createWrapperRef(
-        ValManager.createValue<IntegerVal>(*Lhs <= *Rhs, Type));
-    break;
+    return Lhs <= Rhs;
   case ast::LogicOp::AND:
-    return createWrapperRef(
-        ValManager.createValue<IntegerVal>(*Lhs && *Rhs, Type));
-    break;
+    return Lhs && Rhs;
   case ast::LogicOp::OR:
-    return createWrapperRef(
-        ValManager.createValue<IntegerVal>(*Lhs || *Rhs, Type));
-    break;
+    return Lhs || Rhs;
   case ast::LogicOp::GREATER:
-    return createWrapperRef(
-        ValManager.createValue<IntegerVal>(*Lhs > *Rhs, Type));
-    break;
+    return Lhs > Rhs;
   case ast::LogicOp::GREATER_EQ:
-    return createWrapperRef(
-        ValManager.createValue<IntegerVal>(*Lhs >= *Rhs, Type));
-    break;
+    return Lhs >= Rhs;
   case ast::LogicOp::EQ:
-    return createWrapperRef(
-        ValManager.createValue<IntegerVal>(*Lhs == *Rhs, Type));
-    break;
+    return Lhs == Rhs;
   case ast::LogicOp::NEQ:
-    return createWrapperRef(
-        ValManager.createValue<IntegerVal>(*Lhs != *Rhs, Type));
-    break;
+    return Lhs != Rhs;
   default:
     llvm_unreachable("Unsupported logic operator");
   }
 }
 
-ResultTy InterpreterBase::performUnaryOperation(ast::UnOp Op, IntegerVal *Value,
-                                                IntegerTy *Type) {
-  assert(Value);
-  assert(Type);
+int InterpreterBase::performUnaryOperation(ast::UnOp Op, int Value) {
   switch (Op) {
   case ast::UnOp::PLUS:
-    return createWrapperRef(Value);
-    break;
+    return Value;
   case ast::UnOp::MINUS:
-    return createWrapperRef(ValManager.createValue<IntegerVal>(-*Value, Type));
-    break;
+    return -Value;
   case ast::UnOp::NEGATE:
-    return createWrapperRef(ValManager.createValue<IntegerVal>(!*Value, Type));
-    break;
+    return !Value;
   default:
     llvm_unreachable("Unsupported unary operator");
   }
 }
 
-ResultTy InterpreterBase::performArithmeticOperation(ast::CalcOp Op,
-                                                     IntegerVal *Lhs,
-                                                     IntegerVal *Rhs,
-                                                     IntegerTy *Type,
-                                                     yy::location Loc) {
-  assert(Lhs);
-  assert(Rhs);
-  assert(Type);
+int InterpreterBase::performArithmeticOperation(ast::CalcOp Op, int Lhs,
+                                                int Rhs, yy::location Loc) {
   switch (Op) {
   case ast::CalcOp::ADD:
-    return createWrapperRef(
-        ValManager.createValue<IntegerVal>(*Lhs + *Rhs, Type));
-    break;
+    return Lhs + Rhs;
   case ast::CalcOp::SUB:
-    return createWrapperRef(
-        ValManager.createValue<IntegerVal>(*Lhs - *Rhs, Type));
-    break;
+    return Lhs - Rhs;
   case ast::CalcOp::MUL:
-    return createWrapperRef(
-        ValManager.createValue<IntegerVal>(*Lhs * *Rhs, Type));
-    break;
+    return Lhs * Rhs;
   case ast::CalcOp::PERCENT:
-    return createWrapperRef(
-        ValManager.createValue<IntegerVal>(*Lhs % *Rhs, Type));
-    break;
+    return Lhs % Rhs;
   case ast::CalcOp::DIV:
-    if (int check = *Rhs; check) {
-      return createWrapperRef(
-          ValManager.createValue<IntegerVal>(*Lhs / check, Type));
-    } else {
+    if (!Rhs) {
       std::ostringstream Str;
       Str << Loc;
       paracl::fatal(llvm::formatv("{0}, trying to divide by 0", Str.str()));
     }
-    break;
+    return Lhs / Rhs;
   default:
     llvm_unreachable("Unsupported calculation operator");
   }
@@ -120,58 +159,66 @@ ResultTy Interpreter::visit(ast::root_statement_block *StmBlock) {
 }
 
 ResultTy Interpreter::visit(ast::statement_block *StmBlock) {
+  auto &Frame = Frames[StmBlock];
+  Frame.resize(StmBlock->slots_num());
+  auto Depth = StmBlock->depth();
+  if (ActiveFrames.size() <= Depth)
+    ActiveFrames.resize(Depth + 1);
+  ActiveFrames[Depth] = Frame.data();
+
+  // The arrays can't escape the block where they were created: they are either
+  // temporaries or bound to the variables of this block
+  auto Region = ValManager.openRegion();
   auto &StmAccept = acceptStatementBlock(StmBlock);
-  freeResources(StmBlock);
+  // The nested blocks may have grown the map, so the frame is looked up again
+  for (auto &Value : Frames[StmBlock])
+    if (Value.isArray())
+      Value = {};
+  ValManager.releaseRegion(Region);
   return StmAccept;
 }
 
 ResultTy Interpreter::visit(ast::calc_expression *CalcExp) {
-  auto *Lhs = acceptASTNode(CalcExp->left()).getAs<IntegerVal>();
-  auto *Rhs = acceptASTNode(CalcExp->right()).getAs<IntegerVal>();
-  auto *Type = Lhs->getType();
-  assert(Type->isInt32Ty());
-
-  return performArithmeticOperation(CalcExp->type(), Lhs, Rhs, Type,
-                                    CalcExp->location());
+  if (CalcExp->is_element_wise())
+    return createWrapperRef(evaluateElementWise(CalcExp));
+  auto Lhs = acceptASTNode(CalcExp->left()).getInt();
+  auto Rhs = acceptASTNode(CalcExp->right()).getInt();
+  // The printed values must precede the error
+  if (CalcExp->type() == ast::CalcOp::DIV && !Rhs)
+    reportDivisionByZero(CalcExp->location());
+  return createWrapperRef(performArithmeticOperation(CalcExp->type(), Lhs, Rhs,
+                                                     CalcExp->location()));
 }
 
 ResultTy Interpreter::visit(ast::un_operator *UnOp) {
-  auto *Value = acceptASTNode(UnOp->arg()).getAs<IntegerVal>();
-  auto *Type = Value->getType();
-  assert(Type->isInt32Ty());
-
-  return performUnaryOperation(UnOp->type(), Value, Type);
+  auto Value = acceptASTNode(UnOp->arg()).getInt();
+  return createWrapperRef(performUnaryOperation(UnOp->type(), Value));
 }
 
 ResultTy Interpreter::visit(ast::logic_expression *LogExp) {
-  auto *Lhs = acceptASTNode(LogExp->left()).getAs<IntegerVal>();
-  auto *Type = Lhs->getType();
-  assert(Type->isInt32Ty());
-  assert(Lhs);
-  if (LogExp->type() == ast::LogicOp::AND && !*Lhs)
-    return createWrapperRef(ValManager.createValue<IntegerVal>(0, Type));
-  if (LogExp->type() == ast::LogicOp::OR && *Lhs)
-    return createWrapperRef(ValManager.createValue<IntegerVal>(1, Type));
-  auto *Rhs = acceptASTNode(LogExp->right()).getAs<IntegerVal>();
-  return performLogicalOperation(LogExp->type(), Lhs, Rhs, Type);
+  if (LogExp->is_element_wise())
+    return createWrapperRef(evaluateElementWise(LogExp));
+  auto Lhs = acceptASTNode(LogExp->left()).getInt();
+  if (LogExp->type() == ast::LogicOp::AND && !Lhs)
+    return createWrapperRef(0);
+  if (LogExp->type() == ast::LogicOp::OR && Lhs)
+    return createWrapperRef(1);
+  auto Rhs = acceptASTNode(LogExp->right()).getInt();
+  return createWrapperRef(performLogicalOperation(LogExp->type(), Lhs, Rhs));
 }
 
 ResultTy Interpreter::visit(ast::number *Num) {
-  return createWrapperRef(ValManager.createValue<IntegerVal>(
-      Num->get_value(), SymTbl.createType<TypeID::Int32>()));
+  return createWrapperRef(Num->get_value());
 }
 
 ResultTy Interpreter::visit(ast::variable *Var) {
-  auto EntityKey = Var->entityKey();
-  [[maybe_unused]] auto *Ty = SymTbl.getTypeFor(EntityKey);
-  assert(Ty);
-  return createWrapperRef(
-      ValManager.getValueFor(SymTbl.getDeclKeyFor(EntityKey)));
+  auto Value = getSlotValue(Var->slot());
+  assert(!Value.isNull());
+  return createWrapperRef(Value);
 }
 
 ResultTy Interpreter::visit(ast::if_operator *If) {
-  auto *CondVal = acceptASTNode(If->condition()).getAs<IntegerVal>();
-  if (CondVal->getValue())
+  if (acceptASTNode(If->condition()).getInt())
     return acceptASTNode(If->body());
   if (If->else_block())
     return acceptASTNode(If->else_block());
@@ -179,62 +226,105 @@ ResultTy Interpreter::visit(ast::if_operator *If) {
 }
 
 ResultTy Interpreter::visit(ast::while_operator *While) {
-  auto *CondVal = acceptASTNode(While->condition()).getAs<IntegerVal>();
-  assert(CondVal);
-  while (CondVal->getValue()) {
+  if (!LoopCompiler) {
+    for (;;) {
+      auto Mark = markWrappers();
+      if (!acceptASTNode(While->condition()).getInt())
+        break;
+      acceptASTNode(While->body());
+      releaseWrappers(Mark);
+    }
+    return createWrapperRef();
+  }
+
+  auto Backedges = BackedgeCounters.lookup(While);
+  bool IsCompiled =
+      Backedges >= HotLoopThreshold && tryEnterCompiledLoop(While);
+  while (!IsCompiled) {
+    auto Mark = markWrappers();
+    if (!acceptASTNode(While->condition()).getInt())
+      break;
     acceptASTNode(While->body());
-    CondVal = acceptASTNode(While->condition()).getAs<IntegerVal>();
+    releaseWrappers(Mark);
+    IsCompiled = ++Backedges == HotLoopThreshold && tryEnterCompiledLoop(While);
+  }
+  BackedgeCounters[While] = Backedges;
+  return createWrapperRef();
+}
+
+ResultTy Interpreter::visit(ast::pfor_operator *PFor) {
+  int32_t Begin = acceptASTNode(PFor->init()).getInt();
+  int32_t End = acceptASTNode(PFor->limit()).getInt();
+  if (Begin >= End)
+    return createWrapperRef();
+
+  auto &Pool = runtime::ThreadPool::get();
+  // The rows shared by the copies of the arrays would be copied on the write
+  // by several workers at once
+  if (IsWorker || Pool.getNumWorkers() == 1 || PFor->copies_shared_arrays()) {
+    for (auto Iteration = Begin; Iteration < End; ++Iteration)
+      runIteration(PFor, Iteration);
+    return createWrapperRef();
   }
+
+  for (auto Slot : PFor->shared_arrays())
+    getSlotValue(Slot).getArray()->makeRowsUnique();
+  Workers.resize(Pool.getNumWorkers());
+  auto Depth = PFor->body()->depth();
+  auto RunRange = [&](unsigned WorkerID, int64_t From, int64_t To) {
+    auto &Worker = Workers[WorkerID];
+    if (!Worker)
+      Worker.reset(new Interpreter(*this));
+    Worker->ActiveFrames.assign(ActiveFrames.begin(),
+                                ActiveFrames.begin() + Depth);
+    for (auto Iteration = From; Iteration < To; ++Iteration)
+      Worker->runIteration(PFor, Iteration);
+  };
+  Pool.parallelFor(Begin, End, RunRange);
   return createWrapperRef();
 }
 
 ResultTy Interpreter::visit(ast::read_expression *ReadExp) {
-  int Tmp = 0;
-  input_stream_ >> Tmp;
-  if (input_stream_.fail()) {
+  int32_t Tmp = 0;
+  output_.flushBeforeInput();
+  if (!input_.readInt(Tmp)) {
+    output_.flush();
     std::ostringstream LocationStr;
     LocationStr << ReadExp->location();
     paracl::fatal(llvm::formatv("{0}: Non-integer data was transmitted",
                                 LocationStr.str()));
   }
 
-  return createWrapperRef(ValManager.createValue<IntegerVal>(
-      Tmp, SymTbl.createType<TypeID::Int32>()));
+  return createWrapperRef(Tmp);
 }
 
 ResultTy Interpreter::visit(ast::print_function *Print) {
-  auto *Val = acceptASTNode(Print->get()).get();
-  assert(Val);
-  Val->print(output_stream_);
+  auto Val = acceptASTNode(Print->get()).get();
+  assert(!Val.isNull());
+  Val.print(output_);
   return createWrapperRef(Val);
 }
 
-ResultTy Interpreter::visit(ast::assignment *Assign) {
-  auto *IdentExp = acceptASTNode(Assign->getIdentExp()).get();
-  assert(IdentExp);
-  auto *IdentType = IdentExp->getType();
-  auto EntityKey = Assign->entityKey();
-  if (!SymTbl.isDefined(EntityKey)) {
-    [[maybe_unused]] auto IsDefined =
-        SymTbl.tryDefine(EntityKey, IdentExp->getType());
-    assert(IsDefined);
-    auto DeclKey = SymTbl.getDeclKeyFor(EntityKey);
-    if (IdentType->isArrayTy()) {
-      // Since the array is assigned only during its creation, no copies are
-      // made; instead, the created array is immediately bound to the name
-      ValManager.linkValueWithName(DeclKey, IdentExp);
-      return createWrapperRef(IdentExp);
-    }
-    if (IdentType->isInt32Ty())
-      return createWrapperRef(ValManager.createValueFor<IntegerVal>(
-          DeclKey, static_cast<IntegerVal *>(IdentExp)->getValue(),
-          SymTbl.createType<TypeID::Int32>()));
-    return createWrapperRef();
+ResultTy Interpreter::visit(ast::reduce_function *Reduce) {
+  auto *Arr = acceptASTNode(Reduce->array()).get().getArray();
+  if (Reduce->type() != ast::ReduceOp::DOT) {
+    auto *Operand = Reduce->operand();
+    auto Val = Operand ? acceptASTNode(Operand).getInt() : 0;
+    return createWrapperRef(reduceArray(Reduce->type(), *Arr, Val));
   }
-  auto *Value =
-      ValManager.getValueFor<IntegerVal>(SymTbl.getDeclKeyFor(EntityKey));
-  assert(Value);
-  Value->setValue(static_cast<IntegerVal *>(IdentExp));
+  auto *Other = acceptASTNode(Reduce->operand()).get().getArray();
+  if (Arr->getSize() != Other->getSize())
+    reportSizeMismatch(Reduce, Arr->getSize(), Other->getSize());
+  return createWrapperRef(dotArrays(*Arr, *Other));
+}
+
+ResultTy Interpreter::visit(ast::assignment *Assign) {
+  auto IdentExp = acceptASTNode(Assign->getIdentExp()).get();
+  assert(!IdentExp.isNull());
+  // Integers are copied to the slot. Since the array is assigned only during
+  // its creation, no copies are made; instead, the created array is
+  // immediately bound to the name
+  getSlotValue(Assign->slot()) = IdentExp;
   return createWrapperRef(IdentExp);
 }
 
@@ -245,80 +335,169 @@ ResultTy Interpreter::visit(ast::ArrayHolder *ArrStore) {
 }
 
 ResultTy Interpreter::visit(ast::PresetArray *PresetArr) {
-  llvm::SmallVector<PCLValue *> PresetValues;
+  llvm::SmallVector<TaggedValue> PresetValues;
   PresetValues.reserve(PresetArr->size());
-  for (auto *CurrExp : *PresetArr) {
+  for (auto *CurrExp : *PresetArr)
     PresetValues.push_back(acceptASTNode(CurrExp).get());
-  }
 
-  auto *ArrVal = ValManager.createValue<PresetArrayVal>(
-      PresetValues.begin(), PresetValues.end(),
-      SymTbl.createType<TypeID::PresetArray>());
-  addResourceForFree(ArrVal, PresetArr->scope());
+  auto *ArrTy = SymTbl.getArrayTy(TypeID::PresetArray, SymTbl.getInt32Ty());
+  auto *ArrVal = ValManager.createValue<PresetArrayVal>(PresetValues, ArrTy);
   return createWrapperRef(ArrVal);
 }
 
 ResultTy Interpreter::visit(ast::ArrayAccess *ArrAccess) {
-  auto AccessSize = ArrAccess->getSize();
-  auto *CurrArr = ValManager.getValueFor<ArrayBase>(
-      SymTbl.getDeclKeyFor(ArrAccess->entityKey()));
-  assert(CurrArr);
-  int CurrID = 0;
-  for (unsigned ArrID = 1; auto RankID : *ArrAccess) {
-    auto *RankVal = acceptASTNode(RankID).getAs<IntegerVal>();
-    assert(RankVal);
-    CurrID = RankVal->getValue();
-    if (ArrID != AccessSize)
-      CurrArr = static_cast<ArrayBase *>((*CurrArr)[CurrID]);
-    ArrID++;
-  }
-  assert(CurrArr);
-  return createWrapperRef((*CurrArr)[CurrID]);
+  llvm::SmallVector<unsigned, 4> Indices;
+  auto *Arr = evaluateArrayAccess(ArrAccess, Indices);
+  return createWrapperRef(Arr->load(Indices));
 }
 
 ResultTy Interpreter::visit(ast::UniformArray *UnifArr) {
-  auto *InitExpr = acceptASTNode(UnifArr->getInitExpr()).get();
-  auto *Size = acceptASTNode(UnifArr->getSize()).getAs<IntegerVal>();
-
-  assert(InitExpr && Size);
+  auto InitExpr = acceptASTNode(UnifArr->getInitExpr()).get();
+  auto Size = acceptASTNode(UnifArr->getSize()).getInt();
+
+  assert(!InitExpr.isNull());
+  // The runtime types don't keep the sizes, so the number of the types doesn't
+  // grow with the number of the evaluated arrays
+  PCLType *ContainedTy = SymTbl.getInt32Ty();
+  if (InitExpr.isArray())
+    ContainedTy = InitExpr.getArray()->getType();
   auto *ArrVal = ValManager.createValue<UniformArrayVal>(
-      InitExpr, *Size, SymTbl.createType<TypeID::UniformArray>());
-  addResourceForFree(ArrVal, UnifArr->scope());
+      InitExpr, Size, SymTbl.getArrayTy(TypeID::UniformArray, ContainedTy));
   return createWrapperRef(ArrVal);
 }
 
 ResultTy Interpreter::visit(ast::ArrayAccessAssignment *Arr) {
-  auto *LValue = acceptASTNode(Arr->getArrayAccess()).getAs<IntegerVal>();
-  auto *IdentExp = acceptASTNode(Arr->getIdentExp()).getAs<IntegerVal>();
+  llvm::SmallVector<unsigned, 4> Indices;
+  auto *LValueArr = evaluateArrayAccess(Arr->getArrayAccess(), Indices);
+  auto IdentExp = acceptASTNode(Arr->getIdentExp()).getInt();
 
-  assert(LValue && IdentExp);
-  LValue->setValue(IdentExp);
+  LValueArr->store(Indices) = IdentExp;
   return createWrapperRef(IdentExp);
 }
 
-void Interpreter::freeResources(ast::statement_block *StmBlock) {
-  assert(StmBlock);
-  if (ResourceHandleMap.contains(StmBlock))
-    llvm::for_each(ResourceHandleMap[StmBlock], [](auto *Val) {
-      assert(Val);
-      auto *Type = Val->getType();
-      assert(Type);
-      if (Type->isArrayTy()) {
-        static_cast<ArrayBase *>(Val)->destroy();
-      }
-    });
+bool Interpreter::tryEnterCompiledLoop(ast::while_operator *While) {
+  auto *Loop = LoopCompiler->getCompiledLoop(While);
+  if (!Loop)
+    return false;
+
+  llvm::SmallVector<int32_t, 16> LiveInValues;
+  for (auto Slot : Loop->LiveIns) {
+    // The variable may be bound to an array or not assigned yet
+    auto Value = getSlotValue(Slot);
+    if (!Value.isInt())
+      return false;
+    LiveInValues.push_back(Value.getInt());
+  }
+  Loop->Entry(LiveInValues.data());
+  for (auto [Slot, Value] : llvm::zip(Loop->LiveIns, LiveInValues))
+    getSlotValue(Slot) = Value;
+  return true;
+}
+
+void Interpreter::runIteration(ast::pfor_operator *PFor, int32_t Iteration) {
+  auto *Body = PFor->body();
+  auto &Frame = Frames[Body];
+  Frame.resize(Body->slots_num());
+  Frame[PFor->loop_variable()->slot().Index] = Iteration;
+  auto Mark = markWrappers();
+  visit(Body);
+  releaseWrappers(Mark);
+}
+
+ArrayBase *
+Interpreter::evaluateArrayAccess(ast::ArrayAccess *ArrAccess,
+                                 llvm::SmallVectorImpl<unsigned> &Indices) {
+  auto *Arr = getSlotValue(ArrAccess->slot()).getArray();
+  assert(Arr && Arr->getRank() == ArrAccess->getSize());
+  for (auto *RankID : *ArrAccess) {
+    auto Index = acceptASTNode(RankID).getInt();
+    // The negative indexes are huge unsigned ones
+    auto Dim = Indices.size();
+    if (ArrAccess->needsBoundsCheck(Dim) &&
+        static_cast<unsigned>(Index) >= Arr->getShape()[Dim])
+      reportIndexOutOfRange(ArrAccess, Index, Arr->getShape()[Dim]);
+    Indices.push_back(Index);
+  }
+  return Arr;
+}
+
+void Interpreter::reportDivisionByZero(yy::location Loc) {
+  std::ostringstream Str;
+  Str << Loc;
+  paracl::fatalRuntimeError(
+      output_, llvm::formatv("{0}, trying to divide by 0", Str.str()));
+}
+
+void Interpreter::reportIndexOutOfRange(ast::ArrayAccess *ArrAccess, int Index,
+                                        unsigned Size) {
+  std::ostringstream LocationStr;
+  LocationStr << ArrAccess->location().begin;
+  paracl::fatalRuntimeError(
+      output_, llvm::formatv("{0}: array index {1} is out of range [0, {2})",
+                             LocationStr.str(), Index, Size));
+}
+
+ArrayBase *Interpreter::evaluateElementWise(ast::expression *Exp) {
+  std::vector<runtime::ElementStep> Steps;
+  std::vector<ast::expression *> Nodes;
+  ast::flatten_element_wise(Exp, Steps, Nodes);
+
+  llvm::SmallVector<TaggedValue, 4> Operands;
+  ArrayBase *Shaped = nullptr;
+  for (auto [Step, Node] : llvm::zip(Steps, Nodes)) {
+    if (!Step.IsOperand)
+      continue;
+    auto Value = acceptASTNode(Node).get();
+    Operands.push_back(Value);
+    if (!Value.isArray())
+      continue;
+    if (!Shaped)
+      Shaped = Value.getArray();
+    else if (Shaped->getShape() != Value.getArray()->getShape())
+      reportShapeMismatch(Exp, *Shaped, *Value.getArray());
+  }
+  assert(Shaped);
+
+  auto *ArrVal = ValManager.createValue<ElementWiseArrayVal>(
+      Shaped->getShape(), Shaped->getType());
+  runtime::ElementWiseKernel Kernel(Steps);
+  if (auto StepID = ArrVal->compute(Kernel, Operands))
+    reportDivisionByZero(Nodes[*StepID]->location());
+  return ArrVal;
+}
+
+void Interpreter::reportSizeMismatch(ast::reduce_function *Reduce,
+                                     unsigned LhsSize, unsigned RhsSize) {
+  std::ostringstream LocationStr;
+  LocationStr << Reduce->location().begin;
+  paracl::fatalRuntimeError(
+      output_, llvm::formatv("{0}: dot of the arrays of the different sizes "
+                             "{1} and {2}",
+                             LocationStr.str(), LhsSize, RhsSize));
+}
+
+void Interpreter::reportShapeMismatch(ast::expression *Exp,
+                                      const ArrayBase &Lhs,
+                                      const ArrayBase &Rhs) {
+  auto [LhsSize, RhsSize] =
+      *llvm::find_if(llvm::zip(Lhs.getShape(), Rhs.getShape()), [](auto Dims) {
+        return std::get<0>(Dims) != std::get<1>(Dims);
+      });
+  std::ostringstream LocationStr;
+  LocationStr << Exp->location().begin;
+  paracl::fatalRuntimeError(
+      output_, llvm::formatv("{0}: element-wise operation on the arrays of "
+                             "the different sizes {1} and {2}",
+                             LocationStr.str(), LhsSize, RhsSize));
 }
 
 ResultTy InterpreterBase::acceptStatementBlock(ast::statement_block *StmBlock) {
-  for (auto &&statement : *StmBlock)
+  for (auto &&statement : *StmBlock) {
+    auto Mark = markWrappers();
     acceptASTNode(statement);
+    releaseWrappers(Mark);
+  }
   return createWrapperRef();
 }
 
-void Interpreter::addResourceForFree(PCLValue *ValToFree,
-                                     ast::statement_block *ScopeToFree) {
-  assert(ScopeToFree);
-  ResourceHandleMap[ScopeToFree].push_back(ValToFree);
-}
-
 } // namespace paracl
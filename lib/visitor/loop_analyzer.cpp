@@ -0,0 +1,120 @@
+#include "ast_includes.hpp"
+#include "loop_analyzer.hpp"
+
+namespace paracl {
+
+using ResultTy = LoopAnalyzer::ResultTy;
+
+bool LoopAnalyzer::run(ast::while_operator *While) {
+  // The variables assigned in the body that isn't a block are declared in the
+  // enclosing scope, so they are live-in as well
+  LoopBody = dynamic_cast<ast::statement_block *>(While->body());
+  IsCompilable = true;
+  LiveIns.clear();
+  Visited.clear();
+  acceptASTNode(While);
+  return IsCompilable;
+}
+
+ResultTy LoopAnalyzer::visit(ast::root_statement_block *StmBlock) {
+  return visit(static_cast<ast::statement_block *>(StmBlock));
+}
+
+ResultTy LoopAnalyzer::visit(ast::statement_block *StmBlock) {
+  for (auto *CurStatement : *StmBlock) {
+    auto Mark = markWrappers();
+    acceptASTNode(CurStatement);
+    releaseWrappers(Mark);
+  }
+  return createWrapperRef();
+}
+
+ResultTy LoopAnalyzer::visit(ast::calc_expression *CalcExp) {
+  if (CalcExp->is_element_wise())
+    return rejectLoop();
+  acceptASTNode(CalcExp->left());
+  acceptASTNode(CalcExp->right());
+  return createWrapperRef();
+}
+
+ResultTy LoopAnalyzer::visit(ast::logic_expression *LogExp) {
+  if (LogExp->is_element_wise())
+    return rejectLoop();
+  acceptASTNode(LogExp->left());
+  acceptASTNode(LogExp->right());
+  return createWrapperRef();
+}
+
+ResultTy LoopAnalyzer::visit(ast::un_operator *UnOp) {
+  acceptASTNode(UnOp->arg());
+  return createWrapperRef();
+}
+
+ResultTy LoopAnalyzer::visit(ast::number *) { return createWrapperRef(); }
+
+ResultTy LoopAnalyzer::visit(ast::variable *Var) {
+  addIfLiveIn(Var);
+  return createWrapperRef();
+}
+
+ResultTy LoopAnalyzer::visit(ast::assignment *Assign) {
+  acceptASTNode(Assign->getIdentExp());
+  addIfLiveIn(Assign->getLValue());
+  return createWrapperRef();
+}
+
+ResultTy LoopAnalyzer::visit(ast::if_operator *If) {
+  acceptASTNode(If->condition());
+  acceptASTNode(If->body());
+  if (auto *ElseBlock = If->else_block())
+    acceptASTNode(ElseBlock);
+  return createWrapperRef();
+}
+
+ResultTy LoopAnalyzer::visit(ast::while_operator *While) {
+  acceptASTNode(While->condition());
+  acceptASTNode(While->body());
+  return createWrapperRef();
+}
+
+ResultTy LoopAnalyzer::visit(ast::pfor_operator *) { return rejectLoop(); }
+
+ResultTy LoopAnalyzer::visit(ast::read_expression *) {
+  return createWrapperRef();
+}
+
+ResultTy LoopAnalyzer::visit(ast::print_function *Print) {
+  acceptASTNode(Print->get());
+  return createWrapperRef();
+}
+
+ResultTy LoopAnalyzer::visit(ast::reduce_function *) { return rejectLoop(); }
+
+ResultTy LoopAnalyzer::visit(ast::ArrayHolder *) { return rejectLoop(); }
+
+ResultTy LoopAnalyzer::visit(ast::PresetArray *) { return rejectLoop(); }
+
+ResultTy LoopAnalyzer::visit(ast::UniformArray *) { return rejectLoop(); }
+
+ResultTy LoopAnalyzer::visit(ast::ArrayAccess *) { return rejectLoop(); }
+
+ResultTy LoopAnalyzer::visit(ast::ArrayAccessAssignment *) {
+  return rejectLoop();
+}
+
+void LoopAnalyzer::addIfLiveIn(ast::variable *Var) {
+  auto Slot = Var->slot();
+  assert(Slot.isValid());
+  auto *DeclScope = Var->scope();
+  while (DeclScope->depth() != Slot.Depth)
+    DeclScope = DeclScope->scope();
+  for (auto *Scope = DeclScope; Scope; Scope = Scope->scope())
+    if (Scope == LoopBody)
+      return;
+
+  SymTabKey DeclKey{Var->name(), DeclScope};
+  if (Visited.insert(DeclKey).second)
+    LiveIns.push_back({std::move(DeclKey), Slot});
+}
+
+} // namespace paracl
@@ -0,0 +1,633 @@
+#include <llvm/ADT/STLExtras.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "ast_includes.hpp"
+#include "range_analyzer.hpp"
+
+namespace paracl {
+
+using ResultTy = RangeAnalyzer::ResultTy;
+using ValueKind = RangeInfo::ValueKind;
+
+namespace {
+
+// The number of the loop iterations analyzed before the widening, so the
+// ranges that become stable quickly stay precise
+constexpr unsigned WideningDelay = 2;
+
+// The result of an operation that overflows int32_t wraps around, so it can
+// have any value
+ValueRange makeRange(int64_t Lo, int64_t Hi) {
+  if (Lo < ValueRange::Min || Hi > ValueRange::Max)
+    return {};
+  return {Lo, Hi};
+}
+
+ValueRange joinRanges(const ValueRange &Lhs, const ValueRange &Rhs) {
+  return {std::min(Lhs.Lo, Rhs.Lo), std::max(Lhs.Hi, Rhs.Hi)};
+}
+
+ValueRange widenRange(const ValueRange &Prev, const ValueRange &Next) {
+  return {Next.Lo < Prev.Lo ? ValueRange::Min : Prev.Lo,
+          Next.Hi > Prev.Hi ? ValueRange::Max : Prev.Hi};
+}
+
+bool containsZero(const ValueRange &Range) {
+  return Range.Lo <= 0 && Range.Hi >= 0;
+}
+
+ValueRange computeArithmetic(ast::CalcOp Op, const ValueRange &Lhs,
+                             const ValueRange &Rhs) {
+  switch (Op) {
+  case ast::CalcOp::ADD:
+    return makeRange(Lhs.Lo + Rhs.Lo, Lhs.Hi + Rhs.Hi);
+  case ast::CalcOp::SUB:
+    return makeRange(Lhs.Lo - Rhs.Hi, Lhs.Hi - Rhs.Lo);
+  case ast::CalcOp::MUL:
+  case ast::CalcOp::DIV: {
+    // Both operations are monotonic in every operand if the divisor doesn't
+    // change its sign, so the bounds are reached at the corners
+    if (Op == ast::CalcOp::DIV && containsZero(Rhs))
+      return {};
+    auto Compute = [Op](int64_t L, int64_t R) {
+      return Op == ast::CalcOp::MUL ? L * R : L / R;
+    };
+    int64_t Corners[] = {Compute(Lhs.Lo, Rhs.Lo), Compute(Lhs.Lo, Rhs.Hi),
+                         Compute(Lhs.Hi, Rhs.Lo), Compute(Lhs.Hi, Rhs.Hi)};
+    auto [Lo, Hi] =
+        std::minmax_element(std::begin(Corners), std::end(Corners));
+    return makeRange(*Lo, *Hi);
+  }
+  case ast::CalcOp::PERCENT: {
+    if (containsZero(Rhs))
+      return {};
+    // The remainder has the sign of the dividend and is less than the divisor
+    // by the absolute value
+    auto MaxRem = std::max(std::abs(Rhs.Lo), std::abs(Rhs.Hi)) - 1;
+    return {Lhs.Lo < 0 ? std::max(-MaxRem, Lhs.Lo) : 0,
+            Lhs.Hi > 0 ? std::min(MaxRem, Lhs.Hi) : 0};
+  }
+  default:
+    llvm_unreachable("Unsupported calculation operator");
+  }
+}
+
+ast::LogicOp negateComparison(ast::LogicOp Op) {
+  switch (Op) {
+  case ast::LogicOp::LESS:
+    return ast::LogicOp::GREATER_EQ;
+  case ast::LogicOp::LESS_EQ:
+    return ast::LogicOp::GREATER;
+  case ast::LogicOp::GREATER:
+    return ast::LogicOp::LESS_EQ;
+  case ast::LogicOp::GREATER_EQ:
+    return ast::LogicOp::LESS;
+  case ast::LogicOp::EQ:
+    return ast::LogicOp::NEQ;
+  case ast::LogicOp::NEQ:
+    return ast::LogicOp::EQ;
+  default:
+    llvm_unreachable("Unsupported comparison operator");
+  }
+}
+
+// Removes the variables from the relations and the array sizes
+void forgetVariable(RangeInfo &Info, SlotKey Var) {
+  Info.LessThan.erase(std::remove(Info.LessThan.begin(), Info.LessThan.end(),
+                                  Var),
+                      Info.LessThan.end());
+  for (auto &Dim : Info.Dims)
+    if (Dim.SizeVar == Var)
+      Dim.SizeVar.reset();
+}
+
+template <typename RangeFunc>
+RangeInfo mergeInfos(const RangeInfo &Lhs, const RangeInfo &Rhs,
+                     RangeFunc MergeRanges) {
+  RangeInfo Merged;
+  Merged.Kind = Lhs.Kind == Rhs.Kind ? Lhs.Kind : ValueKind::Unknown;
+  Merged.Range = MergeRanges(Lhs.Range, Rhs.Range);
+  for (auto Var : Lhs.LessThan)
+    if (llvm::is_contained(Rhs.LessThan, Var))
+      Merged.LessThan.push_back(Var);
+  if (Lhs.Dims.size() != Rhs.Dims.size())
+    return Merged;
+  for (auto [LhsDim, RhsDim] : llvm::zip(Lhs.Dims, Rhs.Dims)) {
+    auto &Dim = Merged.Dims.emplace_back();
+    Dim.Size = MergeRanges(LhsDim.Size, RhsDim.Size);
+    if (LhsDim.SizeVar == RhsDim.SizeVar)
+      Dim.SizeVar = LhsDim.SizeVar;
+  }
+  return Merged;
+}
+
+// Returns the plain variable (not an array access) compared by the condition
+ast::variable *getComparedVariable(ast::expression *Exp) {
+  if (dynamic_cast<ast::ArrayAccess *>(Exp))
+    return nullptr;
+  return dynamic_cast<ast::variable *>(Exp);
+}
+
+} // namespace
+
+bool RangeAnalyzer::State::operator==(const State &Other) const {
+  if (IsReachable != Other.IsReachable)
+    return false;
+  if (!IsReachable)
+    return true;
+  if (Vars.size() != Other.Vars.size())
+    return false;
+  return llvm::all_of(Vars, [&Other](auto &Entry) {
+    auto Found = Other.Vars.find(Entry.first);
+    return Found != Other.Vars.end() && Found->second == Entry.second;
+  });
+}
+
+RangeAnalyzer::State RangeAnalyzer::join(const State &Lhs, const State &Rhs) {
+  if (!Lhs.IsReachable)
+    return Rhs;
+  if (!Rhs.IsReachable)
+    return Lhs;
+  State Joined;
+  for (auto &[Var, LhsInfo] : Lhs.Vars)
+    if (auto Found = Rhs.Vars.find(Var); Found != Rhs.Vars.end())
+      Joined.Vars.try_emplace(Var,
+                              mergeInfos(LhsInfo, Found->second, joinRanges));
+  return Joined;
+}
+
+RangeAnalyzer::State RangeAnalyzer::widen(const State &Prev,
+                                          const State &Next) {
+  if (!Prev.IsReachable || !Next.IsReachable)
+    return Next;
+  State Widened;
+  for (auto &[Var, NextInfo] : Next.Vars) {
+    auto Found = Prev.Vars.find(Var);
+    Widened.Vars.try_emplace(
+        Var, Found == Prev.Vars.end()
+                 ? NextInfo
+                 : mergeInfos(Found->second, NextInfo, widenRange));
+  }
+  return Widened;
+}
+
+void RangeAnalyzer::run(ast::root_statement_block *RootBlock) {
+  Current = State();
+  AssignStamp = 0;
+  ComparedValues.clear();
+  Accesses.clear();
+  acceptASTNode(RootBlock);
+
+  // The accesses in the code found unreachable keep all their checks
+  for (auto &[ArrAccess, Access] : Accesses)
+    for (unsigned Dim = 0; Dim < ArrAccess->getSize(); ++Dim)
+      if (!Access.IsReached || Access.MayBeOutOfBounds.test(Dim))
+        ArrAccess->setBoundsCheck(Dim);
+}
+
+ResultTy RangeAnalyzer::visit(ast::root_statement_block *StmBlock) {
+  return visit(static_cast<ast::statement_block *>(StmBlock));
+}
+
+ResultTy RangeAnalyzer::visit(ast::statement_block *StmBlock) {
+  for (auto *CurStatement : *StmBlock) {
+    auto Mark = markWrappers();
+    acceptASTNode(CurStatement);
+    releaseWrappers(Mark);
+  }
+  return createWrapperRef();
+}
+
+ResultTy RangeAnalyzer::visit(ast::calc_expression *CalcExp) {
+  auto Stamp = AssignStamp;
+  RangeWrapper Lhs = acceptASTNode(CalcExp->left());
+  RangeWrapper Rhs = acceptASTNode(CalcExp->right());
+  if (CalcExp->is_element_wise())
+    return createElementWiseRef(Lhs, Rhs, Stamp);
+  auto &LhsRange = Lhs.Info.Range;
+  auto &RhsRange = Rhs.Info.Range;
+  auto Info = RangeInfo::getInteger(
+      computeArithmetic(CalcExp->type(), LhsRange, RhsRange));
+
+  // The result that doesn't exceed an operand keeps its relations, e.g.
+  // a[i - 1] is in bounds if i < n
+  const RangeWrapper *NotGreaterThan = nullptr;
+  switch (CalcExp->type()) {
+  case ast::CalcOp::ADD:
+    if (RhsRange.Hi <= 0)
+      NotGreaterThan = &Lhs;
+    else if (LhsRange.Hi <= 0)
+      NotGreaterThan = &Rhs;
+    break;
+  case ast::CalcOp::SUB:
+    if (RhsRange.Lo >= 0)
+      NotGreaterThan = &Lhs;
+    break;
+  case ast::CalcOp::DIV:
+  case ast::CalcOp::PERCENT:
+    if (LhsRange.Lo >= 0 && RhsRange.Lo > 0)
+      NotGreaterThan = &Lhs;
+    break;
+  default:
+    break;
+  }
+  // The overflow may wrap the result around
+  if (!NotGreaterThan || Info.Range == ValueRange())
+    return createWrapperRef(std::move(Info));
+  Info.LessThan = NotGreaterThan->Info.LessThan;
+  return createWrapperRef(std::move(Info), std::nullopt,
+                          NotGreaterThan->ReadStamp);
+}
+
+ResultTy RangeAnalyzer::visit(ast::logic_expression *LogExp) {
+  auto Stamp = AssignStamp;
+  RangeWrapper Lhs = acceptASTNode(LogExp->left());
+  RangeWrapper Rhs;
+  if (LogExp->type() == ast::LogicOp::AND ||
+      LogExp->type() == ast::LogicOp::OR) {
+    // The right operand may be skipped
+    auto AfterLhs = Current;
+    Rhs = acceptASTNode(LogExp->right());
+    Current = join(AfterLhs, Current);
+  } else {
+    Rhs = acceptASTNode(LogExp->right());
+  }
+  if (LogExp->is_element_wise())
+    return createElementWiseRef(Lhs, Rhs, Stamp);
+  ComparedValues.insert_or_assign(LogExp, std::make_pair(Lhs, Rhs));
+  return createWrapperRef(RangeInfo::getInteger({0, 1}));
+}
+
+ResultTy RangeAnalyzer::createElementWiseRef(const RangeWrapper &Lhs,
+                                             const RangeWrapper &Rhs,
+                                             unsigned Stamp) {
+  // The array operands have the same shape, the elements aren't tracked
+  auto &Operand = Lhs.Info.Kind == ValueKind::Array ? Lhs : Rhs;
+  auto Info = RangeInfo::getArray();
+  Info.Dims = Operand.Info.Dims;
+  // The sizes might be reassigned by the integer operands
+  if (Stamp != AssignStamp)
+    for (auto &Dim : Info.Dims)
+      Dim.SizeVar.reset();
+  return createWrapperRef(std::move(Info));
+}
+
+ResultTy RangeAnalyzer::visit(ast::un_operator *UnOp) {
+  auto Range = acceptASTNode(UnOp->arg()).Info.Range;
+  switch (UnOp->type()) {
+  case ast::UnOp::PLUS:
+    break;
+  case ast::UnOp::MINUS:
+    Range = makeRange(-Range.Hi, -Range.Lo);
+    break;
+  case ast::UnOp::NEGATE:
+    if (!containsZero(Range))
+      Range = ValueRange::getConstant(0);
+    else if (Range == ValueRange::getConstant(0))
+      Range = ValueRange::getConstant(1);
+    else
+      Range = {0, 1};
+    break;
+  default:
+    llvm_unreachable("Unsupported unary operator");
+  }
+  return createWrapperRef(RangeInfo::getInteger(Range));
+}
+
+ResultTy RangeAnalyzer::visit(ast::number *Num) {
+  return createWrapperRef(
+      RangeInfo::getInteger(ValueRange::getConstant(Num->get_value())));
+}
+
+ResultTy RangeAnalyzer::visit(ast::variable *Var) {
+  auto Key = getKey(Var->slot());
+  auto Found = Current.Vars.find(Key);
+  return createWrapperRef(
+      Found != Current.Vars.end() ? Found->second : RangeInfo(), Key,
+      AssignStamp);
+}
+
+ResultTy RangeAnalyzer::visit(ast::assignment *Assign) {
+  RangeWrapper Value = acceptASTNode(Assign->getIdentExp());
+  // The relations of the value hold for the variable only if nothing was
+  // assigned after they were read
+  if (Value.ReadStamp != AssignStamp)
+    Value.Info.LessThan.clear();
+  assignVariable(getKey(Assign->slot()), Value.Info);
+  Value.Info.LessThan.clear();
+  return createWrapperRef(std::move(Value.Info));
+}
+
+ResultTy RangeAnalyzer::visit(ast::if_operator *If) {
+  auto *Cond = If->condition();
+  auto Stamp = AssignStamp;
+  RangeWrapper CondValue = acceptASTNode(Cond);
+  bool CanNarrow = Stamp == AssignStamp;
+
+  auto AfterCond = Current;
+  enterBranch(Cond, CondValue, CanNarrow, /* Truth */ true);
+  acceptASTNode(If->body());
+  auto AfterBody = std::move(Current);
+
+  Current = std::move(AfterCond);
+  enterBranch(Cond, CondValue, CanNarrow, /* Truth */ false);
+  if (auto *ElseBlock = If->else_block())
+    acceptASTNode(ElseBlock);
+  Current = join(AfterBody, Current);
+  return createWrapperRef();
+}
+
+ResultTy RangeAnalyzer::visit(ast::while_operator *While) {
+  auto *Cond = While->condition();
+  auto Head = Current;
+  for (unsigned Iteration = 0;; ++Iteration) {
+    Current = Head;
+    auto Mark = markWrappers();
+    auto Stamp = AssignStamp;
+    RangeWrapper CondValue = acceptASTNode(Cond);
+    bool CanNarrow = Stamp == AssignStamp;
+
+    auto AfterCond = Current;
+    enterBranch(Cond, CondValue, CanNarrow, /* Truth */ true);
+    acceptASTNode(While->body());
+    releaseWrappers(Mark);
+
+    auto Next = join(Head, Current);
+    if (Iteration >= WideningDelay)
+      Next = widen(Head, Next);
+    if (Next == Head) {
+      Current = std::move(AfterCond);
+      enterBranch(Cond, CondValue, CanNarrow, /* Truth */ false);
+      break;
+    }
+    Head = std::move(Next);
+  }
+  return createWrapperRef();
+}
+
+ResultTy RangeAnalyzer::visit(ast::pfor_operator *PFor) {
+  RangeWrapper Init = acceptASTNode(PFor->init());
+  RangeWrapper Limit = acceptASTNode(PFor->limit());
+  bool IsLimitRead = Limit.ReadStamp == AssignStamp &&
+                     getComparedVariable(PFor->limit()) && Limit.Var;
+
+  // The iterations don't change the variables declared outside of the body,
+  // so one of them stands for all
+  auto Before = Current;
+  auto LoopVar = RangeInfo::getInteger({Init.Info.Range.Lo,
+                                        Limit.Info.Range.Hi - 1});
+  if (IsLimitRead)
+    LoopVar.LessThan.push_back(*Limit.Var);
+  if (LoopVar.Range.isEmpty())
+    Current.IsReachable = false;
+  assignVariable(getKey(PFor->loop_variable()->slot()), std::move(LoopVar));
+  acceptASTNode(PFor->body());
+  Current = join(Before, Current);
+  return createWrapperRef();
+}
+
+ResultTy RangeAnalyzer::visit(ast::read_expression *) {
+  return createWrapperRef(RangeInfo::getInteger({}));
+}
+
+ResultTy RangeAnalyzer::visit(ast::print_function *Print) {
+  RangeWrapper Value = acceptASTNode(Print->get());
+  return createWrapperRef(std::move(Value.Info));
+}
+
+ResultTy RangeAnalyzer::visit(ast::reduce_function *Reduce) {
+  acceptASTNode(Reduce->array());
+  if (auto *Operand = Reduce->operand())
+    acceptASTNode(Operand);
+  // The elements aren't tracked, and the sums wrap around
+  return createWrapperRef(RangeInfo::getInteger({}));
+}
+
+ResultTy RangeAnalyzer::visit(ast::ArrayHolder *ArrStore) {
+  return acceptASTNode(ArrStore->get());
+}
+
+ResultTy RangeAnalyzer::visit(ast::PresetArray *PresetArr) {
+  // The nested arrays are flattened into the elements of the array
+  int64_t MinSize = 0, MaxSize = 0;
+  for (auto *Elem : *PresetArr) {
+    auto &Info = acceptASTNode(Elem).Info;
+    int64_t ElemMin = 1, ElemMax = 1;
+    if (Info.Kind != ValueKind::Integer) {
+      ElemMin = 0;
+      ElemMax = Info.Dims.empty() ? ValueRange::Max : 1;
+      for (auto &Dim : Info.Dims) {
+        ElemMin *= Dim.Size.Lo;
+        ElemMax = std::min(ElemMax * Dim.Size.Hi, ValueRange::Max);
+      }
+    }
+    MinSize = std::min(MinSize + ElemMin, ValueRange::Max);
+    MaxSize = std::min(MaxSize + ElemMax, ValueRange::Max);
+  }
+  auto Info = RangeInfo::getArray();
+  Info.Dims.emplace_back().Size = {MinSize, MaxSize};
+  return createWrapperRef(std::move(Info));
+}
+
+ResultTy RangeAnalyzer::visit(ast::UniformArray *UnifArr) {
+  auto Stamp = AssignStamp;
+  RangeWrapper Init = acceptASTNode(UnifArr->getInitExpr());
+  RangeWrapper Size = acceptASTNode(UnifArr->getSize());
+
+  auto Info = RangeInfo::getArray();
+  // A negative size is converted to a huge unsigned one
+  auto &Dim = Info.Dims.emplace_back();
+  Dim.Size = {std::max<int64_t>(Size.Info.Range.Lo, 0),
+              Size.Info.Range.Lo < 0 ? ValueRange::Max : Size.Info.Range.Hi};
+  if (Size.Var && Size.ReadStamp == AssignStamp)
+    Dim.SizeVar = Size.Var;
+  if (Init.Info.Kind != ValueKind::Array)
+    return createWrapperRef(std::move(Info));
+  if (Init.Info.Dims.empty())
+    return createWrapperRef(RangeInfo::getArray());
+
+  // The sizes of the nested array might be reassigned by the size expression
+  for (auto &InitDim : Init.Info.Dims) {
+    Info.Dims.push_back(InitDim);
+    if (Stamp != AssignStamp)
+      Info.Dims.back().SizeVar.reset();
+  }
+  return createWrapperRef(std::move(Info));
+}
+
+ResultTy RangeAnalyzer::visit(ast::ArrayAccess *ArrAccess) {
+  llvm::SmallVector<RangeWrapper, 2> Indexes;
+  for (auto *Index : *ArrAccess)
+    Indexes.push_back(acceptASTNode(Index));
+  checkAccess(ArrAccess, Indexes);
+  return createWrapperRef(RangeInfo::getInteger({}));
+}
+
+ResultTy RangeAnalyzer::visit(ast::ArrayAccessAssignment *ArrAssign) {
+  acceptASTNode(ArrAssign->getArrayAccess());
+  RangeWrapper Value = acceptASTNode(ArrAssign->getIdentExp());
+  return createWrapperRef(RangeInfo::getInteger(Value.Info.Range));
+}
+
+void RangeAnalyzer::enterBranch(ast::expression *Cond,
+                                const RangeWrapper &CondValue, bool CanNarrow,
+                                bool Truth) {
+  auto &Range = CondValue.Info.Range;
+  if (Truth ? Range == ValueRange::getConstant(0) : !containsZero(Range))
+    Current.IsReachable = false;
+  else if (CanNarrow)
+    assumeCondition(Cond, Truth);
+}
+
+void RangeAnalyzer::assumeCondition(ast::expression *Cond, bool Truth) {
+  if (!Current.IsReachable)
+    return;
+
+  if (auto *UnOp = dynamic_cast<ast::un_operator *>(Cond)) {
+    if (UnOp->type() == ast::UnOp::NEGATE)
+      assumeCondition(UnOp->arg(), !Truth);
+    return;
+  }
+
+  if (auto *Var = getComparedVariable(Cond)) {
+    // A non-zero value doesn't narrow the range
+    if (!Truth) {
+      auto Zero = ValueRange::getConstant(0);
+      assumeLess(getKey(Var->slot()), Zero, std::nullopt, /* OrEqual */ true);
+      assumeGreater(getKey(Var->slot()), Zero, /* OrEqual */ true);
+    }
+    return;
+  }
+
+  auto *LogExp = dynamic_cast<ast::logic_expression *>(Cond);
+  if (!LogExp)
+    return;
+  auto Op = LogExp->type();
+  if (Op != ast::LogicOp::AND && Op != ast::LogicOp::OR) {
+    assumeComparison(LogExp, Truth ? Op : negateComparison(Op));
+    return;
+  }
+
+  // Both operands of a true conjunction (or a false disjunction) have the
+  // same truth, otherwise one of them is enough
+  if ((Op == ast::LogicOp::AND) == Truth) {
+    assumeCondition(LogExp->left(), Truth);
+    assumeCondition(LogExp->right(), Truth);
+    return;
+  }
+  auto Before = Current;
+  assumeCondition(LogExp->left(), Truth);
+  auto AfterLhs = std::move(Current);
+  Current = std::move(Before);
+  assumeCondition(LogExp->right(), Truth);
+  Current = join(AfterLhs, Current);
+}
+
+void RangeAnalyzer::assumeComparison(ast::logic_expression *LogExp,
+                                     ast::LogicOp Op) {
+  auto Found = ComparedValues.find(LogExp);
+  assert(Found != ComparedValues.end());
+  auto &[Lhs, Rhs] = Found->second;
+  // Only the plain variables are narrowed, not the values read from the
+  // arrays
+  std::optional<SlotKey> LhsVar, RhsVar;
+  if (getComparedVariable(LogExp->left()))
+    LhsVar = Lhs.Var;
+  if (getComparedVariable(LogExp->right()))
+    RhsVar = Rhs.Var;
+
+  switch (Op) {
+  case ast::LogicOp::LESS:
+    assumeLess(LhsVar, Rhs.Info.Range, RhsVar, /* OrEqual */ false);
+    assumeGreater(RhsVar, Lhs.Info.Range, /* OrEqual */ false);
+    break;
+  case ast::LogicOp::LESS_EQ:
+    assumeLess(LhsVar, Rhs.Info.Range, std::nullopt, /* OrEqual */ true);
+    assumeGreater(RhsVar, Lhs.Info.Range, /* OrEqual */ true);
+    break;
+  case ast::LogicOp::GREATER:
+    assumeGreater(LhsVar, Rhs.Info.Range, /* OrEqual */ false);
+    assumeLess(RhsVar, Lhs.Info.Range, LhsVar, /* OrEqual */ false);
+    break;
+  case ast::LogicOp::GREATER_EQ:
+    assumeGreater(LhsVar, Rhs.Info.Range, /* OrEqual */ true);
+    assumeLess(RhsVar, Lhs.Info.Range, std::nullopt, /* OrEqual */ true);
+    break;
+  case ast::LogicOp::EQ:
+    assumeLess(LhsVar, Rhs.Info.Range, std::nullopt, /* OrEqual */ true);
+    assumeGreater(LhsVar, Rhs.Info.Range, /* OrEqual */ true);
+    assumeLess(RhsVar, Lhs.Info.Range, std::nullopt, /* OrEqual */ true);
+    assumeGreater(RhsVar, Lhs.Info.Range, /* OrEqual */ true);
+    break;
+  case ast::LogicOp::NEQ:
+    break;
+  default:
+    llvm_unreachable("Unsupported comparison operator");
+  }
+}
+
+void RangeAnalyzer::assumeLess(std::optional<SlotKey> Var,
+                               const ValueRange &Bound,
+                               std::optional<SlotKey> BoundVar, bool OrEqual) {
+  if (!Var || !Current.IsReachable)
+    return;
+  auto &Info = Current.Vars[*Var];
+  Info.Range.Hi = std::min(Info.Range.Hi, Bound.Hi - !OrEqual);
+  if (BoundVar && BoundVar != Var &&
+      !llvm::is_contained(Info.LessThan, *BoundVar))
+    Info.LessThan.push_back(*BoundVar);
+  if (Info.Range.isEmpty())
+    Current.IsReachable = false;
+}
+
+void RangeAnalyzer::assumeGreater(std::optional<SlotKey> Var,
+                                  const ValueRange &Bound, bool OrEqual) {
+  if (!Var || !Current.IsReachable)
+    return;
+  auto &Info = Current.Vars[*Var];
+  Info.Range.Lo = std::max(Info.Range.Lo, Bound.Lo + !OrEqual);
+  if (Info.Range.isEmpty())
+    Current.IsReachable = false;
+}
+
+void RangeAnalyzer::assignVariable(SlotKey Var, RangeInfo Info) {
+  ++AssignStamp;
+  for (auto &Entry : Current.Vars)
+    forgetVariable(Entry.second, Var);
+  forgetVariable(Info, Var);
+  Current.Vars.insert_or_assign(Var, std::move(Info));
+}
+
+void RangeAnalyzer::checkAccess(ast::ArrayAccess *ArrAccess,
+                                llvm::ArrayRef<RangeWrapper> Indexes) {
+  auto &Access = Accesses[ArrAccess];
+  if (Access.MayBeOutOfBounds.empty())
+    Access.MayBeOutOfBounds.resize(ArrAccess->getSize());
+  if (!Current.IsReachable)
+    return;
+  Access.IsReached = true;
+
+  llvm::ArrayRef<DimensionInfo> Dims;
+  if (auto Found = Current.Vars.find(getKey(ArrAccess->slot()));
+      Found != Current.Vars.end() &&
+      Found->second.Dims.size() == Indexes.size())
+    Dims = Found->second.Dims;
+
+  for (unsigned Dim = 0; Dim < Indexes.size(); ++Dim) {
+    auto &Index = Indexes[Dim];
+    auto &Range = Index.Info.Range;
+    bool IsInBounds = false;
+    if (!Dims.empty() && Range.Lo >= 0) {
+      auto &DimInfo = Dims[Dim];
+      IsInBounds = Range.Hi < DimInfo.Size.Lo ||
+                   (DimInfo.SizeVar && Index.ReadStamp == AssignStamp &&
+                    llvm::is_contained(Index.Info.LessThan, *DimInfo.SizeVar));
+    }
+    if (!IsInBounds)
+      Access.MayBeOutOfBounds.set(Dim);
+  }
+}
+
+} // namespace paracl
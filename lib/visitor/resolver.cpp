@@ -0,0 +1,171 @@
+#include "ast_includes.hpp"
+#include "resolver.hpp"
+
+namespace paracl {
+
+using ResultTy = Resolver::ResultTy;
+
+ResultTy Resolver::visit(ast::root_statement_block *StmBlock) {
+  return visit(static_cast<ast::statement_block *>(StmBlock));
+}
+
+ResultTy Resolver::visit(ast::statement_block *StmBlock) {
+  // The depth is needed by the nested blocks before the number of the slots is
+  // known
+  auto Depth = CurrDepth++;
+  StmBlock->set_frame_layout(Depth, 0);
+  for (auto *CurStatement : *StmBlock) {
+    auto Mark = markWrappers();
+    acceptASTNode(CurStatement);
+    releaseWrappers(Mark);
+  }
+  StmBlock->set_frame_layout(Depth, SlotsNum.lookup(StmBlock));
+  --CurrDepth;
+  return createWrapperRef();
+}
+
+ResultTy Resolver::visit(ast::calc_expression *CalcExp) {
+  acceptASTNode(CalcExp->left());
+  acceptASTNode(CalcExp->right());
+  return createWrapperRef();
+}
+
+ResultTy Resolver::visit(ast::logic_expression *LogExp) {
+  acceptASTNode(LogExp->left());
+  acceptASTNode(LogExp->right());
+  return createWrapperRef();
+}
+
+ResultTy Resolver::visit(ast::un_operator *UnOp) {
+  acceptASTNode(UnOp->arg());
+  return createWrapperRef();
+}
+
+ResultTy Resolver::visit(ast::number *) { return createWrapperRef(); }
+
+ResultTy Resolver::visit(ast::variable *Var) {
+  Var->setSlot(lookupSlot(Var));
+  return createWrapperRef();
+}
+
+ResultTy Resolver::visit(ast::assignment *Assign) {
+  // The right side is evaluated first, so 'a = a + 1' uses the outer 'a' if it
+  // exists
+  acceptASTNode(Assign->getIdentExp());
+  auto *LValue = Assign->getLValue();
+  auto Slot = lookupSlot(LValue);
+  if (!Slot.isValid()) {
+    auto *DeclScope = LValue->scope();
+    assert(DeclScope);
+    Slot = {DeclScope->depth(), SlotsNum[DeclScope]++};
+    SlotIndices.try_emplace(LValue->entityKey(), Slot.Index);
+  }
+  LValue->setSlot(Slot);
+  return createWrapperRef();
+}
+
+ResultTy Resolver::visit(ast::if_operator *If) {
+  acceptASTNode(If->condition());
+  acceptASTNode(If->body());
+  if (auto *ElseBlock = If->else_block())
+    acceptASTNode(ElseBlock);
+  return createWrapperRef();
+}
+
+ResultTy Resolver::visit(ast::while_operator *While) {
+  acceptASTNode(While->condition());
+  acceptASTNode(While->body());
+  return createWrapperRef();
+}
+
+ResultTy Resolver::visit(ast::pfor_operator *PFor) {
+  acceptASTNode(PFor->init());
+  acceptASTNode(PFor->limit());
+  // The body is a block of the current depth, the loop variable takes its
+  // first slot
+  auto *Body = PFor->body();
+  auto *LoopVar = PFor->loop_variable();
+  ast::FrameSlot Slot{CurrDepth, SlotsNum[Body]++};
+  SlotIndices.try_emplace(LoopVar->entityKey(), Slot.Index);
+  LoopVar->setSlot(Slot);
+
+  ParallelLoops.push_back({PFor, {}});
+  acceptASTNode(Body);
+  PFor->set_copies_shared_arrays(
+      llvm::any_of(ParallelLoops.back().Initializers, [PFor](auto Init) {
+        return llvm::is_contained(PFor->shared_arrays(), Init);
+      }));
+  ParallelLoops.pop_back();
+  return createWrapperRef();
+}
+
+ResultTy Resolver::visit(ast::read_expression *) { return createWrapperRef(); }
+
+ResultTy Resolver::visit(ast::print_function *Print) {
+  acceptASTNode(Print->get());
+  return createWrapperRef();
+}
+
+ResultTy Resolver::visit(ast::reduce_function *Reduce) {
+  acceptASTNode(Reduce->array());
+  if (auto *Operand = Reduce->operand())
+    acceptASTNode(Operand);
+  return createWrapperRef();
+}
+
+ResultTy Resolver::visit(ast::ArrayHolder *ArrStore) {
+  assert(ArrStore->get());
+  return acceptASTNode(ArrStore->get());
+}
+
+ResultTy Resolver::visit(ast::PresetArray *PresetArr) {
+  for (auto *CurrExp : *PresetArr) {
+    acceptASTNode(CurrExp);
+    recordArrayInitializer(CurrExp);
+  }
+  return createWrapperRef();
+}
+
+ResultTy Resolver::visit(ast::UniformArray *UnifArr) {
+  acceptASTNode(UnifArr->getInitExpr());
+  recordArrayInitializer(UnifArr->getInitExpr());
+  acceptASTNode(UnifArr->getSize());
+  return createWrapperRef();
+}
+
+ResultTy Resolver::visit(ast::ArrayAccess *ArrAccess) {
+  ArrAccess->setSlot(lookupSlot(ArrAccess));
+  for (auto *IndexExp : *ArrAccess)
+    acceptASTNode(IndexExp);
+  return createWrapperRef();
+}
+
+ResultTy Resolver::visit(ast::ArrayAccessAssignment *ArrAssign) {
+  acceptASTNode(ArrAssign->getArrayAccess());
+  acceptASTNode(ArrAssign->getIdentExp());
+  auto Slot = ArrAssign->getArrayAccess()->slot();
+  for (auto &Loop : ParallelLoops)
+    if (Slot.Depth < Loop.PFor->body()->depth())
+      Loop.PFor->add_shared_array(Slot);
+  return createWrapperRef();
+}
+
+ast::FrameSlot Resolver::lookupSlot(ast::variable *Var) {
+  for (auto *Scope = Var->scope(); Scope; Scope = Scope->scope())
+    if (auto Found = SlotIndices.find({Var->name(), Scope});
+        Found != SlotIndices.end())
+      return {Scope->depth(), Found->second};
+  return {};
+}
+
+void Resolver::recordArrayInitializer(ast::expression *Exp) {
+  auto *Var = dynamic_cast<ast::variable *>(Exp);
+  if (!Var || dynamic_cast<ast::ArrayAccess *>(Exp))
+    return;
+  auto Slot = Var->slot();
+  for (auto &Loop : ParallelLoops)
+    if (Slot.Depth < Loop.PFor->body()->depth())
+      Loop.Initializers.push_back(Slot);
+}
+
+} // namespace paracl
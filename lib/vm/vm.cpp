@@ -0,0 +1,292 @@
+#include <llvm/Support/ErrorHandling.h>
+#include <llvm/Support/FormatVariadic.h>
+
+#include <sstream>
+
+#include "array_fill.hpp"
+#include "array_reduce.hpp"
+#include "utils.hpp"
+#include "vm.hpp"
+
+namespace paracl {
+namespace vm {
+
+namespace {
+
+// ParaCL integers wrap around on overflow, so we do the arithmetic on the
+// unsigned values to avoid undefined behavior of the host.
+int32_t wrapAdd(int32_t Lhs, int32_t Rhs) {
+  return static_cast<int32_t>(static_cast<uint32_t>(Lhs) +
+                              static_cast<uint32_t>(Rhs));
+}
+
+int32_t wrapSub(int32_t Lhs, int32_t Rhs) {
+  return static_cast<int32_t>(static_cast<uint32_t>(Lhs) -
+                              static_cast<uint32_t>(Rhs));
+}
+
+int32_t wrapMul(int32_t Lhs, int32_t Rhs) {
+  return static_cast<int32_t>(static_cast<uint32_t>(Lhs) *
+                              static_cast<uint32_t>(Rhs));
+}
+
+} // namespace
+
+void VirtualMachine::run(const Program &Prog) {
+  std::vector<int32_t> Regs(Prog.getRegistersNumber(), 0);
+  std::vector<ArrayStorage> Arrays(Prog.getArrayRegistersNumber());
+
+  const auto *Code = Prog.data();
+  const auto *IP = Code;
+  for (;;) {
+    const auto &Instr = *IP++;
+    switch (Instr.Op) {
+    case OpCode::LoadConst:
+      Regs[Instr.A] = Instr.B;
+      break;
+    case OpCode::Move:
+      Regs[Instr.A] = Regs[Instr.B];
+      break;
+    case OpCode::Add:
+      Regs[Instr.A] = wrapAdd(Regs[Instr.B], Regs[Instr.C]);
+      break;
+    case OpCode::Sub:
+      Regs[Instr.A] = wrapSub(Regs[Instr.B], Regs[Instr.C]);
+      break;
+    case OpCode::Mul:
+      Regs[Instr.A] = wrapMul(Regs[Instr.B], Regs[Instr.C]);
+      break;
+    case OpCode::Div:
+      if (!Regs[Instr.C])
+        reportError(Prog, &Instr - Code, "{0}, trying to divide by 0");
+      Regs[Instr.A] = Regs[Instr.B] / Regs[Instr.C];
+      break;
+    case OpCode::Rem:
+      Regs[Instr.A] = Regs[Instr.B] % Regs[Instr.C];
+      break;
+    case OpCode::AddImm:
+      Regs[Instr.A] = wrapAdd(Regs[Instr.B], Instr.C);
+      break;
+    case OpCode::Less:
+      Regs[Instr.A] = Regs[Instr.B] < Regs[Instr.C];
+      break;
+    case OpCode::LessEq:
+      Regs[Instr.A] = Regs[Instr.B] <= Regs[Instr.C];
+      break;
+    case OpCode::Greater:
+      Regs[Instr.A] = Regs[Instr.B] > Regs[Instr.C];
+      break;
+    case OpCode::GreaterEq:
+      Regs[Instr.A] = Regs[Instr.B] >= Regs[Instr.C];
+      break;
+    case OpCode::Equal:
+      Regs[Instr.A] = Regs[Instr.B] == Regs[Instr.C];
+      break;
+    case OpCode::NotEqual:
+      Regs[Instr.A] = Regs[Instr.B] != Regs[Instr.C];
+      break;
+    case OpCode::Neg:
+      Regs[Instr.A] = wrapSub(0, Regs[Instr.B]);
+      break;
+    case OpCode::Not:
+      Regs[Instr.A] = !Regs[Instr.B];
+      break;
+    case OpCode::ToBool:
+      Regs[Instr.A] = Regs[Instr.B] != 0;
+      break;
+    case OpCode::Jump:
+      IP = Code + Instr.A;
+      break;
+    case OpCode::JumpIfZero:
+      if (!Regs[Instr.A])
+        IP = Code + Instr.B;
+      break;
+    case OpCode::JumpIfNotZero:
+      if (Regs[Instr.A])
+        IP = Code + Instr.B;
+      break;
+    case OpCode::JumpIfGreaterEq:
+      if (Regs[Instr.A] >= Regs[Instr.B])
+        IP = Code + Instr.C;
+      break;
+    case OpCode::Scan: {
+      int32_t Tmp = 0;
+      Output.flushBeforeInput();
+      if (!Input.readInt(Tmp))
+        reportError(Prog, &Instr - Code,
+                    "{0}: Non-integer data was transmitted");
+      Regs[Instr.A] = Tmp;
+      break;
+    }
+    case OpCode::Print:
+      Output.printInt(Regs[Instr.A]);
+      break;
+    case OpCode::PrintArray:
+      Output.printInts(Arrays[Instr.A].Data.data(),
+                       Arrays[Instr.A].Data.size());
+      break;
+    case OpCode::NewUniform: {
+      auto &Arr = Arrays[Instr.A];
+      unsigned Size = Regs[Instr.C];
+      Arr.Data.assign(Size, Regs[Instr.B]);
+      Arr.Dims.assign(1, Size);
+      break;
+    }
+    case OpCode::RepeatArray: {
+      // Build the result in a separate storage because the initializer and the
+      // destination may be the same register
+      ArrayStorage Result;
+      const auto &Initer = Arrays[Instr.B];
+      unsigned Size = Regs[Instr.C];
+      Result.Data.resize(Initer.Data.size() * Size);
+      runtime::fillArray(Result.Data.data(), Result.Data.size(),
+                         Initer.Data.data(), Initer.Data.size());
+      Result.Dims.push_back(Size);
+      Result.Dims.append(Initer.Dims.begin(), Initer.Dims.end());
+      Arrays[Instr.A] = std::move(Result);
+      break;
+    }
+    case OpCode::NewPreset: {
+      auto &Arr = Arrays[Instr.A];
+      Arr.Data.clear();
+      Arr.Dims.assign(1, 0);
+      break;
+    }
+    case OpCode::AppendValue: {
+      auto &Arr = Arrays[Instr.A];
+      Arr.Data.push_back(Regs[Instr.B]);
+      Arr.Dims.front() = Arr.Data.size();
+      break;
+    }
+    case OpCode::AppendArray: {
+      auto &Arr = Arrays[Instr.A];
+      const auto &Elems = Arrays[Instr.B].Data;
+      Arr.Data.insert(Arr.Data.end(), Elems.begin(), Elems.end());
+      Arr.Dims.front() = Arr.Data.size();
+      break;
+    }
+    case OpCode::MoveArray:
+      Arrays[Instr.A] = std::move(Arrays[Instr.B]);
+      Arrays[Instr.B].release();
+      break;
+    case OpCode::FreeArray:
+      Arrays[Instr.A].release();
+      break;
+    case OpCode::ScaleIndex:
+      Regs[Instr.A] = wrapMul(Regs[Instr.A], Arrays[Instr.B].Dims[Instr.C]);
+      break;
+    case OpCode::CheckIndex: {
+      // The negative indexes are huge unsigned ones
+      auto Size = Arrays[Instr.B].Dims[Instr.C];
+      if (static_cast<uint32_t>(Regs[Instr.A]) >= Size)
+        reportError(Prog, &Instr - Code,
+                    "{0}: array index {1} is out of range [0, {2})",
+                    Regs[Instr.A], Size);
+      break;
+    }
+    case OpCode::LoadElem:
+      Regs[Instr.A] = Arrays[Instr.B].Data[Regs[Instr.C]];
+      break;
+    case OpCode::StoreElem:
+      Arrays[Instr.A].Data[Regs[Instr.B]] = Regs[Instr.C];
+      break;
+    case OpCode::ArraySum: {
+      const auto &Data = Arrays[Instr.B].Data;
+      Regs[Instr.A] = runtime::sumArray(Data.data(), Data.size());
+      break;
+    }
+    case OpCode::ArrayMin: {
+      const auto &Data = Arrays[Instr.B].Data;
+      Regs[Instr.A] = runtime::minArray(Data.data(), Data.size());
+      break;
+    }
+    case OpCode::ArrayMax: {
+      const auto &Data = Arrays[Instr.B].Data;
+      Regs[Instr.A] = runtime::maxArray(Data.data(), Data.size());
+      break;
+    }
+    case OpCode::ArrayCount: {
+      const auto &Data = Arrays[Instr.B].Data;
+      Regs[Instr.A] =
+          runtime::countInArray(Data.data(), Data.size(), Regs[Instr.C]);
+      break;
+    }
+    case OpCode::ArrayDot: {
+      const auto &Lhs = Arrays[Instr.B].Data;
+      const auto &Rhs = Arrays[Instr.C].Data;
+      if (Lhs.size() != Rhs.size())
+        reportError(Prog, &Instr - Code,
+                    "{0}: dot of the arrays of the different sizes {1} and {2}",
+                    Lhs.size(), Rhs.size());
+      Regs[Instr.A] = runtime::dotArrays(Lhs.data(), Rhs.data(), Lhs.size());
+      break;
+    }
+    case OpCode::ElementWise:
+      // The destination may be one of the operands
+      Arrays[Instr.A] = evaluateElementWise(Prog, &Instr - Code, Regs, Arrays);
+      break;
+    case OpCode::Halt:
+      return;
+    default:
+      llvm_unreachable("Unsupported opcode for the ParaCL virtual machine");
+    }
+  }
+}
+
+std::string VirtualMachine::prepareErrorReport(const Program &Prog,
+                                               unsigned InstrID) const {
+  auto Loc = Prog.getLocation(InstrID);
+  assert(Loc.has_value());
+  return prepareErrorReport(Loc.value());
+}
+
+std::string VirtualMachine::prepareErrorReport(const yy::location &Loc) const {
+  Output.flush();
+  std::ostringstream LocationStr;
+  LocationStr << Loc;
+  return LocationStr.str();
+}
+
+ArrayStorage
+VirtualMachine::evaluateElementWise(const Program &Prog, unsigned InstrID,
+                                    llvm::ArrayRef<int32_t> Regs,
+                                    llvm::ArrayRef<ArrayStorage> Arrays) const {
+  auto &Expr = Prog.getElementWise(Prog[InstrID].B);
+  llvm::SmallVector<runtime::ElementOperand, 4> Operands;
+  const ArrayStorage *Shaped = nullptr;
+  for (auto [IsArray, Reg] : Expr.Operands) {
+    if (!IsArray) {
+      Operands.push_back({nullptr, Regs[Reg]});
+      continue;
+    }
+    auto &Arr = Arrays[Reg];
+    if (!Shaped) {
+      Shaped = &Arr;
+    } else if (Shaped->Dims != Arr.Dims) {
+      auto [LhsSize, RhsSize] =
+          *llvm::find_if(llvm::zip(Shaped->Dims, Arr.Dims), [](auto Dims) {
+            return std::get<0>(Dims) != std::get<1>(Dims);
+          });
+      reportError(Prog, InstrID,
+                  "{0}: element-wise operation on the arrays of the different "
+                  "sizes {1} and {2}",
+                  LhsSize, RhsSize);
+    }
+    Operands.push_back({Arr.Data.data(), 0});
+  }
+  assert(Shaped);
+
+  ArrayStorage Result;
+  Result.Data.resize(Shaped->Data.size());
+  Result.Dims = Shaped->Dims;
+  runtime::ElementWiseKernel Kernel(Expr.Steps);
+  if (auto StepID =
+          Kernel.run(Operands, Result.Data.data(), Result.Data.size()))
+    paracl::fatal(
+        llvm::formatv("{0}, trying to divide by 0",
+                      prepareErrorReport(Expr.StepLocations[*StepID])));
+  return Result;
+}
+
+} // namespace vm
+} // namespace paracl
@@ -1,10 +1,13 @@
+#include <llvm/Passes/OptimizationLevel.h>
 #include <llvm/Support/CommandLine.h>
 #include <llvm/Support/ErrorHandling.h>
+#include <llvm/Support/FileSystem.h>
 #include <llvm/Support/FormatVariadic.h>
 #include <llvm/Support/raw_ostream.h>
 
 #include <FlexLexer.h>
 #include <fstream>
+#include <memory>
 #include <string>
 
 #include "driver.hpp"
@@ -16,12 +19,19 @@ namespace {
 namespace cl = llvm::cl;
 
 enum Error { SyntaxErr = 0xbad2bad };
-enum OperatingMode { Compiler, Interpreter };
+enum OperatingMode { Compiler, Interpreter, Tiered, VM, JIT };
 
 cl::opt<std::string> InputFileName(cl::Positional, cl::desc("<input file>"),
                                    cl::value_desc("filename"), cl::Required,
                                    cl::cat(paracl::ParaCLCategory));
 
+cl::opt<std::string>
+    InputDataFileName("input",
+                      cl::desc("Read the input of the program (?) from the "
+                               "file instead of stdin"),
+                      cl::value_desc("filename"), cl::Optional,
+                      cl::cat(paracl::ParaCLCategory));
+
 cl::opt<std::string> ModuleName("module-name",
                                 cl::desc("Set the name for the paraCL module"),
                                 cl::value_desc("paraCL module name"),
@@ -33,14 +43,75 @@ cl::opt<OperatingMode> OperatingMode(
     cl::values(clEnumValN(Compiler, "compiler",
                           "Compiling paraCL code in llvm IR"),
                clEnumValN(Interpreter, "interpreter",
-                          "Interpreting paraCL code without compiling")),
+                          "Interpreting paraCL code without compiling"),
+               clEnumValN(Tiered, "tiered",
+                          "Interpreting paraCL code and compiling the hot "
+                          "loops with the llvm JIT"),
+               clEnumValN(VM, "vm",
+                          "Executing paraCL code on the register-based "
+                          "virtual machine"),
+               clEnumValN(JIT, "jit",
+                          "Compiling paraCL code and executing it in-process "
+                          "with the llvm JIT")),
+    cl::Optional, cl::cat(paracl::ParaCLCategory));
+
+cl::opt<char> OptLevel("O",
+                       cl::desc("Optimization level of the generated code: "
+                                "-O0, -O1, -O2 or -O3 (default = '-O0' for "
+                                "the compiler and '-O2' for the JIT)"),
+                       cl::Prefix, cl::Optional,
+                       cl::cat(paracl::ParaCLCategory));
+
+cl::opt<paracl::codegen::OutputKind> EmitKind(
+    "emit", cl::desc("Set the output kind of the compiler"),
+    cl::init(paracl::codegen::OutputKind::IR),
+    cl::values(clEnumValN(paracl::codegen::OutputKind::IR, "ll",
+                          "Textual llvm IR"),
+               clEnumValN(paracl::codegen::OutputKind::Bitcode, "bc",
+                          "llvm bitcode"),
+               clEnumValN(paracl::codegen::OutputKind::Assembly, "asm",
+                          "Target assembly"),
+               clEnumValN(paracl::codegen::OutputKind::Object, "obj",
+                          "Target object file"),
+               clEnumValN(paracl::codegen::OutputKind::Executable, "exe",
+                          "Executable linked with the ParaCL runtime library "
+                          "('a.out' if -o isn't set)")),
     cl::Optional, cl::cat(paracl::ParaCLCategory));
 
 cl::opt<std::string>
-    OutputFileName("o", cl::desc("Specify output filename for llvm IR"),
+    OutputFileName("o", cl::desc("Specify output filename for the compiler"),
                    cl::value_desc("filename"), cl::Optional,
                    cl::cat(paracl::ParaCLCategory));
 
+llvm::OptimizationLevel getOptLevel(llvm::OptimizationLevel Default) {
+  if (OptLevel.getNumOccurrences() == 0)
+    return Default;
+  switch (OptLevel) {
+  case '0':
+    return llvm::OptimizationLevel::O0;
+  case '1':
+    return llvm::OptimizationLevel::O1;
+  case '2':
+    return llvm::OptimizationLevel::O2;
+  case '3':
+    return llvm::OptimizationLevel::O3;
+  default:
+    paracl::fatal(llvm::formatv("invalid optimization level: -O{0}", OptLevel));
+  }
+}
+
+std::unique_ptr<paracl::runtime::InputReader> openInputData() {
+  if (InputDataFileName.getNumOccurrences() == 0)
+    return std::make_unique<paracl::runtime::InputReader>(STDIN_FILENO);
+
+  int FD = 0;
+  if (auto ErrCode = llvm::sys::fs::openFileForRead(InputDataFileName, FD))
+    paracl::fatal(llvm::formatv("can't open the input file '{0}': {1}",
+                                InputDataFileName, ErrCode.message()));
+  return std::make_unique<paracl::runtime::InputReader>(FD,
+                                                        /*ShouldClose=*/true);
+}
+
 void printParaCLVersion(llvm::raw_ostream &Os) { Os << "ParaCL: 1.0" << '\n'; }
 
 } // namespace
@@ -50,8 +121,14 @@ int main(int argc, char **argv) try {
   cl::HideUnrelatedOptions(paracl::ParaCLCategory);
   cl::ParseCommandLineOptions(argc, argv,
                               " ParaCL (custom para C language))\n\n"
-                              " This program has two modes: compiler in llvm "
-                              "IR and interpreter (set on default).\n");
+                              " This program has five modes: compiler in llvm "
+                              "IR, interpreter (set on default), tiered "
+                              "interpreter, virtual machine and llvm JIT.\n");
+  // The code compiled in the JIT modes is executed right away, so it's
+  // optimized by default
+  auto CodeOptLevel = getOptLevel(OperatingMode == Compiler
+                                      ? llvm::OptimizationLevel::O0
+                                      : llvm::OptimizationLevel::O2);
   std::ifstream InputFileStream(InputFileName);
   if (InputFileStream.fail())
     paracl::fatal(llvm::formatv("no such file: '{0}'\n", InputFileName));
@@ -63,23 +140,46 @@ int main(int argc, char **argv) try {
     errors.value().print_errors(llvm::errs(), InputFileName);
     return SyntaxErr;
   }
+  Driver.optimize();
+  Driver.resolve();
+  Driver.insert_bounds_checks();
+  // Only the compiled code executes the loops in parallel
+  if (OperatingMode == Compiler || OperatingMode == JIT)
+    Driver.parallelize_loops(InputFileName);
 
   if (OperatingMode == Compiler) {
-    if (OutputFileName.getNumOccurrences() > 0) {
+    if (EmitKind == paracl::codegen::OutputKind::Executable) {
+      Driver.build_executable(ModuleName,
+                              OutputFileName.getNumOccurrences() > 0
+                                  ? OutputFileName.getValue()
+                                  : "a.out",
+                              CodeOptLevel);
+    } else if (OutputFileName.getNumOccurrences() > 0) {
       std::error_code ErrCode;
-      llvm::raw_fd_ostream FileOs(OutputFileName, ErrCode);
+      llvm::raw_fd_ostream FileOs(OutputFileName, ErrCode,
+                                  paracl::codegen::isTextOutput(EmitKind)
+                                      ? llvm::sys::fs::OF_Text
+                                      : llvm::sys::fs::OF_None);
       if (ErrCode)
         paracl::fatal(ErrCode.message().c_str());
 
-      Driver.compile(ModuleName, FileOs);
+      Driver.compile(ModuleName, FileOs, CodeOptLevel, EmitKind);
       FileOs.close();
     } else {
-      Driver.compile(ModuleName, llvm::outs());
+      Driver.compile(ModuleName, llvm::outs(), CodeOptLevel, EmitKind);
     }
-  } else if (OperatingMode == Interpreter) {
-    Driver.evaluate();
   } else {
-    llvm_unreachable("Unknown operating mode for paraCL");
+    auto Input = openInputData();
+    if (OperatingMode == Interpreter)
+      Driver.evaluate(*Input);
+    else if (OperatingMode == Tiered)
+      Driver.evaluate_tiered(ModuleName, CodeOptLevel, *Input);
+    else if (OperatingMode == VM)
+      Driver.execute(*Input);
+    else if (OperatingMode == JIT)
+      Driver.jit(ModuleName, CodeOptLevel, *Input);
+    else
+      llvm_unreachable("Unknown operating mode for paraCL");
   }
 
 } catch (const std::exception &Except) {